@@ -0,0 +1,598 @@
+//Microbenchmarks for the containers, System and archetype storage, prefab spawning and the transform and collision ticks
+//Writes one JSON result per line so runs can be diffed, and fails when a result regresses against a baseline
+//Usage: swamped_microbench [--reps N] [--filter TEXT] [--out FILE] [--baseline FILE] [--tolerance FRACTION]
+
+#include "Simulation.h"
+#include "Constructors.h"
+#include "System.h"
+#include "ArchetypeSystem.h"
+#include "FreeVector.h"
+#include "ClearVector.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+//Returns the elapsed time of f in nanoseconds
+template <typename F>
+double Time(F f) {
+	auto start = steady_clock::now();
+	f();
+	return duration<double, nano>(steady_clock::now() - start).count();
+}
+
+//A benchmark's samples, in nanoseconds per operation
+struct BenchResult {
+	string m_name;
+	string m_params;
+	size_t m_operations;
+	vector<double> m_samples;
+
+	string GetKey() const {
+		return m_name + "/" + m_params;
+	}
+	double GetMedian() const {
+		vector<double> sorted = m_samples;
+		sort(sorted.begin(), sorted.end());
+		return sorted[sorted.size() / 2];
+	}
+	double GetMin() const {
+		return *min_element(m_samples.begin(), m_samples.end());
+	}
+};
+
+//Runs benchmarks and collects their results
+class BenchmarkSuite {
+public:
+	BenchmarkSuite(unsigned int repetitions, const string& filter) : m_repetitions(repetitions), m_filter(filter) {
+	}
+
+	//Runs a benchmark that times operations and returns the elapsed nanoseconds
+	//Setup belongs in the caller or outside the timed region of run
+	void Run(const string& name, const string& params, size_t operations, const function<double()>& run) {
+		BenchResult result = { name, params, operations, {} };
+		if (!m_filter.empty() && result.GetKey().find(m_filter) == string::npos)
+			return;
+		fprintf(stderr, "%s ", result.GetKey().c_str());
+		for (unsigned int r = 0; r < m_repetitions; r++)
+			result.m_samples.push_back(run() / operations);
+		fprintf(stderr, "%.2f ns/op\n", result.GetMedian());
+		m_results.push_back(result);
+	}
+
+	void WriteJson(FILE* out) const {
+		fprintf(out, "{\n\"suite\": \"swamped_microbench\",\n\"threads\": %u,\n\"repetitions\": %u,\n\"results\": [\n",
+			JobSystem::GetDefault().GetThreadCount(), m_repetitions);
+		for (size_t r = 0; r < m_results.size(); r++) {
+			const BenchResult& result = m_results[r];
+			double median = result.GetMedian();
+			fprintf(out, "{\"key\": \"%s\", \"name\": \"%s\", \"params\": \"%s\", \"operations\": %zu, \"ns_per_op\": %.3f, \"min_ns_per_op\": %.3f, \"ops_per_sec\": %.0f}%s\n",
+				result.GetKey().c_str(), result.m_name.c_str(), result.m_params.c_str(), result.m_operations,
+				median, result.GetMin(), 1e9 / median, (r + 1 < m_results.size()) ? "," : "");
+		}
+		fprintf(out, "]\n}\n");
+	}
+
+	//Compares medians against a baseline written by WriteJson and returns the number of regressions
+	unsigned int Compare(const string& baselinePath, double tolerance) const {
+		ifstream baseline(baselinePath);
+		if (!baseline.good()) {
+			fprintf(stderr, "Could not read baseline %s\n", baselinePath.c_str());
+			return 1;
+		}
+		unordered_map<string, double> previous;
+		string line;
+		while (getline(baseline, line)) {
+			size_t key = line.find("\"key\": \"");
+			size_t ns = line.find("\"ns_per_op\": ");
+			if (key == string::npos || ns == string::npos)
+				continue;
+			key += 8;
+			previous[line.substr(key, line.find('"', key) - key)] = atof(line.c_str() + ns + 13);
+		}
+
+		unsigned int regressions = 0;
+		for (const BenchResult& result : m_results) {
+			auto found = previous.find(result.GetKey());
+			if (found == previous.end())
+				continue;
+			double change = result.GetMedian() / found->second - 1;
+			if (change > tolerance) {
+				fprintf(stderr, "REGRESSION %s: %.2f -> %.2f ns/op (%+.1f%%)\n", result.GetKey().c_str(), found->second, result.GetMedian(), change * 100);
+				++regressions;
+			}
+		}
+		return regressions;
+	}
+private:
+	unsigned int m_repetitions;
+	string m_filter;
+	vector<BenchResult> m_results;
+};
+
+string Params(const char* format, ...) {
+	char buffer[128];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+	return buffer;
+}
+
+//A System with no behaviour, for measuring its storage
+class BenchSystem : public System<TransformComponent> {
+public:
+	void Update(Simulation * sim, float dT) {}
+};
+
+//A System of colliders with no behaviour, exposing its entities to join against
+class BenchColliderSystem : public System<BoundingBox> {
+public:
+	void Update(Simulation * sim, float dT) {}
+
+	const vector<EntityId>& GetEntities() const {
+		return m_components.GetEntities();
+	}
+};
+
+//Archetype systems with no behaviour sharing one storage, for measuring it
+class BenchArchetypeColliders : public ArchetypeSystem<BoundingBox> {
+public:
+	BenchArchetypeColliders(ArchetypeStorage* storage) : ArchetypeSystem<BoundingBox>(storage) {}
+	void Update(Simulation * sim, float dT) {}
+};
+
+class BenchArchetypeBodies : public ArchetypePairedSystem<TransformComponent, PhysicsComponent> {
+public:
+	BenchArchetypeBodies(ArchetypeStorage* storage) : ArchetypePairedSystem<TransformComponent, PhysicsComponent>(storage) {}
+	void Update(Simulation * sim, float dT) {}
+
+	//Sums the scales and vertical velocities over its query, a chunk at a time
+	float SumScales() {
+		float sum = 0;
+		m_query.ForEachChunk([&sum](Span<EntityId> entities, Span<TransformComponent> transforms, Span<PhysicsComponent> physics) {
+			for (size_t r = 0; r < transforms.size(); r++)
+				sum += transforms[r].m_scale + physics[r].m_velocity.y;
+		});
+		return sum;
+	}
+};
+
+//Adds and frees random slots of a full FreeVector, then iterates the live slots
+void BenchFreeVector(BenchmarkSuite& suite) {
+	for (unsigned int count : { 10000u, 100000u, 1000000u }) {
+		suite.Run("FreeVector/churn", Params("count=%u", count), count, [count]() {
+			FreeVector<TransformComponent> fv;
+			for (unsigned int c = 0; c < count; c++)
+				fv.add(TransformComponent());
+			mt19937 rng(count);
+			uniform_int_distribution<unsigned int> slot(0, count - 1);
+			vector<unsigned int> victims(count);
+			for (unsigned int& v : victims)
+				v = slot(rng);
+			return Time([&]() {
+				for (unsigned int c = 0; c < count; c++) {
+					fv.free(victims[c]);
+					fv.add(TransformComponent());
+				}
+			});
+		});
+
+		//compacts a FreeVector with nine in ten slots dead in one unbudgeted pass
+		suite.Run("FreeVector/compact", Params("count=%u,fill=10%%", count), count, [count]() {
+			FreeVector<TransformComponent> fv;
+			for (unsigned int c = 0; c < count; c++)
+				fv.add(TransformComponent());
+			for (unsigned int c = 0; c < count; c++) {
+				if (c % 10 != 0)
+					fv.free(c);
+			}
+			unsigned int moves = 0;
+			CompactionBudget budget(1e9);
+			double ns = Time([&]() {
+				fv.Compact(budget, [&moves](unsigned int from, unsigned int to) {
+					moves++;
+				});
+			});
+			volatile unsigned int sink = moves;
+			(void)sink;
+			return ns;
+		});
+
+		//every tenth slot filled is the state the world is left in after mass collisions
+		for (unsigned int stride : { 2u, 10u }) {
+			suite.Run("FreeVector/iterate", Params("count=%u,fill=%u%%", count, 100 / stride), count, [count, stride]() {
+				FreeVector<TransformComponent> fv;
+				for (unsigned int c = 0; c < count; c++)
+					fv.add(TransformComponent());
+				for (unsigned int c = 0; c < count; c++) {
+					if (c % stride != 0)
+						fv.free(c);
+				}
+				float sum = 0;
+				double ns = Time([&]() {
+					fv.ForEach([&sum](unsigned int index, TransformComponent& tc) {
+						sum += tc.m_position.x;
+					});
+				});
+				volatile float sink = sum;
+				(void)sink;
+				return ns;
+			});
+		}
+	}
+}
+
+//Adds to one ClearVector from several threads at once
+void BenchClearVector(BenchmarkSuite& suite) {
+	const unsigned int ADDS_PER_THREAD = 200000;
+	for (unsigned int threads : { 1u, 2u, 4u, 8u }) {
+		suite.Run("ClearVector/add", Params("threads=%u", threads), threads * ADDS_PER_THREAD, [threads, ADDS_PER_THREAD]() {
+			ClearVector<unsigned int> cv;
+			atomic<bool> go(false);
+			atomic<unsigned int> ready(0);
+			vector<thread> workers;
+			for (unsigned int t = 0; t < threads; t++) {
+				workers.emplace_back([&]() {
+					++ready;
+					while (!go.load())
+						this_thread::yield();
+					for (unsigned int c = 0; c < ADDS_PER_THREAD; c++)
+						cv.add(c);
+				});
+			}
+			while (ready.load() < threads)
+				this_thread::yield();
+			return Time([&]() {
+				go = true;
+				for (thread& worker : workers)
+					worker.join();
+			});
+		});
+	}
+}
+
+//Creates, looks up and removes components of a System in random entity order
+void BenchSystemStorage(BenchmarkSuite& suite) {
+	for (unsigned int count : { 10000u, 100000u, 1000000u }) {
+		vector<EntityId> entities;
+		for (unsigned int c = 0; c < count; c++)
+			entities.push_back(EntityId(c, 0));
+		vector<EntityId> shuffled = entities;
+		shuffle(shuffled.begin(), shuffled.end(), mt19937(count));
+
+		suite.Run("System/Create", Params("count=%u", count), count, [&]() {
+			BenchSystem system;
+			return Time([&]() {
+				for (EntityId e : entities)
+					system.Create(e, TransformComponent());
+			});
+		});
+
+		BenchSystem system;
+		for (EntityId e : entities)
+			system.Create(e, TransformComponent());
+		suite.Run("System/GetComponent", Params("count=%u", count), count, [&]() {
+			float sum = 0;
+			double ns = Time([&]() {
+				for (EntityId e : shuffled)
+					sum += system.GetComponent(e).m_scale;
+			});
+			volatile float sink = sum;
+			(void)sink;
+			return ns;
+		});
+
+		suite.Run("System/Remove", Params("count=%u", count), count, [&]() {
+			BenchSystem removed;
+			for (EntityId e : entities)
+				removed.Create(e, TransformComponent());
+			return Time([&]() {
+				for (EntityId e : shuffled)
+					removed.Remove(e);
+			});
+		});
+	}
+}
+
+//Creates, joins and removes entities in an ArchetypeStorage, every other one with a collider so they split over two archetypes
+//The transform and collider join runs once as an archetype query and once the way System does it, a lookup per collider
+void BenchArchetypeStorage(BenchmarkSuite& suite) {
+	for (unsigned int count : { 10000u, 100000u, 1000000u }) {
+		vector<EntityId> entities;
+		for (unsigned int c = 0; c < count; c++)
+			entities.push_back(EntityId(c, 0));
+		vector<EntityId> shuffled = entities;
+		shuffle(shuffled.begin(), shuffled.end(), mt19937(count));
+		BoundingBox box = {};
+
+		//giving a body a collider moves its row to the other archetype
+		suite.Run("Archetype/Create", Params("count=%u", count), count, [&]() {
+			ArchetypeStorage storage;
+			BenchArchetypeBodies bodies(&storage);
+			BenchArchetypeColliders colliders(&storage);
+			return Time([&]() {
+				for (EntityId e : entities) {
+					bodies.Create(e, TransformComponent(), PhysicsComponent());
+					if (e.m_index % 2 == 0)
+						colliders.Create(e, box);
+				}
+			});
+		});
+
+		ArchetypeStorage storage;
+		BenchArchetypeBodies bodies(&storage);
+		BenchArchetypeColliders colliders(&storage);
+		for (EntityId e : entities) {
+			bodies.Create(e, TransformComponent(), PhysicsComponent());
+			if (e.m_index % 2 == 0)
+				colliders.Create(e, box);
+		}
+
+		suite.Run("Archetype/Query", Params("count=%u", count), count, [&]() {
+			float sum = 0;
+			double ns = Time([&]() {
+				sum += bodies.SumScales();
+			});
+			volatile float sink = sum;
+			(void)sink;
+			return ns;
+		});
+
+		suite.Run("Archetype/Join", Params("count=%u", count), count / 2, [&]() {
+			Query<TransformComponent, BoundingBox> join(&storage);
+			float sum = 0;
+			double ns = Time([&]() {
+				join.ForEachChunk([&sum](Span<EntityId> joined, Span<TransformComponent> transforms, Span<BoundingBox> boxes) {
+					for (size_t r = 0; r < boxes.size(); r++)
+						sum += transforms[r].m_position.x + boxes[r].m_corners[0].x;
+				});
+			});
+			volatile float sink = sum;
+			(void)sink;
+			return ns;
+		});
+
+		//the same join over System storage, looking each collider's transform up by entity like CollisionSystem does
+		suite.Run("System/Join", Params("count=%u", count), count / 2, [&]() {
+			BenchSystem transforms;
+			BenchColliderSystem boxes;
+			for (EntityId e : entities) {
+				transforms.Create(e, TransformComponent());
+				if (e.m_index % 2 == 0)
+					boxes.Create(e, box);
+			}
+			const vector<EntityId>& boxEntities = boxes.GetEntities();
+			vector<BoundingBox>& boxList = boxes.GetComponentList();
+			float sum = 0;
+			double ns = Time([&]() {
+				for (size_t c = 0; c < boxList.size(); c++)
+					sum += transforms.GetComponent(boxEntities[c]).m_position.x + boxList[c].m_corners[0].x;
+			});
+			volatile float sink = sum;
+			(void)sink;
+			return ns;
+		});
+
+		suite.Run("Archetype/Remove", Params("count=%u", count), count, [&]() {
+			ArchetypeStorage removed;
+			BenchArchetypeBodies removedBodies(&removed);
+			BenchArchetypeColliders removedColliders(&removed);
+			for (EntityId e : entities) {
+				removedBodies.Create(e, TransformComponent(), PhysicsComponent());
+				if (e.m_index % 2 == 0)
+					removedColliders.Create(e, box);
+			}
+			return Time([&]() {
+				for (EntityId e : shuffled)
+					removed.Remove(e);
+			});
+		});
+	}
+}
+
+//Collapse is gone, so compare what it did, gathering the live slots of a FreeVector into a packed list,
+//against iterating a System's dense list holding the same number of components
+void BenchFillRatio(BenchmarkSuite& suite) {
+	const unsigned int CAPACITY = 200000;
+	for (unsigned int percent : { 10u, 25u, 50u, 75u, 100u }) {
+		unsigned int live = CAPACITY * percent / 100;
+		FreeVector<TransformComponent> fv;
+		for (unsigned int c = 0; c < CAPACITY; c++)
+			fv.add(TransformComponent());
+		vector<unsigned int> slots(CAPACITY);
+		for (unsigned int c = 0; c < CAPACITY; c++)
+			slots[c] = c;
+		shuffle(slots.begin(), slots.end(), mt19937(percent));
+		for (unsigned int c = live; c < CAPACITY; c++)
+			fv.free(slots[c]);
+
+		suite.Run("FillRatio/FreeVectorGather", Params("capacity=%u,fill=%u%%", CAPACITY, percent), live, [&]() {
+			vector<TransformComponent> packed;
+			packed.reserve(live);
+			return Time([&]() {
+				fv.ForEach([&packed](unsigned int index, TransformComponent& tc) {
+					packed.push_back(tc);
+				});
+			});
+		});
+
+		BenchSystem system;
+		for (unsigned int c = 0; c < live; c++)
+			system.Create(EntityId(c, 0), TransformComponent());
+		suite.Run("FillRatio/SystemIterate", Params("capacity=%u,fill=%u%%", CAPACITY, percent), live, [&]() {
+			float sum = 0;
+			double ns = Time([&]() {
+				for (TransformComponent& tc : system.GetComponentList())
+					sum += tc.m_position.x;
+			});
+			volatile float sink = sum;
+			(void)sink;
+			return ns;
+		});
+	}
+}
+
+//Returns count positions spread over the spawn volume, or packed into a few gaussian clusters
+vector<XMFLOAT3> MakePositions(unsigned int count, bool clustered) {
+	mt19937 rng(count + clustered);
+	vector<XMFLOAT3> positions(count);
+	if (!clustered) {
+		uniform_real_distribution<float> xz(-100, 100);
+		uniform_real_distribution<float> y(0, 100);
+		for (XMFLOAT3& p : positions)
+			p = XMFLOAT3(xz(rng), y(rng), xz(rng));
+		return positions;
+	}
+	const unsigned int CLUSTERS = 8;
+	uniform_real_distribution<float> center(-80, 80);
+	normal_distribution<float> spread(0, 4);
+	XMFLOAT3 centers[CLUSTERS];
+	for (XMFLOAT3& c : centers)
+		c = XMFLOAT3(center(rng), 50 + center(rng) / 2, center(rng));
+	for (unsigned int c = 0; c < count; c++) {
+		XMFLOAT3 base = centers[c % CLUSTERS];
+		positions[c] = XMFLOAT3(base.x + spread(rng), max(0.0f, base.y + spread(rng)), base.z + spread(rng));
+	}
+	return positions;
+}
+
+//A unit cube around the origin
+BoundingBox MakeUnitBox(CollisionType type) {
+	BoundingBox bb;
+	for (unsigned int c = 0; c < 8; c++)
+		bb.m_corners[c] = XMFLOAT3((c & 4) ? -.5f : .5f, (c & 2) ? -.5f : .5f, (c & 1) ? -.5f : .5f);
+	bb.m_collisionType = type;
+	return bb;
+}
+
+//Fills a simulation's systems directly, without the entity table, so collisions never remove anything
+void Populate(Simulation& sim, const vector<XMFLOAT3>& positions, bool colliders) {
+	for (unsigned int c = 0; c < positions.size(); c++) {
+		TransformComponent tc;
+		tc.m_position = positions[c];
+		PhysicsComponent pc;
+		pc.m_gravity = false;
+		pc.m_rotationalVelocity = XMFLOAT3(1, 2, 3);
+		sim.m_transformSystem.Create(EntityId(c, 0), tc, pc);
+		if (colliders)
+			sim.m_collisionSystem.Create(EntityId(c, 0), MakeUnitBox((c & 1) ? CollisionType::test2 : CollisionType::test1));
+	}
+}
+
+#if BENCHMARK >= 0
+//Records test objects one at a time and as a single batch, then plays them back into the systems
+void BenchSpawn(BenchmarkSuite& suite) {
+	Constructors::SetBoundingBox("testObj", MakeUnitBox(CollisionType::test1));
+	for (unsigned int count : { 1000u, 10000u, 100000u }) {
+		suite.Run("Constructors/spawn", Params("count=%u,batch=1", count), count, [&]() {
+			Simulation sim;
+			return Time([&]() {
+				for (unsigned int c = 0; c < count; c++)
+					Constructors::CreateTestObject(&sim);
+				sim.PlaybackCommands();
+			});
+		});
+
+		suite.Run("Constructors/spawn", Params("count=%u,batch=%u", count, count), count, [&]() {
+			Simulation sim;
+			return Time([&]() {
+				Constructors::SpawnTestObjects(&sim, count);
+				sim.PlaybackCommands();
+			});
+		});
+	}
+}
+#endif
+
+//Ticks the transform and collision systems on their own over uniform and clustered layouts
+void BenchTicks(BenchmarkSuite& suite) {
+	const unsigned int TICKS = 5;
+	for (bool clustered : { false, true }) {
+		const char* layout = clustered ? "clustered" : "uniform";
+		for (unsigned int count : { 1000u, 10000u, 100000u, 1000000u }) {
+			string params = Params("count=%u,layout=%s", count, layout);
+			vector<XMFLOAT3> positions = MakePositions(count, clustered);
+
+			suite.Run("TransformSystem/tick", params, count * TICKS, [&]() {
+				Simulation sim;
+				Populate(sim, positions, false);
+				return Time([&]() {
+					for (unsigned int t = 0; t < TICKS; t++)
+						sim.m_transformSystem.Update(&sim, sim.GetTimeStep());
+				});
+			});
+
+			suite.Run("CollisionSystem/tick", params, count * TICKS, [&]() {
+				Simulation sim;
+				Populate(sim, positions, true);
+				return Time([&]() {
+					for (unsigned int t = 0; t < TICKS; t++)
+						sim.m_collisionSystem.Update(&sim, sim.GetTimeStep());
+				});
+			});
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	unsigned int repetitions = 5;
+	string filter;
+	string outPath;
+	string baselinePath;
+	double tolerance = 0.10;
+	for (int a = 1; a < argc; a++) {
+		if (!strcmp(argv[a], "--reps") && a + 1 < argc)
+			repetitions = max(1, atoi(argv[++a]));
+		else if (!strcmp(argv[a], "--filter") && a + 1 < argc)
+			filter = argv[++a];
+		else if (!strcmp(argv[a], "--out") && a + 1 < argc)
+			outPath = argv[++a];
+		else if (!strcmp(argv[a], "--baseline") && a + 1 < argc)
+			baselinePath = argv[++a];
+		else if (!strcmp(argv[a], "--tolerance") && a + 1 < argc)
+			tolerance = atof(argv[++a]);
+		else {
+			fprintf(stderr, "Usage: %s [--reps N] [--filter TEXT] [--out FILE] [--baseline FILE] [--tolerance FRACTION]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	BenchmarkSuite suite(repetitions, filter);
+	BenchFreeVector(suite);
+	BenchClearVector(suite);
+	BenchSystemStorage(suite);
+	BenchArchetypeStorage(suite);
+	BenchFillRatio(suite);
+#if BENCHMARK >= 0
+	BenchSpawn(suite);
+#endif
+	BenchTicks(suite);
+
+	FILE* out = outPath.empty() ? stdout : fopen(outPath.c_str(), "w");
+	if (!out) {
+		fprintf(stderr, "Could not write %s\n", outPath.c_str());
+		return 1;
+	}
+	suite.WriteJson(out);
+	if (out != stdout)
+		fclose(out);
+
+	if (!baselinePath.empty() && suite.Compare(baselinePath, tolerance) > 0)
+		return 2;
+	return 0;
+}
@@ -0,0 +1,135 @@
+//Compares the sparse-set component storage used by System<T> against the previous
+//FreeVector + unordered_map handle layout for lookup and iteration throughput
+//Standalone: g++ -O2 -std=c++14 -I../ECS SparseSetBenchmark.cpp -o SparseSetBenchmark
+
+#include "SparseSet.h"
+#include "FreeVector.h"
+#include "EntityTable.h"
+#include "ComponentData.h"
+#include <unordered_map>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <cstdio>
+
+using namespace std;
+using namespace std::chrono;
+
+//Transform-sized payload
+struct BenchComponent {
+	float m_position[3];
+	float m_rotation[4];
+	float m_scale;
+};
+
+//The storage System<T> used before sparse sets
+struct LegacyStorage {
+	FreeVector<BenchComponent> m_components;
+	vector<ComponentData> m_componentData;
+	unordered_map<EntityId, unsigned int> m_handles;
+
+	void Create(EntityId entityId, const BenchComponent& bc) {
+		unsigned int index = m_components.add(bc);
+		m_handles[entityId] = index;
+		if (index == m_componentData.size())
+			m_componentData.push_back({ true, entityId });
+		else
+			m_componentData[index] = { true, entityId };
+	}
+	void Remove(EntityId entityId) {
+		unsigned int index = m_handles[entityId];
+		m_componentData[index].m_active = false;
+		m_components.free(index);
+		m_handles.erase(entityId);
+	}
+	BenchComponent& GetComponent(EntityId entityId) {
+		return m_components[m_handles[entityId]];
+	}
+};
+
+//Returns the elapsed time of f in nanoseconds
+template <typename F>
+double Time(F f) {
+	auto start = steady_clock::now();
+	f();
+	return static_cast<double>(duration_cast<nanoseconds>(steady_clock::now() - start).count());
+}
+
+void Run(unsigned int count) {
+	mt19937 rng(count);
+	EntityTable entities;
+	LegacyStorage legacy;
+	SparseSet<BenchComponent> sparse;
+	vector<EntityId> live;
+
+	//spawn a quarter more than needed and despawn a random subset, so both layouts see churn
+	unsigned int spawned = count + count / 4;
+	for (unsigned int c = 0; c < spawned; c++) {
+		EntityId e = entities.Create({});
+		BenchComponent bc = { { float(c), 0, 0 }, { 0, 0, 0, 1 }, 1.0f };
+		legacy.Create(e, bc);
+		sparse.Insert(e, bc);
+		live.push_back(e);
+	}
+	shuffle(live.begin(), live.end(), rng);
+	while (live.size() > count) {
+		EntityId e = live.back();
+		live.pop_back();
+		legacy.Remove(e);
+		sparse.Erase(e);
+		entities.Destroy(e);
+	}
+	shuffle(live.begin(), live.end(), rng);
+
+	const int REPEATS = 5;
+	volatile float sink = 0;
+	float acc;
+
+	double legacyLookup = Time([&] {
+		for (int r = 0; r < REPEATS; r++) {
+			acc = 0;
+			for (EntityId e : live)
+				acc += legacy.GetComponent(e).m_scale;
+			sink = acc;
+		}
+	});
+	double sparseLookup = Time([&] {
+		for (int r = 0; r < REPEATS; r++) {
+			acc = 0;
+			for (EntityId e : live)
+				acc += sparse.Get(e).m_scale;
+			sink = acc;
+		}
+	});
+	double legacyIterate = Time([&] {
+		for (int r = 0; r < REPEATS; r++) {
+			acc = 0;
+			for (unsigned int c = 0; c < legacy.m_componentData.size(); c++)
+				if (legacy.m_componentData[c].m_active)
+					acc += legacy.m_components[c].m_position[0];
+			sink = acc;
+		}
+	});
+	double sparseIterate = Time([&] {
+		for (int r = 0; r < REPEATS; r++) {
+			acc = 0;
+			vector<BenchComponent>& dense = sparse.GetDense();
+			for (unsigned int c = 0; c < dense.size(); c++)
+				acc += dense[c].m_position[0];
+			sink = acc;
+		}
+	});
+
+	double ops = static_cast<double>(count) * REPEATS;
+	printf("%9u | %14.1f %14.1f | %14.1f %14.1f\n", count,
+		ops / legacyLookup * 1000.0, ops / sparseLookup * 1000.0,
+		ops / legacyIterate * 1000.0, ops / sparseIterate * 1000.0);
+}
+
+int main() {
+	printf("Throughput in millions of components per second\n");
+	printf("%9s | %14s %14s | %14s %14s\n", "count", "lookup(map)", "lookup(sparse)", "iterate(free)", "iterate(dense)");
+	for (unsigned int count : { 10000u, 100000u, 1000000u })
+		Run(count);
+	return 0;
+}
@@ -0,0 +1,248 @@
+//Compares the counting-sort SpatialGrid used by CollisionSystem against the grid of mutex-guarded per-cell ClearVectors it replaced
+//Times building each grid from the same AABBs, and a pass over every cell counting overlapping pairs like CollisionSystem's pair test
+//Then times CollisionSystem's two broadphases over ticks where a share of the colliders take a small step: rebuilding the grid and
+//pair testing it, against updating SweepAndPrune, whose cost should follow how many colliders moved
+//Usage: spatial_grid_benchmark [--workers N]
+
+#include "SpatialGrid.h"
+#include "SweepAndPrune.h"
+#include "ClearArray.h"
+#include "ClearVector.h"
+#include "JobSystem.h"
+#include <DirectXMath.h>
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+using namespace DirectX;
+
+//Same as CollisionSystem's
+#define DESIRED_OBJECT_DENSITY 1500
+#define REPEATS 5
+#define COHERENT_TICKS 20
+
+typedef vector<CollapsedComponent<TypedMaxMin>> AabbList;
+
+//The grid CollisionSystem filled before SpatialGrid: one ClearVector per cell per type, added to from every thread
+struct LegacyGrid {
+	ClearVector<vector<ClearVector<CollapsedComponent<MaxMin>>>> m_cells;
+
+	void Build(const AabbList& aabbs, XMVECTOR globalMin, XMVECTOR dimensions, float cellDivisions) {
+		for (unsigned int c = 0; c < m_cells.size(); c++)
+			for (unsigned int n = 0; n < CollisionType::NUMTYPES; n++)
+				m_cells[c][n].clear();
+		size_t cellCount = static_cast<size_t>(cellDivisions * cellDivisions * cellDivisions);
+		if (m_cells.size() != cellCount)
+			m_cells.resize(cellCount, vector<ClearVector<CollapsedComponent<MaxMin>>>(CollisionType::NUMTYPES));
+
+		JobSystem::GetDefault().ParallelFor(0, aabbs.size(), 512, [&](size_t c) {
+			const CollapsedComponent<TypedMaxMin>& caabb = aabbs[c];
+			const TypedMaxMin& aabb = caabb.m_component;
+			XMFLOAT3 bb[8] = {
+				{ aabb.m_max.x, aabb.m_max.y, aabb.m_max.z },
+				{ aabb.m_max.x, aabb.m_max.y, aabb.m_min.z },
+				{ aabb.m_max.x, aabb.m_min.y, aabb.m_max.z },
+				{ aabb.m_max.x, aabb.m_min.y, aabb.m_min.z },
+				{ aabb.m_min.x, aabb.m_max.y, aabb.m_max.z },
+				{ aabb.m_min.x, aabb.m_max.y, aabb.m_min.z },
+				{ aabb.m_min.x, aabb.m_min.y, aabb.m_max.z },
+				{ aabb.m_min.x, aabb.m_min.y, aabb.m_min.z }
+			};
+			ClearArray<8, unsigned int> gridIndices;
+			for (auto& point : bb) {
+				XMStoreFloat3(&point, XMVectorFloor(XMVectorDivide(XMVectorSubtract(XMLoadFloat3(&point), globalMin), dimensions)));
+				gridIndices.push(static_cast<unsigned int>(point.z * cellDivisions * cellDivisions + point.y * cellDivisions + point.x), true);
+			}
+			for (unsigned int n = 0; n < gridIndices.size(); n++)
+				m_cells[gridIndices[n]][aabb.m_collisionType].add({ aabb, caabb.m_entityId, caabb.m_handle });
+		}, "Legacy grid fill");
+	}
+};
+
+bool Overlaps(const MaxMin& a, const MaxMin& b) {
+	return a.m_max.x > b.m_min.x && a.m_min.x < b.m_max.x
+		&& a.m_max.y > b.m_min.y && a.m_min.y < b.m_max.y
+		&& a.m_max.z > b.m_min.z && a.m_min.z < b.m_max.z;
+}
+
+//Counts the overlapping test1-test2 and test1-test1 pairs in one cell's buckets, given as anything indexable with a size
+template <typename B1, typename B2>
+size_t CountPairs(B1& test1, B2& test2) {
+	size_t pairs = 0;
+	for (unsigned int c = 0; c < test1.size(); c++) {
+		for (unsigned int n = 0; n < test2.size(); n++)
+			pairs += Overlaps(test1[c].m_component, test2[n].m_component);
+		for (unsigned int n = c + 1; n < test1.size(); n++)
+			pairs += Overlaps(test1[c].m_component, test1[n].m_component);
+	}
+	return pairs;
+}
+
+//Returns the fastest of REPEATS runs of f in milliseconds
+template <typename F>
+double Time(F f) {
+	double best = 1e30;
+	for (int r = 0; r < REPEATS; r++) {
+		auto start = steady_clock::now();
+		f();
+		best = min(best, duration<double, milli>(steady_clock::now() - start).count());
+	}
+	return best;
+}
+
+//about one collider per 27 cubic units, half of each type
+AabbList MakeAabbs(unsigned int count) {
+	mt19937 rng(count);
+	float side = 3.0f * cbrtf(static_cast<float>(count));
+	uniform_real_distribution<float> position(0, side);
+	uniform_real_distribution<float> extent(.25f, .75f);
+	AabbList aabbs(count);
+	for (unsigned int c = 0; c < count; c++) {
+		XMFLOAT3 center(position(rng), position(rng), position(rng));
+		float e = extent(rng);
+		TypedMaxMin& aabb = aabbs[c].m_component;
+		aabb.m_max = XMFLOAT3(center.x + e, center.y + e, center.z + e);
+		aabb.m_min = XMFLOAT3(center.x - e, center.y - e, center.z - e);
+		aabb.m_collisionType = (c & 1) ? CollisionType::test2 : CollisionType::test1;
+		aabbs[c].m_entityId = EntityId(c, 0);
+		aabbs[c].m_handle = c;
+	}
+	return aabbs;
+}
+
+//Gets the grid CollisionSystem would use for the AABBs
+void GetGrid(const AabbList& aabbs, XMVECTOR& globalMin, XMVECTOR& dimensions, float& cellDivisions) {
+	XMVECTOR globalMax = XMVectorReplicate(-FLT_MAX);
+	globalMin = XMVectorReplicate(FLT_MAX);
+	for (const CollapsedComponent<TypedMaxMin>& caabb : aabbs) {
+		globalMax = XMVectorMax(globalMax, XMLoadFloat3(&caabb.m_component.m_max));
+		globalMin = XMVectorMin(globalMin, XMLoadFloat3(&caabb.m_component.m_min));
+	}
+	globalMax = XMVectorAdd(globalMax, XMVectorReplicate(1));
+	globalMin = XMVectorSubtract(globalMin, XMVectorReplicate(1));
+	float count = static_cast<float>(aabbs.size());
+	cellDivisions = min(ceilf(count / DESIRED_OBJECT_DENSITY), max(1.0f, floorf(cbrtf(count))));
+	dimensions = XMVectorScale(XMVectorSubtract(globalMax, globalMin), 1.0f / cellDivisions);
+}
+
+size_t CountGridPairs(const SpatialGrid& grid) {
+	size_t pairs = 0;
+	for (size_t c = 0; c < grid.GetCellCount(); c++) {
+		Span<const CollapsedComponent<MaxMin>> test1 = grid.Get(c, CollisionType::test1);
+		Span<const CollapsedComponent<MaxMin>> test2 = grid.Get(c, CollisionType::test2);
+		pairs += CountPairs(test1, test2);
+	}
+	return pairs;
+}
+
+void Run(unsigned int count) {
+	AabbList aabbs = MakeAabbs(count);
+	XMVECTOR globalMin, dimensions;
+	float cellDivisions;
+	GetGrid(aabbs, globalMin, dimensions, cellDivisions);
+	XMFLOAT3 origin, cellSize;
+	XMStoreFloat3(&origin, globalMin);
+	XMStoreFloat3(&cellSize, dimensions);
+
+	LegacyGrid legacy;
+	SpatialGrid grid;
+	//one untimed build each, so neither pays for growing its buffers in the timings
+	legacy.Build(aabbs, globalMin, dimensions, cellDivisions);
+	grid.Build(aabbs, origin, cellSize, static_cast<unsigned int>(cellDivisions));
+
+	double legacyBuild = Time([&] {
+		legacy.Build(aabbs, globalMin, dimensions, cellDivisions);
+	});
+	double gridBuild = Time([&] {
+		grid.Build(aabbs, origin, cellSize, static_cast<unsigned int>(cellDivisions));
+	});
+
+	size_t legacyPairs = 0, gridPairs = 0;
+	double legacyTest = Time([&] {
+		legacyPairs = 0;
+		for (unsigned int c = 0; c < legacy.m_cells.size(); c++)
+			legacyPairs += CountPairs(legacy.m_cells[c][CollisionType::test1], legacy.m_cells[c][CollisionType::test2]);
+	});
+	double gridTest = Time([&] {
+		gridPairs = CountGridPairs(grid);
+	});
+
+	printf("%9u %9.0f | %12.3f %12.3f | %12.3f %12.3f | %10zu%s\n", count, cellDivisions * cellDivisions * cellDivisions,
+		legacyBuild, gridBuild, legacyTest, gridTest, gridPairs, legacyPairs == gridPairs ? "" : " MISMATCH");
+}
+
+//Moves a share of the colliders a small step each tick and prints the average ms per tick of the grid and of sweep and prune
+void RunCoherent(unsigned int count, float moving) {
+	AabbList aabbs = MakeAabbs(count);
+	XMVECTOR globalMin, dimensions;
+	float cellDivisions;
+	GetGrid(aabbs, globalMin, dimensions, cellDivisions);
+	XMFLOAT3 origin, cellSize;
+	XMStoreFloat3(&origin, globalMin);
+	XMStoreFloat3(&cellSize, dimensions);
+
+	SpatialGrid grid;
+	SweepAndPrune sweepAndPrune;
+	sweepAndPrune.SetPairFilter(CollisionType::test1, CollisionType::test2, true);
+	sweepAndPrune.SetPairFilter(CollisionType::test1, CollisionType::test1, true);
+	//the first update adds every box, which isn't what's being compared
+	grid.Build(aabbs, origin, cellSize, static_cast<unsigned int>(cellDivisions));
+	sweepAndPrune.Update(aabbs);
+
+	//steps stay well inside the grid's padding over every tick
+	mt19937 rng(count + 1);
+	uniform_real_distribution<float> step(-.02f, .02f);
+	unsigned int movingCount = static_cast<unsigned int>(count * moving);
+	double gridTime = 0, sweepTime = 0;
+	size_t gridPairs = 0;
+	for (unsigned int t = 0; t < COHERENT_TICKS; t++) {
+		for (unsigned int c = 0; c < movingCount; c++) {
+			TypedMaxMin& aabb = aabbs[(static_cast<size_t>(t) * movingCount + c) % count].m_component;
+			XMFLOAT3 offset(step(rng), step(rng), step(rng));
+			aabb.m_max = XMFLOAT3(aabb.m_max.x + offset.x, aabb.m_max.y + offset.y, aabb.m_max.z + offset.z);
+			aabb.m_min = XMFLOAT3(aabb.m_min.x + offset.x, aabb.m_min.y + offset.y, aabb.m_min.z + offset.z);
+		}
+		auto start = steady_clock::now();
+		grid.Build(aabbs, origin, cellSize, static_cast<unsigned int>(cellDivisions));
+		gridPairs = CountGridPairs(grid);
+		gridTime += duration<double, milli>(steady_clock::now() - start).count();
+		start = steady_clock::now();
+		sweepAndPrune.Update(aabbs);
+		sweepTime += duration<double, milli>(steady_clock::now() - start).count();
+	}
+
+	//the grid counts a pair once for every cell the two share, so its count is only a bound on sweep and prune's
+	printf("%9u %8.0f%% | %12.3f %12.3f | %10zu %10zu\n", count, moving * 100, gridTime / COHERENT_TICKS, sweepTime / COHERENT_TICKS,
+		gridPairs, sweepAndPrune.GetPairCount());
+}
+
+int main(int argc, char** argv) {
+	for (int a = 1; a < argc; a++) {
+		if (!strcmp(argv[a], "--workers") && a + 1 < argc)
+			JobSystem::SetDefaultWorkerCount(static_cast<unsigned int>(atoi(argv[++a])));
+		else {
+			fprintf(stderr, "Usage: %s [--workers N]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	printf("Best of %d runs in ms on %u threads\n", REPEATS, JobSystem::GetDefault().GetThreadCount());
+	printf("%9s %9s | %12s %12s | %12s %12s | %10s\n", "AABBs", "cells", "build(old)", "build(new)", "pairs(old)", "pairs(new)", "pairs");
+	for (unsigned int count : { 50000u, 200000u, 1000000u })
+		Run(count);
+
+	printf("\nAverage of %d ticks in ms, with a share of the colliders moving each tick\n", COHERENT_TICKS);
+	printf("%9s %9s | %12s %12s | %10s %10s\n", "AABBs", "moving", "grid", "sweep", "pairs(grid)", "pairs(sap)");
+	for (unsigned int count : { 50000u, 200000u })
+		for (float moving : { 0.0f, .01f, .1f, 1.0f })
+			RunCoherent(count, moving);
+	return 0;
+}
@@ -0,0 +1,305 @@
+//Runs the game's BENCHMARK spawn workload on the headless simulation for a number of ticks and prints per-system timings
+//Usage: swamped_bench [--ticks N] [--workers N] [--serial] [--models DIR] [--trace FILE] [--load FILE] [--save FILE] [--seed N] [--record FILE] [--replay FILE] [--allocations] [--assert-no-allocations WARMUP] [--broadphase grid|sap] [--no-spawn]
+//--load starts from a snapshot instead of an empty scene, --save writes one after the last tick
+//--record writes every frame's input to a file, --replay runs the frames of one back to back instead of --ticks one-step frames
+//Replaying a recording from the scene it started in runs the same simulation every time, so builds can be compared on it
+//--allocations prints every frame that allocated and the zones that did, and --assert-no-allocations fails the run if any frame after
+//the first WARMUP allocates; both need a build configured with -DSWAMPED_TRACK_ALLOCATIONS=ON
+//--broadphase picks the collision broadphase, overriding the one a loaded scene saved
+//--no-spawn stops the workload spawning, so a loaded scene settles: ./swamped_bench --load scene.bin --no-spawn --assert-no-allocations 100
+//Profile with: perf record -g ./swamped_bench --ticks 1200
+
+#include "Simulation.h"
+#include "Constructors.h"
+#include "JobSystem.h"
+#include "FrameArena.h"
+#include "Profiler.h"
+#include "AllocationTracker.h"
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+//Builds the bounding box ContentManager would generate for an OBJ file, without loading the mesh
+bool LoadObjBounds(const string& path, BoundingBox& bb) {
+	ifstream obj(path);
+	if (!obj.good())
+		return false;
+
+	XMFLOAT3 maxFloat(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	XMFLOAT3 minFloat(FLT_MAX, FLT_MAX, FLT_MAX);
+	string line;
+	while (getline(obj, line)) {
+		XMFLOAT3 pos;
+		if (line.size() < 2 || line[0] != 'v' || line[1] != ' ' || sscanf(line.c_str(), "v %f %f %f", &pos.x, &pos.y, &pos.z) != 3)
+			continue;
+		//ContentManager bounds the negated positions
+		maxFloat = XMFLOAT3(max(maxFloat.x, -pos.x), max(maxFloat.y, -pos.y), max(maxFloat.z, -pos.z));
+		minFloat = XMFLOAT3(min(minFloat.x, -pos.x), min(minFloat.y, -pos.y), min(minFloat.z, -pos.z));
+	}
+	XMFLOAT3 corners[8] = {
+		{ maxFloat.x, maxFloat.y, maxFloat.z },
+		{ maxFloat.x, maxFloat.y, minFloat.z },
+		{ maxFloat.x, minFloat.y, maxFloat.z },
+		{ maxFloat.x, minFloat.y, minFloat.z },
+		{ minFloat.x, maxFloat.y, maxFloat.z },
+		{ minFloat.x, maxFloat.y, minFloat.z },
+		{ minFloat.x, minFloat.y, maxFloat.z },
+		{ minFloat.x, minFloat.y, minFloat.z }
+	};
+	memcpy(bb.m_corners, corners, sizeof(corners));
+	return true;
+}
+
+//Falls back to a unit cube when the model can't be read
+BoundingBox GetPrefabBounds(const string& modelDirectory, const char* model) {
+	BoundingBox bb = {};
+	if (LoadObjBounds(modelDirectory + "/" + model, bb))
+		return bb;
+	fprintf(stderr, "Could not read %s/%s, using a unit cube\n", modelDirectory.c_str(), model);
+	for (unsigned int c = 0; c < 8; c++)
+		bb.m_corners[c] = XMFLOAT3((c & 4) ? -.5f : .5f, (c & 2) ? -.5f : .5f, (c & 1) ? -.5f : .5f);
+	return bb;
+}
+
+//Prints a frame's allocations, by thread and by zone
+void PrintFrameAllocations(unsigned int frame, AllocationCounts total, vector<ZoneAllocations>& zones) {
+	printf("frame %u: %llu allocations, %llu bytes\n", frame, static_cast<unsigned long long>(total.m_count), static_cast<unsigned long long>(total.m_bytes));
+	for (unsigned int t = 0; t < AllocationTracker::GetThreadCount(); t++) {
+		const char* name;
+		AllocationCounts thread = AllocationTracker::GetFrameCounts(t, &name);
+		if (thread.m_count > 0)
+			printf("  thread %-12s %8llu %10llu bytes\n", name ? name : "(unnamed)",
+				static_cast<unsigned long long>(thread.m_count), static_cast<unsigned long long>(thread.m_bytes));
+	}
+	uint64_t inZones = 0;
+	Profiler::GetFrameAllocations(zones);
+	for (const ZoneAllocations& zone : zones) {
+		printf("  zone   %-12s %8llu %10llu bytes\n", zone.m_name,
+			static_cast<unsigned long long>(zone.m_allocations.m_count), static_cast<unsigned long long>(zone.m_allocations.m_bytes));
+		inZones += zone.m_allocations.m_count;
+	}
+	if (inZones < total.m_count)
+		printf("  outside any zone   %8llu\n", static_cast<unsigned long long>(total.m_count - inZones));
+}
+
+int main(int argc, char** argv) {
+	unsigned int ticks = 600;
+	unsigned int workers = 0;
+	bool serial = false;
+	string modelDirectory = SWAMPED_MODEL_DIR;
+	string tracePath;
+	string loadPath;
+	string savePath;
+	string recordPath;
+	string replayPath;
+	uint32_t seed = 1;
+	bool reportAllocations = false;
+	bool assertNoAllocations = false;
+	bool spawning = true;
+	unsigned int allocationWarmup = 0;
+	const char* broadphase = nullptr;
+	for (int a = 1; a < argc; a++) {
+		if (!strcmp(argv[a], "--ticks") && a + 1 < argc)
+			ticks = static_cast<unsigned int>(atoi(argv[++a]));
+		else if (!strcmp(argv[a], "--workers") && a + 1 < argc)
+			workers = static_cast<unsigned int>(atoi(argv[++a]));
+		else if (!strcmp(argv[a], "--serial"))
+			serial = true;
+		else if (!strcmp(argv[a], "--models") && a + 1 < argc)
+			modelDirectory = argv[++a];
+		else if (!strcmp(argv[a], "--trace") && a + 1 < argc)
+			tracePath = argv[++a];
+		else if (!strcmp(argv[a], "--load") && a + 1 < argc)
+			loadPath = argv[++a];
+		else if (!strcmp(argv[a], "--save") && a + 1 < argc)
+			savePath = argv[++a];
+		else if (!strcmp(argv[a], "--seed") && a + 1 < argc)
+			seed = static_cast<uint32_t>(strtoul(argv[++a], nullptr, 10));
+		else if (!strcmp(argv[a], "--record") && a + 1 < argc)
+			recordPath = argv[++a];
+		else if (!strcmp(argv[a], "--replay") && a + 1 < argc)
+			replayPath = argv[++a];
+		else if (!strcmp(argv[a], "--allocations"))
+			reportAllocations = true;
+		else if (!strcmp(argv[a], "--assert-no-allocations") && a + 1 < argc) {
+			assertNoAllocations = true;
+			allocationWarmup = static_cast<unsigned int>(atoi(argv[++a]));
+		}
+		else if (!strcmp(argv[a], "--no-spawn"))
+			spawning = false;
+		else if (!strcmp(argv[a], "--broadphase") && a + 1 < argc && (!strcmp(argv[a + 1], "grid") || !strcmp(argv[a + 1], "sap")))
+			broadphase = argv[++a];
+		else {
+			fprintf(stderr, "Usage: %s [--ticks N] [--workers N] [--serial] [--models DIR] [--trace FILE] [--load FILE] [--save FILE] [--seed N] [--record FILE] [--replay FILE] [--allocations] [--assert-no-allocations WARMUP] [--broadphase grid|sap] [--no-spawn]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if ((reportAllocations || assertNoAllocations) && !AllocationTracker::IsEnabled()) {
+		fprintf(stderr, "This build doesn't count allocations; configure it with -DSWAMPED_TRACK_ALLOCATIONS=ON\n");
+		return 1;
+	}
+
+	JobSystem::SetDefaultWorkerCount(workers);
+	Constructors::SetBoundingBox("testObj", GetPrefabBounds(modelDirectory, "cone.obj"));
+	Constructors::SetBoundingBox("testObj2", GetPrefabBounds(modelDirectory, "cube.obj"));
+
+	Simulation sim;
+	sim.GetScheduler().SetMode(serial ? ScheduleMode::Serial : ScheduleMode::Parallel);
+	sim.SetSpawning(spawning);
+	if (!loadPath.empty()) {
+		auto loadStart = steady_clock::now();
+		if (!sim.LoadSnapshot(loadPath)) {
+			fprintf(stderr, "Could not load %s\n", loadPath.c_str());
+			return 1;
+		}
+		printf("loaded %zu entities from %s in %.2f ms\n", sim.GetEntityCount(), loadPath.c_str(), duration<double, milli>(steady_clock::now() - loadStart).count());
+	}
+	else {
+		Constructors::CreateGround(&sim, XMFLOAT3(0, 0, 0), 1.0f);
+		EntityRef player = Constructors::CreatePlayer(&sim);
+		sim.PlaybackCommands();
+		sim.SetPlayer(sim.GetCommands().Resolve(player));
+	}
+	if (broadphase != nullptr)
+		sim.m_collisionSystem.SetBroadphase(!strcmp(broadphase, "sap") ? Broadphase::SweepAndPrune : Broadphase::Grid);
+
+	//without a recording, every frame is one step with no input
+	float dt = sim.GetTimeStep();
+	vector<FrameInput> frames;
+	if (!replayPath.empty()) {
+		ReplayReader reader;
+		if (!reader.Open(replayPath, dt)) {
+			fprintf(stderr, "Could not replay %s; it must be recorded by a build with BENCHMARK %d\n", replayPath.c_str(), BENCHMARK);
+			return 1;
+		}
+		frames = reader.GetFrames();
+	}
+	else {
+		for (unsigned int t = 0; t < ticks; t++) {
+			FrameInput frame = {};
+			frame.m_dt = dt;
+			frame.m_totalTime = t * dt;
+			frame.m_ticks = 1;
+			frame.m_seed = seed + t;
+			frames.push_back(frame);
+		}
+	}
+	ticks = 0;
+	for (const FrameInput& frame : frames)
+		ticks += frame.m_ticks;
+
+	ReplayRecorder recorder;
+	if (!recordPath.empty() && !recorder.Open(recordPath, dt)) {
+		fprintf(stderr, "Could not write %s\n", recordPath.c_str());
+		return 1;
+	}
+
+	//a trace covers every frame
+	Profiler::SetThreadName("Main");
+	if (!tracePath.empty())
+		Profiler::BeginCapture(static_cast<unsigned int>(frames.size()));
+
+	double criticalPath = 0;
+	double stepTime = 0;
+	double compactTime = 0;
+	double longestCompact = 0;
+	vector<double> frameTimes;
+	frameTimes.reserve(frames.size());
+	//reserved up front, so the bench itself doesn't allocate between frames
+	vector<ZoneAllocations> zoneAllocations;
+	zoneAllocations.reserve(256);
+	AllocationCounts allocations = {};
+	unsigned int allocatingFrames = 0;
+	unsigned int steadyAllocatingFrames = 0;
+	unsigned int frameIndex = 0;
+	auto start = steady_clock::now();
+	for (const FrameInput& frame : frames) {
+		auto frameStart = steady_clock::now();
+		recorder.Record(frame);
+		sim.RunFrame(frame);
+		auto compactStart = steady_clock::now();
+		sim.Compact();
+		double compactMs = duration<double, milli>(steady_clock::now() - compactStart).count();
+		compactTime += compactMs;
+		longestCompact = max(longestCompact, compactMs);
+		FrameArena::ResetAll();
+		frameTimes.push_back(duration<double, milli>(steady_clock::now() - frameStart).count());
+		Profiler::MarkFrame();
+		criticalPath += sim.GetScheduler().GetCriticalPathTime();
+		stepTime += sim.GetScheduler().GetWallTime();
+
+		AllocationCounts frameAllocations = AllocationTracker::GetFrameCounts();
+		allocations.m_count += frameAllocations.m_count;
+		allocations.m_bytes += frameAllocations.m_bytes;
+		if (frameAllocations.m_count > 0) {
+			allocatingFrames++;
+			bool steady = frameIndex >= allocationWarmup;
+			if (steady)
+				steadyAllocatingFrames++;
+			if (reportAllocations || (assertNoAllocations && steady))
+				PrintFrameAllocations(frameIndex, frameAllocations, zoneAllocations);
+		}
+		frameIndex++;
+	}
+	double total = duration<double, milli>(steady_clock::now() - start).count();
+	if (recorder.IsOpen() && !recorder.Close()) {
+		fprintf(stderr, "Could not write %s\n", recordPath.c_str());
+		return 1;
+	}
+
+	printf("swamped_bench: %zu frames, %u ticks, %u threads, %s schedule, %s kernels, BENCHMARK %d\n",
+		frames.size(), ticks, JobSystem::GetDefault().GetThreadCount(), serial ? "serial" : "parallel",
+		TransformKernels::GetSimdLevelName(sim.m_transformSystem.GetSimdLevel()), BENCHMARK);
+	printf("entities at end: %zu (transforms %zu, colliders %zu)\n", sim.GetEntityCount(), sim.m_transformSystem.GetCount(), sim.m_collisionSystem.GetCount());
+	printf("%-16s %12s %12s\n", "", "total ms", "ms/tick");
+	auto row = [ticks](const char* name, double ms) {
+		printf("%-16s %12.2f %12.4f\n", name, ms, ms / ticks);
+	};
+	row("transforms", sim.m_transformSystem.GetTotalTime());
+	row("collisions", sim.m_collisionSystem.GetTotalTime());
+	row("particles", sim.m_particleSystem.GetTotalTime());
+	row("step", stepTime);
+	row("compaction", compactTime);
+	row("critical path", criticalPath);
+	row("total", total);
+	printf("longest compaction %.4f ms\n", longestCompact);
+	if (!frameTimes.empty()) {
+		sort(frameTimes.begin(), frameTimes.end());
+		printf("frame ms: median %.4f, 99th percentile %.4f, worst %.4f\n",
+			frameTimes[frameTimes.size() / 2], frameTimes[frameTimes.size() * 99 / 100], frameTimes.back());
+	}
+
+	if (AllocationTracker::IsEnabled())
+		printf("allocations: %llu (%llu bytes) in %u of %zu frames\n", static_cast<unsigned long long>(allocations.m_count),
+			static_cast<unsigned long long>(allocations.m_bytes), allocatingFrames, frames.size());
+
+	if (!savePath.empty()) {
+		auto saveStart = steady_clock::now();
+		if (!sim.SaveSnapshot(savePath)) {
+			fprintf(stderr, "Could not write %s\n", savePath.c_str());
+			return 1;
+		}
+		printf("saved %zu entities to %s in %.2f ms\n", sim.GetEntityCount(), savePath.c_str(), duration<double, milli>(steady_clock::now() - saveStart).count());
+	}
+
+	if (!tracePath.empty() && !Profiler::WriteChromeTrace(tracePath)) {
+		fprintf(stderr, "Could not write %s\n", tracePath.c_str());
+		return 1;
+	}
+
+	if (assertNoAllocations && steadyAllocatingFrames > 0) {
+		fprintf(stderr, "%u frames after the first %u allocated\n", steadyAllocatingFrames, allocationWarmup);
+		return 2;
+	}
+	return 0;
+}
@@ -0,0 +1,117 @@
+//Compares the TransformSystem integration kernels against the array-of-structs DirectXMath path they replaced
+//Reports entities integrated per millisecond on one thread and the largest deviation from the reference after a second of ticks
+//Standalone: g++ -O2 -std=c++14 -I../ECS TransformKernelBenchmark.cpp ../ECS/TransformKernels.cpp -o TransformKernelBenchmark
+
+#include "TransformKernels.h"
+#include <DirectXMath.h>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdio>
+#include <cmath>
+
+using namespace std;
+using namespace std::chrono;
+using namespace DirectX;
+
+#define TICKS 60
+#define GRAVITY -15.0f
+
+//The per-entity body TransformSystem::Update ran before the streams existed
+void IntegrateReference(vector<TransformComponent>& tcs, vector<PhysicsComponent>& pcs, float dt) {
+	XMFLOAT3 gravity(0, GRAVITY, 0);
+	for (size_t c = 0; c < tcs.size(); c++) {
+		TransformComponent& tc = tcs[c];
+		PhysicsComponent& pc = pcs[c];
+		XMVECTOR position = XMLoadFloat3(&tc.m_position);
+		XMVECTOR rotation = XMLoadFloat4(&tc.m_rotation);
+		XMVECTOR velocity = XMLoadFloat3(&pc.m_velocity);
+		XMVECTOR acceleration = XMLoadFloat3(&pc.m_acceleration);
+		if (pc.m_gravity)
+			acceleration = XMVectorAdd(acceleration, XMLoadFloat3(&gravity));
+		XMVECTOR rotationalVelocity = XMLoadFloat3(&pc.m_rotationalVelocity);
+		if (XMVectorGetX(XMVector3Length(rotationalVelocity)) != 0)
+			rotation = XMQuaternionSlerp(rotation, XMQuaternionMultiply(rotation, XMQuaternionRotationAxis(rotationalVelocity, XMVectorGetX(XMVector3Length(rotationalVelocity)))), dt);
+		velocity = XMVectorAdd(velocity, XMVectorScale(acceleration, dt));
+		position = XMVectorAdd(position, XMVectorScale(velocity, dt));
+		XMStoreFloat3(&pc.m_velocity, velocity);
+		XMStoreFloat3(&tc.m_position, position);
+		XMStoreFloat4(&tc.m_rotation, rotation);
+	}
+}
+
+//Spawns entities like Constructors::CreateTestObject/CreateTestObject2, half of them spinning
+void Populate(size_t count, vector<TransformComponent>& tcs, vector<PhysicsComponent>& pcs) {
+	mt19937 rng(1);
+	uniform_real_distribution<float> position(-100, 100);
+	uniform_real_distribution<float> spin(-30, 30);
+	tcs.resize(count);
+	pcs.resize(count);
+	for (size_t c = 0; c < count; c++) {
+		tcs[c].m_position = XMFLOAT3(position(rng), position(rng), position(rng));
+		if (c % 2)
+			pcs[c].m_rotationalVelocity = XMFLOAT3(spin(rng), spin(rng), spin(rng));
+	}
+}
+
+float MaxPositionError(const vector<TransformComponent>& tcs, const TransformStreams& s) {
+	float error = 0;
+	for (size_t c = 0; c < tcs.size(); c++) {
+		error = fmaxf(error, fabsf(tcs[c].m_position.x - s.Get(POSITION_X)[c]));
+		error = fmaxf(error, fabsf(tcs[c].m_position.y - s.Get(POSITION_Y)[c]));
+		error = fmaxf(error, fabsf(tcs[c].m_position.z - s.Get(POSITION_Z)[c]));
+	}
+	return error;
+}
+
+//q and -q are the same rotation, so compare against whichever sign is closer
+float MaxRotationError(const vector<TransformComponent>& tcs, const TransformStreams& s) {
+	float error = 0;
+	for (size_t c = 0; c < tcs.size(); c++) {
+		const XMFLOAT4& r = tcs[c].m_rotation;
+		float q[4] = { s.Get(ROTATION_X)[c], s.Get(ROTATION_Y)[c], s.Get(ROTATION_Z)[c], s.Get(ROTATION_W)[c] };
+		float same = fmaxf(fmaxf(fabsf(r.x - q[0]), fabsf(r.y - q[1])), fmaxf(fabsf(r.z - q[2]), fabsf(r.w - q[3])));
+		float flipped = fmaxf(fmaxf(fabsf(r.x + q[0]), fabsf(r.y + q[1])), fmaxf(fabsf(r.z + q[2]), fabsf(r.w + q[3])));
+		error = fmaxf(error, fminf(same, flipped));
+	}
+	return error;
+}
+
+void Run(size_t count) {
+	float dt = 1.0f / 60;
+	vector<TransformComponent> tcs;
+	vector<PhysicsComponent> pcs;
+	Populate(count, tcs, pcs);
+
+	TransformStreams initial;
+	initial.Reserve(count);
+	for (size_t c = 0; c < count; c++)
+		initial.PushBack(tcs[c], pcs[c]);
+
+	auto start = steady_clock::now();
+	for (int t = 0; t < TICKS; t++)
+		IntegrateReference(tcs, pcs, dt);
+	double referenceMs = duration_cast<nanoseconds>(steady_clock::now() - start).count() / 1e6;
+	printf("%9zu %-9s %12.0f entities/ms\n", count, "XMath", count * TICKS / referenceMs);
+
+	SimdLevel supported = TransformKernels::GetSupportedSimdLevel();
+	IntegrationParams params = { dt, GRAVITY };
+	for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE, SimdLevel::AVX2 }) {
+		if (level > supported)
+			continue;
+		TransformStreams streams = initial;
+		start = steady_clock::now();
+		for (int t = 0; t < TICKS; t++)
+			TransformKernels::Integrate(level, streams, 0, count, params);
+		double ms = duration_cast<nanoseconds>(steady_clock::now() - start).count() / 1e6;
+		printf("%9zu %-9s %12.0f entities/ms  %5.2fx  max error: position %.2e rotation %.2e\n", count,
+			TransformKernels::GetSimdLevelName(level), count * TICKS / ms, referenceMs / ms,
+			MaxPositionError(tcs, streams), MaxRotationError(tcs, streams));
+	}
+}
+
+int main() {
+	for (size_t count : { 10000, 100000, 1000000 })
+		Run(count);
+	return 0;
+}
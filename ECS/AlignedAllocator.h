@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+//An STL allocator that aligns every block, so SIMD kernels can stream through vectors on register boundaries
+template <typename T, size_t Alignment>
+class AlignedAllocator {
+public:
+	typedef T value_type;
+	template <typename U>
+	struct rebind {
+		typedef AlignedAllocator<U, Alignment> other;
+	};
+
+	AlignedAllocator() {}
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+	T* allocate(size_t n) {
+		//aligned_alloc requires the size to be a multiple of the alignment
+		size_t bytes = (n * sizeof(T) + Alignment - 1) / Alignment * Alignment;
+#ifdef _WIN32
+		void* block = _aligned_malloc(bytes, Alignment);
+#else
+		void* block = aligned_alloc(Alignment, bytes);
+#endif
+		if (block == nullptr)
+			throw std::bad_alloc();
+		return static_cast<T*>(block);
+	}
+
+	void deallocate(T* block, size_t) {
+#ifdef _WIN32
+		_aligned_free(block);
+#else
+		free(block);
+#endif
+	}
+
+	template <typename U>
+	bool operator==(const AlignedAllocator<U, Alignment>&) const {
+		return true;
+	}
+	template <typename U>
+	bool operator!=(const AlignedAllocator<U, Alignment>&) const {
+		return false;
+	}
+};
+
+//A vector whose storage starts on a 32 byte boundary (one AVX register)
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T, 32>>;
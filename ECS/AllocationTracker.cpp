@@ -0,0 +1,143 @@
+#include "AllocationTracker.h"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+using namespace std;
+
+namespace {
+	//One thread's counters
+	//Everything here is constant initialized, so allocations made before main are counted too
+	struct ThreadAllocations {
+		atomic<uint64_t> m_count;						//Written by the owning thread
+		atomic<uint64_t> m_bytes;
+		uint64_t m_markedCount;							//Totals at the last frame marker
+		uint64_t m_markedBytes;
+		AllocationCounts m_frame;						//Made between the last two frame markers
+		char m_name[32];
+		atomic<bool> m_named;
+	};
+
+	ThreadAllocations s_threads[ALLOCATION_TRACKER_THREADS];
+	atomic<unsigned int> s_threadCount(0);
+	AllocationCounts s_frame;
+
+	thread_local ThreadAllocations* t_allocations = nullptr;
+
+	ThreadAllocations& GetThreadAllocations() {
+		if (t_allocations)
+			return *t_allocations;
+		unsigned int slot = s_threadCount.fetch_add(1, memory_order_relaxed);
+		if (slot >= ALLOCATION_TRACKER_THREADS) {
+			s_threadCount.store(ALLOCATION_TRACKER_THREADS, memory_order_relaxed);
+			slot = ALLOCATION_TRACKER_THREADS - 1;
+		}
+		t_allocations = &s_threads[slot];
+		return *t_allocations;
+	}
+
+#ifdef SWAMPED_TRACK_ALLOCATIONS
+	void* CountedAllocate(size_t bytes) {
+		ThreadAllocations& thread = GetThreadAllocations();
+		thread.m_count.fetch_add(1, memory_order_relaxed);
+		thread.m_bytes.fetch_add(bytes, memory_order_relaxed);
+		return malloc(bytes ? bytes : 1);
+	}
+#endif
+}
+
+AllocationCounts AllocationTracker::GetThreadCounts()
+{
+	ThreadAllocations& thread = GetThreadAllocations();
+	return { thread.m_count.load(memory_order_relaxed), thread.m_bytes.load(memory_order_relaxed) };
+}
+
+void AllocationTracker::SetThreadName(const char * name)
+{
+	ThreadAllocations& thread = GetThreadAllocations();
+	size_t length = strnlen(name, sizeof(thread.m_name) - 1);
+	memcpy(thread.m_name, name, length);
+	thread.m_name[length] = '\0';
+	thread.m_named.store(true, memory_order_release);
+}
+
+void AllocationTracker::MarkFrame()
+{
+	s_frame = {};
+	unsigned int threads = GetThreadCount();
+	for (unsigned int t = 0; t < threads; t++) {
+		ThreadAllocations& thread = s_threads[t];
+		uint64_t count = thread.m_count.load(memory_order_relaxed);
+		uint64_t bytes = thread.m_bytes.load(memory_order_relaxed);
+		thread.m_frame = { count - thread.m_markedCount, bytes - thread.m_markedBytes };
+		thread.m_markedCount = count;
+		thread.m_markedBytes = bytes;
+		s_frame.m_count += thread.m_frame.m_count;
+		s_frame.m_bytes += thread.m_frame.m_bytes;
+	}
+}
+
+AllocationCounts AllocationTracker::GetFrameCounts()
+{
+	return s_frame;
+}
+
+unsigned int AllocationTracker::GetThreadCount()
+{
+	unsigned int threads = s_threadCount.load(memory_order_relaxed);
+	return threads < ALLOCATION_TRACKER_THREADS ? threads : ALLOCATION_TRACKER_THREADS;
+}
+
+AllocationCounts AllocationTracker::GetFrameCounts(unsigned int thread, const char ** name)
+{
+	*name = s_threads[thread].m_named.load(memory_order_acquire) ? s_threads[thread].m_name : nullptr;
+	return s_threads[thread].m_frame;
+}
+
+#ifdef SWAMPED_TRACK_ALLOCATIONS
+//Replacements for the global allocation functions; the placement forms can't be replaced and don't allocate
+void* operator new(size_t bytes) {
+	if (void* memory = CountedAllocate(bytes))
+		return memory;
+	throw bad_alloc();
+}
+
+void* operator new[](size_t bytes) {
+	if (void* memory = CountedAllocate(bytes))
+		return memory;
+	throw bad_alloc();
+}
+
+void* operator new(size_t bytes, const nothrow_t&) noexcept {
+	return CountedAllocate(bytes);
+}
+
+void* operator new[](size_t bytes, const nothrow_t&) noexcept {
+	return CountedAllocate(bytes);
+}
+
+void operator delete(void* memory) noexcept {
+	free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+	free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+	free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+	free(memory);
+}
+
+void operator delete(void* memory, const nothrow_t&) noexcept {
+	free(memory);
+}
+
+void operator delete[](void* memory, const nothrow_t&) noexcept {
+	free(memory);
+}
+#endif
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+//Threads that get their own counters; any more share the last slot
+#define ALLOCATION_TRACKER_THREADS 64
+
+//Heap allocations and the bytes they asked for
+struct AllocationCounts {
+	uint64_t m_count;
+	uint64_t m_bytes;
+};
+
+//Counts heap allocations per thread and per frame
+//Only builds that define SWAMPED_TRACK_ALLOCATIONS count anything, since they replace the global operator new and delete;
+//in other builds every count is zero
+class AllocationTracker {
+public:
+	static constexpr bool IsEnabled() {
+#ifdef SWAMPED_TRACK_ALLOCATIONS
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	//Allocations made by the calling thread since it started
+	static AllocationCounts GetThreadCounts();
+
+	//Names the calling thread in reports; longer names are cut off at 31 characters
+	static void SetThreadName(const char* name);
+
+	//Ends a frame, keeping each thread's allocations since the last call
+	//Profiler::MarkFrame calls it, so frames line up with the profiler's
+	static void MarkFrame();
+
+	//Allocations made by every thread in the last frame
+	static AllocationCounts GetFrameCounts();
+
+	//Threads that have allocated since the program started
+	static unsigned int GetThreadCount();
+
+	//A thread's allocations in the last frame, and its name or nullptr if it wasn't named
+	static AllocationCounts GetFrameCounts(unsigned int thread, const char** name);
+};
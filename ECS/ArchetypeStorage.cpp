@@ -0,0 +1,141 @@
+#include "ArchetypeStorage.h"
+#include <cstring>
+
+Archetype::Archetype(ComponentMask mask) : m_mask(mask), m_count(0)
+{
+	size_t rowSize = sizeof(EntityId);
+	size_t padding = 0;
+	for (unsigned int t = 0; t < MAX_COMPONENT_TYPES; t++) {
+		m_columnOffsets[t] = INVALID_COLUMN_OFFSET;
+		m_columnSizes[t] = 0;
+		if (mask & (ComponentMask(1) << t)) {
+			const ComponentTypeInfo& info = ComponentTypes::GetInfo(t);
+			if (info.m_alignment > ARCHETYPE_CHUNK_ALIGNMENT)
+				throw "Component alignment exceeds the chunk alignment";
+			m_typeIds.push_back(t);
+			m_columnSizes[t] = info.m_size;
+			rowSize += info.m_size;
+			//Worst case padding to bring the column to its alignment
+			padding += info.m_alignment - 1;
+		}
+	}
+
+	m_capacity = (padding < ARCHETYPE_CHUNK_SIZE) ? static_cast<unsigned int>((ARCHETYPE_CHUNK_SIZE - padding) / rowSize) : 0;
+	if (m_capacity == 0)
+		throw "Component set does not fit in a chunk";
+
+	//The entity column starts the chunk, then each column starts at its component's alignment
+	//Sizes are multiples of alignments, so every cell in a column stays aligned
+	size_t offset = 0;
+	m_entityOffset = 0;
+	offset += sizeof(EntityId) * m_capacity;
+	for (unsigned int t : m_typeIds) {
+		size_t alignment = ComponentTypes::GetInfo(t).m_alignment;
+		offset = (offset + alignment - 1) / alignment * alignment;
+		m_columnOffsets[t] = static_cast<unsigned int>(offset);
+		offset += m_columnSizes[t] * m_capacity;
+	}
+}
+
+unsigned int Archetype::Allocate(EntityId entityId)
+{
+	unsigned int row = static_cast<unsigned int>(m_count);
+	if (row / m_capacity == m_chunks.size())
+		m_chunks.emplace_back(new ArchetypeChunk);
+	m_count++;
+	*reinterpret_cast<EntityId*>(GetCell(row, m_entityOffset, sizeof(EntityId))) = entityId;
+	return row;
+}
+
+EntityId Archetype::Free(unsigned int row)
+{
+	unsigned int last = static_cast<unsigned int>(m_count - 1);
+	m_count--;
+	if (row == last)
+		return EntityId();
+
+	for (unsigned int t : m_typeIds)
+		memcpy(GetCell(row, m_columnOffsets[t], m_columnSizes[t]), GetCell(last, m_columnOffsets[t], m_columnSizes[t]), m_columnSizes[t]);
+	EntityId moved = GetEntity(last);
+	*reinterpret_cast<EntityId*>(GetCell(row, m_entityOffset, sizeof(EntityId))) = moved;
+	return moved;
+}
+
+void* Archetype::GetComponent(unsigned int row, unsigned int typeId)
+{
+	unsigned int offset = m_columnOffsets[typeId];
+	if (offset == INVALID_COLUMN_OFFSET)
+		return nullptr;
+	return GetCell(row, offset, m_columnSizes[typeId]);
+}
+
+EntityId Archetype::GetEntity(unsigned int row)
+{
+	return *reinterpret_cast<EntityId*>(GetCell(row, m_entityOffset, sizeof(EntityId)));
+}
+
+unsigned int Archetype::GetChunkCount(size_t chunk) const
+{
+	size_t start = chunk * m_capacity;
+	if (start >= m_count)
+		return 0;
+	size_t remaining = m_count - start;
+	return static_cast<unsigned int>(remaining < m_capacity ? remaining : m_capacity);
+}
+
+unsigned char* Archetype::GetCell(unsigned int row, unsigned int offset, size_t size)
+{
+	return m_chunks[row / m_capacity]->m_data + offset + (row % m_capacity) * size;
+}
+
+void ArchetypeStorage::Remove(EntityId entityId)
+{
+	EntityLocation* location = m_locations.TryGet(entityId);
+	if (!location)
+		return;
+	EntityId moved = location->m_archetype->Free(location->m_row);
+	if (moved.m_index != INVALID_ENTITY_INDEX)
+		m_locations.Get(moved).m_row = location->m_row;
+	m_locations.Erase(entityId);
+}
+
+Archetype & ArchetypeStorage::GetArchetype(ComponentMask mask)
+{
+	auto found = m_archetypeLookup.find(mask);
+	if (found != m_archetypeLookup.end())
+		return *found->second;
+	m_archetypes.emplace_back(new Archetype(mask));
+	Archetype* archetype = m_archetypes.back().get();
+	m_archetypeLookup[mask] = archetype;
+	return *archetype;
+}
+
+EntityLocation & ArchetypeStorage::Move(EntityId entityId, ComponentMask mask)
+{
+	Archetype& target = GetArchetype(mask);
+	EntityLocation* location = m_locations.TryGet(entityId);
+	if (!location) {
+		unsigned int row = target.Allocate(entityId);
+		m_locations.Insert(entityId, { &target, row });
+		return m_locations.Get(entityId);
+	}
+	if (location->m_archetype == &target)
+		return *location;
+
+	Archetype* source = location->m_archetype;
+	unsigned int sourceRow = location->m_row;
+	unsigned int row = target.Allocate(entityId);
+	ComponentMask shared = source->GetMask() & mask;
+	for (unsigned int t = 0; shared; t++, shared >>= 1) {
+		if (shared & 1)
+			memcpy(target.GetComponent(row, t), source->GetComponent(sourceRow, t), target.GetComponentSize(t));
+	}
+
+	EntityId moved = source->Free(sourceRow);
+	if (moved.m_index != INVALID_ENTITY_INDEX)
+		m_locations.Get(moved).m_row = sourceRow;
+
+	location->m_archetype = &target;
+	location->m_row = row;
+	return *location;
+}
\ No newline at end of file
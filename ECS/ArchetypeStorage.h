@@ -0,0 +1,244 @@
+#pragma once
+#include "AlignedAllocator.h"
+#include "ComponentTypes.h"
+#include "EntityIdTypeDef.h"
+#include "SparseSet.h"
+#include "Span.h"
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#define ARCHETYPE_CHUNK_SIZE 16384
+#define ARCHETYPE_CHUNK_ALIGNMENT 64
+#define INVALID_COLUMN_OFFSET 0xffffffff
+
+using namespace std;
+
+//A fixed-size block holding one column per component type of its archetype
+//Starts on a cache line, so every column can start at its component's alignment
+struct ArchetypeChunk {
+	alignas(ARCHETYPE_CHUNK_ALIGNMENT) unsigned char m_data[ARCHETYPE_CHUNK_SIZE];
+
+	//C++14's new only guarantees the default alignment, so chunks come from the aligned allocator
+	static void* operator new(size_t) {
+		return AlignedAllocator<ArchetypeChunk, ARCHETYPE_CHUNK_ALIGNMENT>().allocate(1);
+	}
+	static void operator delete(void* block) {
+		AlignedAllocator<ArchetypeChunk, ARCHETYPE_CHUNK_ALIGNMENT>().deallocate(static_cast<ArchetypeChunk*>(block), 1);
+	}
+};
+
+//Every entity with exactly the same component set
+//Rows are packed: every chunk but the last is full, so row r lives in chunk r / capacity
+class Archetype {
+public:
+	Archetype(ComponentMask mask);
+
+	//Appends a row for the entity and returns its index
+	unsigned int Allocate(EntityId entityId);
+
+	//Removes a row by moving the last row into it
+	//Returns the entity that moved, or an invalid handle if the last row was removed
+	EntityId Free(unsigned int row);
+
+	//Returns a pointer to a component in a row, or nullptr if this archetype lacks the type
+	void* GetComponent(unsigned int row, unsigned int typeId);
+	template <typename T>
+	T* GetComponent(unsigned int row) {
+		return static_cast<T*>(GetComponent(row, ComponentTypes::GetId<T>()));
+	}
+
+	//Returns the entity in a row
+	EntityId GetEntity(unsigned int row);
+
+	//Returns the size of a component type's cells
+	size_t GetComponentSize(unsigned int typeId) const {
+		return m_columnSizes[typeId];
+	}
+
+	//Returns a chunk's column for a type, or nullptr if this archetype lacks the type
+	template <typename T>
+	T* GetColumn(size_t chunk) {
+		unsigned int offset = m_columnOffsets[ComponentTypes::GetId<T>()];
+		if (offset == INVALID_COLUMN_OFFSET)
+			return nullptr;
+		return reinterpret_cast<T*>(m_chunks[chunk]->m_data + offset);
+	}
+
+	//Returns a chunk's entity column
+	EntityId* GetEntities(size_t chunk) {
+		return reinterpret_cast<EntityId*>(m_chunks[chunk]->m_data + m_entityOffset);
+	}
+
+	//Returns the number of occupied rows in a chunk
+	unsigned int GetChunkCount(size_t chunk) const;
+
+	//Returns the number of chunks holding at least one row
+	size_t GetChunkUsed() const {
+		return (m_count + m_capacity - 1) / m_capacity;
+	}
+
+	ComponentMask GetMask() const {
+		return m_mask;
+	}
+	unsigned int GetCapacity() const {
+		return m_capacity;
+	}
+	size_t size() const {
+		return m_count;
+	}
+private:
+	unsigned char* GetCell(unsigned int row, unsigned int offset, size_t size);
+
+	ComponentMask m_mask;
+	unsigned int m_capacity;												//Rows per chunk
+	unsigned int m_entityOffset;
+	unsigned int m_columnOffsets[MAX_COMPONENT_TYPES];						//Indexed by type id
+	size_t m_columnSizes[MAX_COMPONENT_TYPES];
+	vector<unsigned int> m_typeIds;											//Type ids in this archetype, ascending
+	vector<unique_ptr<ArchetypeChunk>> m_chunks;							//Emptied chunks are kept for reuse
+	size_t m_count;
+};
+
+//Where an entity's row lives
+struct EntityLocation {
+	Archetype* m_archetype;
+	unsigned int m_row;
+};
+
+//Groups entities by component set so that entities sharing components share chunks
+class ArchetypeStorage {
+public:
+	//Gives the entity the components, adding to any it already has
+	template <typename... Ts>
+	void Create(EntityId entityId, const Ts&... components) {
+		EntityLocation* location = m_locations.TryGet(entityId);
+		ComponentMask mask = MakeComponentMask<Ts...>() | (location ? location->m_archetype->GetMask() : 0);
+		EntityLocation& moved = Move(entityId, mask);
+		int expand[] = { 0, (*moved.m_archetype->GetComponent<Ts>(moved.m_row) = components, 0)... };
+		(void)expand;
+	}
+
+	//Gives the entity a component, replacing it if the entity already has one
+	template <typename T>
+	void AddComponent(EntityId entityId, const T& component) {
+		Create(entityId, component);
+	}
+
+	//Takes a component away from the entity, removing the entity when none are left
+	template <typename T>
+	void RemoveComponent(EntityId entityId) {
+		EntityLocation* location = m_locations.TryGet(entityId);
+		if (!location)
+			return;
+		ComponentMask mask = location->m_archetype->GetMask() & ~ComponentTypes::GetMask<T>();
+		if (mask == location->m_archetype->GetMask())
+			return;
+		if (mask)
+			Move(entityId, mask);
+		else
+			Remove(entityId);
+	}
+
+	//Removes the entity and all its components
+	void Remove(EntityId entityId);
+
+	//Returns the entity's component, or nullptr if it has none
+	template <typename T>
+	T* GetComponent(EntityId entityId) {
+		EntityLocation* location = m_locations.TryGet(entityId);
+		return location ? location->m_archetype->GetComponent<T>(location->m_row) : nullptr;
+	}
+
+	bool Contains(EntityId entityId) const {
+		return m_locations.Contains(entityId);
+	}
+
+	//Returns the archetype for a component set, creating it if needed
+	Archetype& GetArchetype(ComponentMask mask);
+
+	//Archetypes are never destroyed, so queries can cache them by index
+	size_t GetArchetypeCount() const {
+		return m_archetypes.size();
+	}
+	Archetype& GetArchetypeAt(size_t index) {
+		return *m_archetypes[index];
+	}
+
+	//Returns the number of entities
+	size_t size() const {
+		return m_locations.size();
+	}
+private:
+	//Moves the entity's row to the archetype for mask, carrying over the components both share
+	EntityLocation& Move(EntityId entityId, ComponentMask mask);
+
+	vector<unique_ptr<Archetype>> m_archetypes;
+	unordered_map<ComponentMask, Archetype*> m_archetypeLookup;
+	SparseSet<EntityLocation> m_locations;
+};
+
+//Iterates every entity holding all of Ts, one contiguous chunk at a time
+template <typename... Ts>
+class Query {
+public:
+	Query(ArchetypeStorage* storage) : m_storage(storage), m_mask(MakeComponentMask<Ts...>()), m_archetypesSeen(0) {
+	}
+
+	//Calls f(Span<EntityId>, Span<Ts>...) once for every non-empty chunk
+	template <typename F>
+	void ForEachChunk(F f) {
+		Refresh();
+		for (Archetype* archetype : m_matches) {
+			size_t used = archetype->GetChunkUsed();
+			for (size_t c = 0; c < used; c++) {
+				unsigned int count = archetype->GetChunkCount(c);
+				f(Span<EntityId>(archetype->GetEntities(c), count), Span<Ts>(archetype->GetColumn<Ts>(c), count)...);
+			}
+		}
+	}
+
+	//Calls f(EntityId, Ts&...) for every matching entity
+	template <typename F>
+	void ForEach(F f) {
+		Refresh();
+		for (Archetype* archetype : m_matches) {
+			size_t used = archetype->GetChunkUsed();
+			for (size_t c = 0; c < used; c++) {
+				unsigned int count = archetype->GetChunkCount(c);
+				EntityId* entities = archetype->GetEntities(c);
+				ForEachRow(f, count, entities, archetype->GetColumn<Ts>(c)...);
+			}
+		}
+	}
+
+	//Returns the number of matching entities
+	size_t Count() {
+		Refresh();
+		size_t count = 0;
+		for (Archetype* archetype : m_matches)
+			count += archetype->size();
+		return count;
+	}
+private:
+	//Picks up archetypes created since the last call
+	void Refresh() {
+		size_t archetypeCount = m_storage->GetArchetypeCount();
+		for (; m_archetypesSeen < archetypeCount; m_archetypesSeen++) {
+			Archetype& archetype = m_storage->GetArchetypeAt(m_archetypesSeen);
+			if ((archetype.GetMask() & m_mask) == m_mask)
+				m_matches.push_back(&archetype);
+		}
+	}
+
+	template <typename F>
+	static void ForEachRow(F& f, unsigned int count, EntityId* entities, Ts*... columns) {
+		for (unsigned int r = 0; r < count; r++)
+			f(entities[r], columns[r]...);
+	}
+
+	ArchetypeStorage* m_storage;
+	ComponentMask m_mask;
+	size_t m_archetypesSeen;
+	vector<Archetype*> m_matches;
+};
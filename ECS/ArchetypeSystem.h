@@ -0,0 +1,80 @@
+#pragma once
+#include "SystemBase.h"
+#include "ArchetypeStorage.h"
+#include "EntityIdTypeDef.h"
+
+//The System API over a shared ArchetypeStorage
+//Entities that also have components in other archetype systems on the same storage share chunks with them
+template <typename T>
+class ArchetypeSystem : public SystemBase {
+public:
+	void virtual Update(Simulation * sim, float dT) = 0;
+
+	//Gives the entity a component of type T
+	void virtual Create(EntityId entityId, T tc) {
+		m_storage->AddComponent(entityId, tc);
+	}
+
+	//Takes the entity's component of type T away
+	void virtual Remove(EntityId entityId) {
+		m_storage->RemoveComponent<T>(entityId);
+	}
+
+	//Returns a reference to the component with the given ID
+	T& GetComponent(EntityId entityId) {
+		return *m_storage->GetComponent<T>(entityId);
+	}
+
+	//Gets the number of components
+	size_t GetCount() {
+		return m_query.Count();
+	}
+
+	ArchetypeSystem(ArchetypeStorage* storage) : SystemBase(), m_storage(storage), m_query(storage) {
+	}
+	~ArchetypeSystem(){}
+protected:
+	ArchetypeStorage* m_storage;
+	Query<T> m_query;											//Iterate this instead of a component list
+};
+
+//The PairedSystem API over a shared ArchetypeStorage
+//Both components always live in the same row, so they stay in sync without extra bookkeeping
+template <typename T, typename U>
+class ArchetypePairedSystem : public SystemBase {
+public:
+	void virtual Update(Simulation * sim, float dT) = 0;
+
+	//Gives the entity a component of type T and a component of type U
+	void virtual Create(EntityId entityId, T tc, U uc) {
+		m_storage->Create(entityId, tc, uc);
+	}
+
+	//Takes both components away
+	void virtual Remove(EntityId entityId) {
+		m_storage->RemoveComponent<T>(entityId);
+		m_storage->RemoveComponent<U>(entityId);
+	}
+
+	//Returns a reference to the component of type T with the given ID
+	T& GetComponent1(EntityId entityId) {
+		return *m_storage->GetComponent<T>(entityId);
+	}
+
+	//Returns a reference to the component of type U with the given ID
+	U& GetComponent2(EntityId entityId) {
+		return *m_storage->GetComponent<U>(entityId);
+	}
+
+	//Gets the number of component pairs
+	size_t GetCount() {
+		return m_query.Count();
+	}
+
+	ArchetypePairedSystem(ArchetypeStorage* storage) : SystemBase(), m_storage(storage), m_query(storage) {
+	}
+	~ArchetypePairedSystem(){}
+protected:
+	ArchetypeStorage* m_storage;
+	Query<T, U> m_query;
+};
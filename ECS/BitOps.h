@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//Returns the index of the lowest set bit, which compiles to tzcnt/bsf
+//The bits must not all be zero
+inline unsigned int CountTrailingZeros(uint64_t bits) {
+#if defined(_MSC_VER) && defined(_M_IX86)
+	//the 64-bit intrinsics only exist on 64-bit targets, so scan each half
+	unsigned long index;
+	if (_BitScanForward(&index, static_cast<uint32_t>(bits)))
+		return static_cast<unsigned int>(index);
+	_BitScanForward(&index, static_cast<uint32_t>(bits >> 32));
+	return static_cast<unsigned int>(index) + 32;
+#elif defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward64(&index, bits);
+	return static_cast<unsigned int>(index);
+#else
+	return static_cast<unsigned int>(__builtin_ctzll(bits));
+#endif
+}
+
+//Returns the number of zero bits above the highest set bit, which compiles to lzcnt/bsr
+//The bits must not all be zero
+inline unsigned int CountLeadingZeros(uint64_t bits) {
+#if defined(_MSC_VER) && defined(_M_IX86)
+	unsigned long index;
+	if (_BitScanReverse(&index, static_cast<uint32_t>(bits >> 32)))
+		return 31 - static_cast<unsigned int>(index);
+	_BitScanReverse(&index, static_cast<uint32_t>(bits));
+	return 63 - static_cast<unsigned int>(index);
+#elif defined(_MSC_VER)
+	unsigned long index;
+	_BitScanReverse64(&index, bits);
+	return 63 - static_cast<unsigned int>(index);
+#else
+	return static_cast<unsigned int>(__builtin_clzll(bits));
+#endif
+}
+
+//Returns the number of set bits
+inline unsigned int PopCount(uint64_t bits) {
+#if defined(_MSC_VER) && defined(_M_IX86)
+	return static_cast<unsigned int>(__popcnt(static_cast<uint32_t>(bits)) + __popcnt(static_cast<uint32_t>(bits >> 32)));
+#elif defined(_MSC_VER)
+	return static_cast<unsigned int>(__popcnt64(bits));
+#else
+	return static_cast<unsigned int>(__builtin_popcountll(bits));
+#endif
+}
@@ -3,20 +3,35 @@
 template <size_t N, typename T>
 class ClearArray {
 public:
+	//Appends an item, or does nothing if prune is set and the item is already present
+	//Throws when full rather than dropping the item, since owners rely on everything pushed being kept
 	void push(T item, bool prune = false) {
-		if (m_count < N && !(prune && contains(item)))
-		{
-			m_data[m_count] = item;
-			m_count++;
-		}
+		if (prune && contains(item))
+			return;
+		if (m_count >= N)
+			throw "ClearArray is full";
+		m_data[m_count] = item;
+		m_count++;
 	}
 	T& operator[](const unsigned int index) {
 		if (index >= m_count)
 			throw "Out of range";
 		return m_data[index];
 	}
+	//Removes an item by moving the last one into its place
+	//Returns false if the item isn't present
+	bool remove(T item) {
+		for (unsigned int c = 0; c < m_count; c++) {
+			if (m_data[c] == item) {
+				m_data[c] = m_data[m_count - 1];
+				m_count--;
+				return true;
+			}
+		}
+		return false;
+	}
 	void clear() {
-		m_count
+		m_count = 0;
 	}
 	size_t size() {
 		return m_count;
@@ -24,6 +39,12 @@ public:
 	size_t capacity() {
 		return N;
 	}
+	T* begin() {
+		return m_data;
+	}
+	T* end() {
+		return m_data + m_count;
+	}
 private:
 	bool contains(T item) {
 		for (unsigned int c = 0; c < m_count; c++)
@@ -41,21 +41,37 @@ public:
 		m_data.resize(size);
 		m_count = size;
 	}
-	void resize(size_t size, T &defValue) {
+	void resize(size_t size, const T &defValue) {
 		m_data.resize(size, defValue);
 		m_count = size;
 	}
 	size_t size() {
 		return m_count;
 	}
+	size_t capacity() {
+		return m_data.capacity();
+	}
+
+	//Destroys the items past the count and releases their memory
+	void shrink_to_fit() {
+		m_data.resize(m_count);
+		m_data.shrink_to_fit();
+	}
 
 	ClearVector(const ClearVector<T> & other) {
 		m_data = other.m_data;
 		m_count = other.m_count;
 	}
 
+	//Moves keep the items' storage, so a vector of ClearVectors can grow without copying every one
+	ClearVector(ClearVector<T> && other) noexcept {
+		m_data = move(other.m_data);
+		m_count = other.m_count;
+		other.m_count = 0;
+	}
+
 	ClearVector<T>& operator=(ClearVector<T> other) {
-		m_data = other.m_data;
+		m_data = move(other.m_data);
 		m_count = other.m_count;
 		return *this;
 	}
@@ -1,3 +1,4 @@
 #pragma once
-#include "GameForwardDecl.h"
-typedef void(*CollisionFunction)(Game * g, unsigned int entityId1, unsigned int entityId2, float dt);
+#include "SimulationForwardDecl.h"
+#include "EntityIdTypeDef.h"
+typedef void(*CollisionFunction)(Simulation * sim, EntityId entityId1, EntityId entityId2, float dt);
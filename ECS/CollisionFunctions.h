@@ -7,7 +7,6 @@
 
 class CollisionFunctions {
 public:
-	static void NoOpCollision(Game * g, EntityId entityId1, EntityId entityId2, float dt);
-	static void EndState(Game * g, EntityId entityId1, EntityId entityId2, float dt);
-	static float frand2(float min, float max);
+	static void NoOpCollision(Simulation * sim, EntityId entityId1, EntityId entityId2, float dt);
+	static void EndState(Simulation * sim, EntityId entityId1, EntityId entityId2, float dt);
 };
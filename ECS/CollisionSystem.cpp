@@ -1,18 +1,27 @@
 #include "CollisionSystem.h"
 #include "TransformSystem.h"
-#include "Game.h"
+#include "Simulation.h"
 #include "CollisionFunctions.h"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
 
 #define CELL_DIVISIONS 9
 #define DESIRED_OBJECT_DENSITY 1500
+//Grid cells pair tested by one job
+#define PAIR_CHUNK_CELLS 64
+//Pairs a job gathers before claiming room for them in the shared pair array
+#define PAIR_FLUSH_SIZE 128
 
 using namespace DirectX;
 
-CollisionSystem::CollisionSystem() {
+CollisionSystem::CollisionSystem() : Timeable("CollisionSystem") {
 #if BENCHMARK >=0
 	m_collisionFunctions.push_back(std::make_tuple(CollisionType::test1, CollisionType::test2, &CollisionFunctions::NoOpCollision));
 	m_collisionFunctions.push_back(std::make_tuple(CollisionType::test1, CollisionType::test1, &CollisionFunctions::NoOpCollision));
 #endif
+	for (const auto& function : m_collisionFunctions)
+		m_sweepAndPrune.SetPairFilter(std::get<0>(function), std::get<1>(function), true);
 }
 
 CollisionSystem::~CollisionSystem() {
@@ -23,46 +32,97 @@ XMFLOAT3 CollisionSystem::GetCellCounts() {
 	return m_cellCounts;
 }
 
+bool CollisionSystem::Compact(CompactionBudget& budget) {
+	if (!System<BoundingBox>::Compact(budget))
+		return false;
+	if (m_bufferOccupancy.ShouldShrink(m_components.size(), m_aabbs.capacity())) {
+		ShrinkToFit(m_aabbs);
+		m_grid.ShrinkToFit();
+		m_sweepAndPrune.ShrinkToFit();
+		vector<CollisionPair>().swap(m_pairs);
+		vector<CollisionPair>().swap(m_collisions);
+	}
+	return true;
+}
+
+void CollisionSystem::LoadSnapshot(const SnapshotReader& reader, uint32_t entitySection, uint32_t componentSection, EntityTable& entityTable) {
+	System<BoundingBox>::LoadSnapshot(reader, entitySection, componentSection, entityTable);
+	m_aabbs.clear();
+	m_aabbTick = 0;
+	m_sweepAndPrune.Clear();
+}
+
+void CollisionSystem::SetBroadphase(Broadphase broadphase) {
+	if (broadphase == m_broadphase)
+		return;
+	m_broadphase = broadphase;
+	//sweep and prune's boxes and pairs go stale while the grid runs
+	m_sweepAndPrune.Clear();
+}
+
+Broadphase CollisionSystem::GetBroadphase() const {
+	return m_broadphase;
+}
+
+SystemAccess CollisionSystem::GetAccess() const {
+	return {
+		MakeComponentMask<TransformComponent, PhysicsComponent, BoundingBox, EntityTableResource, CommandBufferResource>(),
+		MakeComponentMask<TransformComponent, PhysicsComponent, RandomResource>()
+	};
+}
+
 //Generates AABBs then checks them for collisions
-void CollisionSystem::Update(Game * game, float dt) {
+void CollisionSystem::Update(Simulation * sim, float dt) {
 	StartTimer();
-	Collapse();
-	if (m_collapsedCount == 0)
+	unsigned int count = static_cast<unsigned int>(m_components.size());
+	if (count == 0)
+	{
+		StopTimer();
 		return;
+	}
 	//pre-allocate stuff
 	EntityId entityId;
-	TransformSystem * ts = &game->m_transformSystem;
+	TransformSystem * ts = &sim->m_transformSystem;
 	BoundingBox * cc;
-	vector<ComponentData> & tcds = ts->GetComponentData();
-	FreeVector<TransformComponent> & tcs = ts->GetComponentList1();
-	TransformComponent * tc;
+	TransformStreams & streams = ts->GetStreams();
+	unsigned int transformIndex;
 	XMVECTOR original;
 	XMMATRIX modelToWorld;
 	XMVECTOR max;
 	XMVECTOR min;
-	XMVECTOR globalMax = XMLoadFloat3(&XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX));
-	XMVECTOR globalMin = XMLoadFloat3(&XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX));
-	XMVECTOR globalPad = XMLoadFloat3(&XMFLOAT3(1, 1, 1));
+	XMVECTOR globalMax = XMVectorReplicate(-FLT_MAX);
+	XMVECTOR globalMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR globalPad = XMVectorReplicate(1);
 	//XMVECTOR position;
 
+	uint64_t phaseStart = Profiler::BeginZone();
 	//size aabb list appropriately
-	m_aabbs.resize(m_components.count()); //use count to avoid dead elements in aabb list
-	unsigned int aabbIndex = 0; //reset index	
+	m_aabbs.resize(m_components.size());
+	uint32_t sinceTick = m_aabbTick;
+	m_aabbTick = ts->GetChangeTick();
+
+	//loop through bounding boxes in place
+	for (unsigned int c = 0; c < count; c++) {
+
+		cc = &m_components[c]; //get component
+		entityId = m_components.GetEntity(c); //get entityID
 
-	//loop through bounding boxes
-	unsigned int transformIndex = 0;
-	for (unsigned int c = 0; c < m_collapsedCount; c++) {
+		transformIndex = ts->GetIndex(entityId);
 
-		cc = &m_collapsedComponents[c].m_component; //get component
-		entityId = m_collapsedComponents[c].m_entityId; //get entityID
+		//reuse the last AABB if this slot still holds the same collider and it hasn't moved
+		if (m_aabbs[c].m_entityId == entityId && !ts->HasChangedSince(transformIndex, sinceTick)) {
+			globalMax = XMVectorMax(globalMax, XMLoadFloat3(&m_aabbs[c].m_component.m_max));
+			globalMin = XMVectorMin(globalMin, XMLoadFloat3(&m_aabbs[c].m_component.m_min));
+			m_aabbs[c].m_handle = c;
+			continue;
+		}
 
-		//save the transform and its quat
-		tc = &ts->GetComponent1(entityId);
-		modelToWorld = TransformSystem::GetMatrix(*tc);
+		//get the entity's world matrix
+		modelToWorld = ts->GetMatrix(transformIndex);
 
 		//reset max and min values
-		max = XMLoadFloat3(&XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX));
-		min = XMLoadFloat3(&XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX));
+		max = XMVectorReplicate(-FLT_MAX);
+		min = XMVectorReplicate(FLT_MAX);
 
 		//loop through eight bounding box points
 		for (unsigned int n = 0; n < 8; n++) {
@@ -76,11 +136,12 @@ void CollisionSystem::Update(Game * game, float dt) {
 		float distanceFromGround = XMVectorGetY(min) - 0;
 		if (distanceFromGround < 0)
 		{
-			XMVECTOR offset = XMLoadFloat3(&XMFLOAT3(0, -distanceFromGround, 0));
+			XMVECTOR offset = XMVectorSet(0, -distanceFromGround, 0, 0);
 			max = XMVectorAdd(max, offset);
 			min = XMVectorAdd(min, offset);
-			XMStoreFloat3(&(tc->m_position), XMVectorAdd(XMLoadFloat3(&tc->m_position), offset));
-			ts->GetComponentList2()[transformIndex].m_velocity.y = 0;
+			streams.Get(POSITION_Y)[transformIndex] -= distanceFromGround;
+			streams.Get(VELOCITY_Y)[transformIndex] = 0;
+			ts->MarkChanged(transformIndex);
 		}
 		//store final translated max and min in aabb list
 		XMStoreFloat3(&m_aabbs[c].m_component.m_max, max);
@@ -89,115 +150,146 @@ void CollisionSystem::Update(Game * game, float dt) {
 		globalMin = XMVectorMin(globalMin, min);
 		m_aabbs[c].m_component.m_collisionType = cc->m_collisionType;
 		m_aabbs[c].m_entityId = entityId;
-		m_aabbs[c].m_handle = m_collapsedComponents[c].m_handle;
+		m_aabbs[c].m_handle = c;
 	}
 
-	globalMax = XMVectorAdd(globalMax, globalPad);
-	globalMin = XMVectorSubtract(globalMin, globalPad);
+	Profiler::EndZone("AABB build", phaseStart);
 
-	//prep spatial hash grid
-	XMVECTOR dimensions = XMVectorSubtract(globalMax, globalMin);
-	float cellDivisions = ceilf(static_cast<float>(m_collapsedCount) / DESIRED_OBJECT_DENSITY);
-	dimensions = XMVectorScale(dimensions, 1.0f/cellDivisions);
-	m_cellCounts = XMFLOAT3(cellDivisions, cellDivisions, cellDivisions);
-	for (unsigned int c = 0; c < m_spatialHashGrid.size(); c++)
-		for (unsigned int n = 0; n < CollisionType::NUMTYPES;n++)
-			m_spatialHashGrid[c][n].clear();
-	m_spatialHashGrid.resize(static_cast<size_t>(m_cellCounts.x * m_cellCounts.y * m_cellCounts.z), vector<ClearVector<CollapsedComponent<MaxMin>>>(CollisionType::NUMTYPES));
+	if (m_broadphase == Broadphase::SweepAndPrune) {
+		phaseStart = Profiler::BeginZone();
+		m_sweepAndPrune.Update(m_aabbs);
+		Profiler::EndZone("Sweep and prune", phaseStart);
 
-	//populate spatial hash grid
-#ifdef _DEBUG
-	for (unsigned int c = 0; c < m_collapsedCount; c++) {
-#else
-	parallel_for(size_t(0), m_collapsedCount, [&](unsigned int c) {
-#endif
-		CollapsedComponent<TypedMaxMin> caabb = m_aabbs[c];
-		TypedMaxMin aabb = caabb.m_component;
-		XMFLOAT3 bb[8] = {
-			{aabb.m_max.x, aabb.m_max.y, aabb.m_max.z},
-			{ aabb.m_max.x, aabb.m_max.y, aabb.m_min.z },
-			{ aabb.m_max.x, aabb.m_min.y, aabb.m_max.z },
-			{ aabb.m_max.x, aabb.m_min.y, aabb.m_min.z },
-			{ aabb.m_min.x, aabb.m_max.y, aabb.m_max.z },
-			{ aabb.m_min.x, aabb.m_max.y, aabb.m_min.z },
-			{ aabb.m_min.x, aabb.m_min.y, aabb.m_max.z },
-			{ aabb.m_min.x, aabb.m_min.y, aabb.m_min.z }
-		};
-		XMVECTOR pointxm;
-		ClearArray<8, unsigned int> gridIndices;
-		for (auto& point : bb) {
-			pointxm = XMLoadFloat3(&point);
-			XMStoreFloat3(&point, XMVectorFloor(XMVectorDivide(XMVectorSubtract(pointxm, globalMin), dimensions)));
-			gridIndices.push(static_cast<unsigned int>(point.z * m_cellCounts.x * m_cellCounts.y + point.y * m_cellCounts.x + point.x), true);
-		}
-		for (unsigned int n = 0; n < gridIndices.size(); n++) {
-			m_spatialHashGrid[gridIndices[n]][caabb.m_component.m_collisionType].add({ aabb, caabb.m_entityId, caabb.m_handle });
-		}
-#ifdef _DEBUG
+		phaseStart = Profiler::BeginZone();
+		m_collisions.clear();
+		m_sweepAndPrune.ForEachPair([this](EntityId entity1, CollisionType type1, EntityId entity2, CollisionType type2) {
+			//entity1 has the lower index, so same type pairs come out in the same order as the grid's
+			for (unsigned int f = 0; f < m_collisionFunctions.size(); f++) {
+				CollisionType ct1 = std::get<0>(m_collisionFunctions[f]);
+				CollisionType ct2 = std::get<1>(m_collisionFunctions[f]);
+				if (type1 == ct1 && type2 == ct2)
+					m_collisions.push_back({ entity1, entity2, f });
+				else if (type1 == ct2 && type2 == ct1)
+					m_collisions.push_back({ entity2, entity1, f });
+			}
+		});
 	}
-#else
-	});
-#endif
+	else {
+		phaseStart = Profiler::BeginZone();
+		globalMax = XMVectorAdd(globalMax, globalPad);
+		globalMin = XMVectorSubtract(globalMin, globalPad);
 
-	//clear collision map
-	for (auto& kv : m_collisionMap) {
-		kv.second.clear();
-	}
-	m_registeredCollisions.resize(m_componentData.size());
-	for (auto& cl : m_registeredCollisions)
-		cl.clear();
+		//prep spatial hash grid
+		//the divisions grow with the collider count, but past a few tens of thousands colliders there would be more cells than colliders, so they're capped there
+		XMVECTOR dimensions = XMVectorSubtract(globalMax, globalMin);
+		float cellDivisions = std::min(ceilf(static_cast<float>(count) / DESIRED_OBJECT_DENSITY), std::max(1.0f, floorf(cbrtf(static_cast<float>(count)))));
+		dimensions = XMVectorScale(dimensions, 1.0f/cellDivisions);
+		m_cellCounts = XMFLOAT3(cellDivisions, cellDivisions, cellDivisions);
+		XMFLOAT3 gridOrigin, cellSize;
+		XMStoreFloat3(&gridOrigin, globalMin);
+		XMStoreFloat3(&cellSize, dimensions);
+
+		//populate spatial hash grid
+		m_grid.Build(m_aabbs, gridOrigin, cellSize, static_cast<unsigned int>(cellDivisions));
+
+		Profiler::EndZone("Grid fill", phaseStart);
+
+		phaseStart = Profiler::BeginZone();
+		size_t chunkCount = (m_grid.GetCellCount() + PAIR_CHUNK_CELLS - 1) / PAIR_CHUNK_CELLS;
+		atomic<size_t> pairCount(0);
 
-	//check collisions
+		//check collisions
+		//if the pair array turns out too small, it grows to fit with headroom and the tests run again, which only happens while the pair count climbs
+		for (bool fits = false; !fits; ) {
+			pairCount = 0;
+			size_t pairCapacity = m_pairs.size();
 #ifdef _DEBUG
-	for (unsigned int b = 0; b < m_spatialHashGrid.size(); b++) {
+			for (unsigned int chunk = 0; chunk < chunkCount; chunk++) {
 #else
-	parallel_for(size_t(0), m_spatialHashGrid.size(), [&](unsigned int b) {
+			JobSystem::GetDefault().ParallelFor(0, chunkCount, 1, [&](size_t chunk) {
 #endif
-		auto& bucketCv = m_spatialHashGrid[b];
-		for (auto cfDef : m_collisionFunctions) {
-			CollisionType ct1 = std::get<0>(cfDef);
-			CollisionType ct2 = std::get<1>(cfDef);
-			if (bucketCv[ct1].size() == 0 || bucketCv[ct2].size() == 0)
-				continue;
-			bool selfCheck = ct1 == ct2;
-			unsigned int outerLength = (!selfCheck) ? bucketCv[ct1].size() : bucketCv[ct1].size() - 1;
-			CollisionFunction cf = std::get<2>(cfDef);
-			for (unsigned int c = 0; c < outerLength; c++) {
-				CollapsedComponent<MaxMin> caabb1 = bucketCv[ct1][c];
-				MaxMin aabb1 = caabb1.m_component;
-				CollapsedComponent<MaxMin> caabb2;
-				MaxMin aabb2;
-				for (unsigned int n = (selfCheck) ? c + 1 : 0; n < bucketCv[ct2].size(); n++) {
-					caabb2 = bucketCv[ct2][n];
-					aabb2 = caabb2.m_component;
-
-					//add pair of indices on collision
-					if (aabb1.m_max.x > aabb2.m_min.x && aabb1.m_min.x < aabb2.m_max.x
-						&& aabb1.m_max.y > aabb2.m_min.y && aabb1.m_min.y < aabb2.m_max.y
-						&& aabb1.m_max.z > aabb2.m_min.z && aabb1.m_min.z < aabb2.m_max.z
-						&& !m_registeredCollisions[caabb1.m_handle].contains(caabb2.m_entityId)
-						&& !m_registeredCollisions[caabb2.m_handle].contains(caabb1.m_entityId))
-					{
-						m_registeredCollisions[caabb1.m_handle].add(caabb2.m_entityId);
-						m_registeredCollisions[caabb2.m_handle].add(caabb1.m_entityId);
-						m_collisionMap[cf].push_back(std::make_pair(caabb1.m_entityId, caabb2.m_entityId));
+				CollisionPair pairs[PAIR_FLUSH_SIZE];
+				size_t pending = 0;
+				//claims room for the gathered pairs, or only counts them if the array is full
+				auto flush = [&]() {
+					size_t start = pairCount.fetch_add(pending, memory_order_relaxed);
+					if (start + pending <= pairCapacity)
+						std::copy(pairs, pairs + pending, m_pairs.begin() + start);
+					pending = 0;
+				};
+				size_t chunkEnd = std::min<size_t>((chunk + 1) * PAIR_CHUNK_CELLS, m_grid.GetCellCount());
+				for (size_t b = chunk * PAIR_CHUNK_CELLS; b < chunkEnd; b++) {
+					for (unsigned int f = 0; f < m_collisionFunctions.size(); f++) {
+						CollisionType ct1 = std::get<0>(m_collisionFunctions[f]);
+						CollisionType ct2 = std::get<1>(m_collisionFunctions[f]);
+						Span<const CollapsedComponent<MaxMin>> bucket1 = m_grid.Get(b, ct1);
+						Span<const CollapsedComponent<MaxMin>> bucket2 = m_grid.Get(b, ct2);
+						if (bucket1.empty() || bucket2.empty())
+							continue;
+						bool selfCheck = ct1 == ct2;
+						size_t outerLength = (!selfCheck) ? bucket1.size() : bucket1.size() - 1;
+						for (size_t c = 0; c < outerLength; c++) {
+							CollapsedComponent<MaxMin> caabb1 = bucket1[c];
+							MaxMin aabb1 = caabb1.m_component;
+							CollapsedComponent<MaxMin> caabb2;
+							MaxMin aabb2;
+							for (size_t n = (selfCheck) ? c + 1 : 0; n < bucket2.size(); n++) {
+								caabb2 = bucket2[n];
+								aabb2 = caabb2.m_component;
+
+								//add pair of entities on collision
+								if (aabb1.m_max.x > aabb2.m_min.x && aabb1.m_min.x < aabb2.m_max.x
+									&& aabb1.m_max.y > aabb2.m_min.y && aabb1.m_min.y < aabb2.m_max.y
+									&& aabb1.m_max.z > aabb2.m_min.z && aabb1.m_min.z < aabb2.m_max.z)
+								{
+									//colliders of the same type can meet in either order, so put them in entity order to match repeats from other cells
+									if (selfCheck && caabb2.m_entityId.m_index < caabb1.m_entityId.m_index)
+										pairs[pending++] = { caabb2.m_entityId, caabb1.m_entityId, f };
+									else
+										pairs[pending++] = { caabb1.m_entityId, caabb2.m_entityId, f };
+									if (pending == PAIR_FLUSH_SIZE)
+										flush();
+								}
+							}
+						}
 					}
 				}
-			}
-		}
+				flush();
 #ifdef _DEBUG
-	}
+			}
 #else
-	});
+			}, "Pair test range");
 #endif
-	
-	//loop through all collision functions
-	for (auto& kv : m_collisionMap) {
-		auto collisions = kv.second; //get list of actual collisions
-		for (unsigned int c = 0; c < collisions.size(); c++) {
-			//pass both entityIDs and dT to collision function
-			kv.first(game, collisions[c].first, collisions[c].second, dt);
+			fits = pairCount <= pairCapacity;
+			if (!fits) {
+				m_pairs.resize(pairCount + pairCount / 4);
+				m_collisions.reserve(m_pairs.size());
+			}
 		}
+		Profiler::EndZone("Pair test", phaseStart);
+
+		phaseStart = Profiler::BeginZone();
+		//the ranges were claimed in whatever order the jobs ran, but sorting below puts the pairs back in a fixed order
+		m_collisions.assign(m_pairs.begin(), m_pairs.begin() + pairCount);
 	}
+	//the grid finds colliders that share several cells in each, so sort the repeats together and drop them
+	//live entities have distinct indices, so the order is the same every run
+	std::sort(m_collisions.begin(), m_collisions.end(), [](const CollisionPair& a, const CollisionPair& b) {
+		if (a.m_function != b.m_function)
+			return a.m_function < b.m_function;
+		if (a.m_first.m_index != b.m_first.m_index)
+			return a.m_first.m_index < b.m_first.m_index;
+		return a.m_second.m_index < b.m_second.m_index;
+	});
+	m_collisions.erase(std::unique(m_collisions.begin(), m_collisions.end(), [](const CollisionPair& a, const CollisionPair& b) {
+		return a.m_function == b.m_function && a.m_first == b.m_first && a.m_second == b.m_second;
+	}), m_collisions.end());
+	Profiler::EndZone("Pair merge", phaseStart);
+
+	phaseStart = Profiler::BeginZone();
+	//pass both entityIDs and dT to each pair's collision function
+	for (const CollisionPair& collision : m_collisions)
+		std::get<2>(m_collisionFunctions[collision.m_function])(sim, collision.m_first, collision.m_second, dt);
+	Profiler::EndZone("Callback dispatch", phaseStart);
 	StopTimer();
 }
\ No newline at end of file
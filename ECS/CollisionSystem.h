@@ -1,38 +1,71 @@
 #pragma once
 #include "System.h"
+#include "CollapsedComponent.h"
 #include "CollisionComponent.h"
 #include "CollisionFunctionTypeDef.h"
-#include "LockVector.h"
-#include "ClearVector.h"
-#include "ClearArray.h"
+#include "SpatialGrid.h"
+#include "SweepAndPrune.h"
 #include "EntityIdTypeDef.h"
 #include "Timeable.h"
+#include "SystemAccess.h"
+#include "JobSystem.h"
 #include <DirectXMath.h>
 #include <mutex>
-#include <ppl.h>
 #include <map>
 #include <unordered_map>
 #include <unordered_set>
 using namespace DirectX;
-using namespace Concurrency;
+
+//Two colliding entities and the collision function they're passed to
+struct CollisionPair {
+	EntityId m_first;
+	EntityId m_second;
+	unsigned int m_function;	//Index into m_collisionFunctions
+};
+
+//How CollisionSystem finds the pairs of colliders to test
+//Both find the same pairs. The grid rebuilds from scratch every tick, while sweep and prune only pays for what moved,
+//so it suits scenes where most colliders are at rest or moving slowly
+enum class Broadphase : uint32_t {
+	Grid,
+	SweepAndPrune
+};
+
 //A System implementation
 class CollisionSystem : public System<BoundingBox>, public Timeable {
 public:
 	//Generates AABBs and checks collision
-	void Update(Game * game, float dT);
+	void Update(Simulation * sim, float dT);
 	XMFLOAT3 GetCellCounts();
+	//Compacts the bounding boxes, then shrinks the per-frame buffers once they have stayed mostly empty
+	bool Compact(CompactionBudget& budget);
+	//Restores the bounding boxes and drops the AABBs built for the entities they replace
+	void LoadSnapshot(const SnapshotReader& reader, uint32_t entitySection, uint32_t componentSection, EntityTable& entityTable);
+	//Collision responses move entities and queue removals
+	SystemAccess GetAccess() const;
+	//Switches broadphase, starting the new one over on the next update
+	void SetBroadphase(Broadphase broadphase);
+	Broadphase GetBroadphase() const;
 	CollisionSystem();
 	~CollisionSystem();
 private:
 	//Pre-allocated list of the current frame's AABBs
+	//Kept between ticks, so colliders whose transform hasn't changed reuse theirs
 	vector<CollapsedComponent<TypedMaxMin>> m_aabbs;
-	mutex m_collisionsMutex;
-	unordered_map<CollisionFunction, LockVector<pair<EntityId, EntityId>>> m_collisionMap;
-	ClearVector<vector<ClearVector<CollapsedComponent<MaxMin>>>> m_spatialHashGrid;
+	uint32_t m_aabbTick = 0;	//Transform change tick when m_aabbs was last built
+	//Pairs found by the grid's pair tests, in one flat array kept between ticks
+	//Chunks of cells gather pairs locally and claim a range with an atomic cursor, so pair tests take no locks,
+	//and the array only grows, with headroom, when a tick finds more pairs than it holds
+	vector<CollisionPair> m_pairs;
+	//The pairs in one list, sorted, without the repeats found by colliders that share more than one cell
+	vector<CollisionPair> m_collisions;
+	SpatialGrid m_grid;
+	SweepAndPrune m_sweepAndPrune;
+	Broadphase m_broadphase = Broadphase::Grid;
 	// m_mapMin;
 	//XMFLOAT3 m_cellDimensions;
 	XMFLOAT3 m_cellCounts;
 	//ClearVector<pair<CollapsedComponent<MaxMin>, ClearArray<8,unsigned int>>> m_cellCrossers;
-	ClearVector<ClearVector<EntityId>> m_registeredCollisions;
 	vector<tuple<CollisionType, CollisionType, CollisionFunction>> m_collisionFunctions;
+	OccupancyTracker m_bufferOccupancy;
 };
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+#include "JobSystem.h"
+#include <chrono>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+
+//Storage is shrunk once fewer than 1 in COMPACTION_OCCUPANCY_DIVISOR of its slots have been used for COMPACTION_DELAY_MS
+#define COMPACTION_OCCUPANCY_DIVISOR 4
+#define COMPACTION_DELAY_MS 2000
+
+//Time the simulation spends compacting storage each frame, in milliseconds
+#define COMPACTION_BUDGET_MS 0.25
+
+//How long a compaction pass may run
+//Each step is short, so checking between steps keeps a pass within the budget plus one step
+class CompactionBudget {
+public:
+	CompactionBudget(double milliseconds) : m_deadline(std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(milliseconds))) {}
+
+	bool Expired() const {
+		return std::chrono::steady_clock::now() >= m_deadline;
+	}
+private:
+	std::chrono::steady_clock::time_point m_deadline;
+};
+
+//Decides when a container has been mostly empty for long enough to be worth shrinking
+//Waiting keeps a brief dip in a churning scene from freeing memory that is about to be needed again
+class OccupancyTracker {
+public:
+	//Returns true when the container should be shrunk now
+	bool ShouldShrink(size_t size, size_t capacity) {
+		if (capacity <= COMPACTION_OCCUPANCY_DIVISOR || size * COMPACTION_OCCUPANCY_DIVISOR >= capacity) {
+			m_sparse = false;
+			return false;
+		}
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (!m_sparse) {
+			m_sparse = true;
+			m_sparseSince = now;
+			return false;
+		}
+		if (std::chrono::duration<double, std::milli>(now - m_sparseSince).count() < COMPACTION_DELAY_MS)
+			return false;
+		m_sparse = false;
+		return true;
+	}
+private:
+	bool m_sparse = false;
+	std::chrono::steady_clock::time_point m_sparseSince;
+};
+
+//Reallocates a vector to hold exactly its elements
+//The old block is freed on a worker, since handing tens of megabytes back to the OS takes longer than a frame's budget
+template <typename V>
+void ShrinkToFit(V& v) {
+	std::shared_ptr<V> old = std::make_shared<V>(std::make_move_iterator(v.begin()), std::make_move_iterator(v.end()), v.get_allocator());
+	old->swap(v);
+	JobSystem::GetDefault().Run([old]() {
+		V().swap(*old);
+	});
+}
\ No newline at end of file
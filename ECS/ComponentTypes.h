@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <mutex>
+#include <type_traits>
+
+#define MAX_COMPONENT_TYPES 64
+
+//One bit per component type id
+typedef uint64_t ComponentMask;
+
+//Layout of a registered component type
+struct ComponentTypeInfo {
+	size_t m_size;
+	size_t m_alignment;
+};
+
+//Assigns each component type a small integer id the first time it is used
+class ComponentTypes {
+public:
+	//Returns the id of T, registering it if needed
+	template <typename T>
+	static unsigned int GetId() {
+		static_assert(std::is_trivially_copyable<T>::value, "Components are moved between chunks with memcpy");
+		static const unsigned int id = Register(sizeof(T), alignof(T));
+		return id;
+	}
+
+	//Returns the mask bit of T
+	template <typename T>
+	static ComponentMask GetMask() {
+		return ComponentMask(1) << GetId<T>();
+	}
+
+	//Returns the layout of a registered type
+	static ComponentTypeInfo GetInfo(unsigned int id) {
+		std::lock_guard<std::mutex> lock(GetMutex());
+		return GetRegistry()[id];
+	}
+private:
+	static unsigned int Register(size_t size, size_t alignment) {
+		std::lock_guard<std::mutex> lock(GetMutex());
+		std::vector<ComponentTypeInfo>& registry = GetRegistry();
+		if (registry.size() == MAX_COMPONENT_TYPES)
+			throw "Too many component types";
+		registry.push_back({ size, alignment });
+		return static_cast<unsigned int>(registry.size() - 1);
+	}
+	static std::vector<ComponentTypeInfo>& GetRegistry() {
+		static std::vector<ComponentTypeInfo> registry;
+		return registry;
+	}
+	static std::mutex& GetMutex() {
+		static std::mutex mutex;
+		return mutex;
+	}
+};
+
+//Returns the mask holding the bits of every type in Ts
+template <typename... Ts>
+ComponentMask MakeComponentMask() {
+	ComponentMask mask = 0;
+	int expand[] = { 0, (mask |= ComponentTypes::GetMask<Ts>(), 0)... };
+	(void)expand;
+	return mask;
+}
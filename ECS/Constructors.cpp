@@ -1,3 +1,4 @@
 #include "Constructors.h"
 
-unordered_map<std::string, RenderingComponent> Constructors::m_renderingComponents;
\ No newline at end of file
+unordered_map<StringId, BoundingBox> Constructors::m_boundingBoxes;
+PrefabBinding Constructors::m_binding = nullptr;
\ No newline at end of file
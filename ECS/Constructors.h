@@ -1,91 +1,94 @@
 #pragma once
-#include "Game.h"
-#include "ContentManager.h"
-#include "RenderingComponent.h"
+#include "Simulation.h"
+#include "CollisionComponent.h"
 #include "GlobalFunctions.h"
+#include "StringId.h"
 #include <unordered_map>
 
 using namespace DirectX;
+
+//Called after a batch of prefab entities' simulation components are recorded, so a front end can record its own
+//Prefabs are named by StringId, so spawning looks them up without building strings
+//The batch is count entities starting at first
+typedef void(*PrefabBinding)(Simulation * sim, EntityCommandBuffer& commands, EntityRef first, unsigned int count, StringId prefab);
+
 //Contains static constructors for preformed entities
+//They record into the calling thread's command buffer, so they can run in any job that reads CommandBufferResource
+//The entities exist once the simulation plays its commands back
 class Constructors {
-	static unordered_map<std::string, RenderingComponent> m_renderingComponents;
+	static unordered_map<StringId, BoundingBox> m_boundingBoxes;
+	static PrefabBinding m_binding;
 public:
-	static void Init(Game * g) {
-#if BENCHMARK >= 0
-		m_renderingComponents["testObj"] = {
-			g->m_contentManager.GetMaterial("brickLightingNormalMap"),
-			g->m_contentManager.GetMeshStore("cone.obj").m_m
-		};
-		m_renderingComponents["testObj2"] = {
-			g->m_contentManager.GetMaterial("brickLightingNormalMap"),
-			g->m_contentManager.GetMeshStore("cube.obj").m_m
-		};
-#endif
-		m_renderingComponents["groundPlane"] = {
-			g->m_contentManager.GetMaterial("Ground"),
-			g->m_contentManager.GetMeshStore("Quad.obj").m_m
-		};
+	//Sets the bounding box a prefab spawns with
+	static void SetBoundingBox(StringId prefab, const BoundingBox& bb) {
+		m_boundingBoxes[prefab] = bb;
 	}
-#if BENCHMARK >= 0
-	static void CreateTestObject(Game * game) {
-		//get entityID and add system list to game
-		EntityId eid = game->m_entities.add(vector<ISystem*>{
-			&game->m_transformSystem, 
-			&game->m_collisionSystem,
-			&game->m_renderingSystem
-		});
 
-		//get mesh and bounding box
-		MeshStore ms = game->m_contentManager.GetMeshStore("cone.obj");
-		PhysicsComponent pc;
-		pc.m_velocity = XMFLOAT3(0, 0, 0);
-		pc.m_acceleration = XMFLOAT3(0, 0, 0);
-		
-		TransformComponent tc;
-		tc.m_position = XMFLOAT3(fRand(-100, 100), fRand(0, 100), fRand(-100, 100));
-		ms.m_bb.m_collisionType = CollisionType::test1;
+	//Sets the function called after each batch of prefab entities is recorded
+	static void SetBinding(PrefabBinding binding) {
+		m_binding = binding;
+	}
 
-		//create components
-		game->m_transformSystem.Create(eid, tc, pc);
-		game->m_collisionSystem.Create(eid, ms.m_bb);
-		game->m_renderingSystem.Create(eid, &m_renderingComponents["testObj"]);
+	//Gets the bounding box a prefab spawns with
+	static BoundingBox GetBoundingBox(StringId prefab) {
+		auto found = m_boundingBoxes.find(prefab);
+		return found == m_boundingBoxes.end() ? BoundingBox() : found->second;
 	}
+	//Records count entities of a colliding prefab, calling initialize(index, tc, pc) to set up each one's transform and physics
+	//The prefab's bounding box and binding are looked up once for the whole batch
+	template <typename F>
+	static EntityRef SpawnColliders(Simulation * sim, StringId prefab, CollisionType collisionType, unsigned int count, F initialize) {
+		EntityCommandBuffer& commands = sim->GetCommands();
+		EntityRef first = commands.Create(count);
 
-	static void CreateTestObject2(Game * game) {
-		//get entityID and add system list to game
-		EntityId eid = game->m_entities.add(vector<ISystem*>{
-			&game->m_transformSystem,
-			&game->m_collisionSystem,
-			&game->m_renderingSystem
-		});
+		//get bounding box
+		BoundingBox bb = GetBoundingBox(prefab);
+		bb.m_collisionType = collisionType;
 
-		//get mesh and bounding box
-		MeshStore ms = game->m_contentManager.GetMeshStore("cube.obj");
-		PhysicsComponent pc;
-		pc.m_velocity = XMFLOAT3(0, 0, 0);
-		pc.m_acceleration = XMFLOAT3(0, 0, 0);
+		//create components
+		auto& transforms = commands.GetBatch<TransformSystem, TransformComponent, PhysicsComponent>(&sim->m_transformSystem);
+		transforms.Reserve(count);
+		for (unsigned int c = 0; c < count; c++) {
+			TransformComponent tc;
+			PhysicsComponent pc;
+			initialize(c, tc, pc);
+			transforms.Add(first + c, tc, pc);
+		}
+		commands.AddComponents(first, count, &sim->m_collisionSystem, bb);
+		Bind(sim, commands, first, count, prefab);
+		return first;
+	}
+#if BENCHMARK >= 0
+	//Records count cones at random positions
+	//Draws from the simulation's generator, so it must run in a job that writes RandomResource
+	static EntityRef SpawnTestObjects(Simulation * sim, unsigned int count) {
+		return SpawnColliders(sim, "testObj", CollisionType::test1, count, [sim](unsigned int, TransformComponent& tc, PhysicsComponent&) {
+			tc.m_position = XMFLOAT3(sim->Random(-100, 100), sim->Random(0, 100), sim->Random(-100, 100));
+		});
+	}
 
-		pc.m_rotationalVelocity = XMFLOAT3(fRand(-30, 30), fRand(-30, 30), fRand(-30, 30));
-		TransformComponent tc;
-		tc.m_position = XMFLOAT3(fRand(-100, 100), fRand(0, 100), fRand(-100, 100));
+	//Records count spinning cubes at random positions
+	//Draws from the simulation's generator, so it must run in a job that writes RandomResource
+	static EntityRef SpawnTestObjects2(Simulation * sim, unsigned int count) {
+		return SpawnColliders(sim, "testObj2", CollisionType::test2, count, [sim](unsigned int, TransformComponent& tc, PhysicsComponent& pc) {
+			pc.m_rotationalVelocity = XMFLOAT3(sim->Random(-30, 30), sim->Random(-30, 30), sim->Random(-30, 30));
+			tc.m_position = XMFLOAT3(sim->Random(-100, 100), sim->Random(0, 100), sim->Random(-100, 100));
+		});
+	}
 
-		ms.m_bb.m_collisionType = CollisionType::test2;
+	static void CreateTestObject(Simulation * sim) {
+		SpawnTestObjects(sim, 1);
+	}
 
-		//create components
-		game->m_transformSystem.Create(eid, tc, pc);
-		game->m_collisionSystem.Create(eid, ms.m_bb);
-		game->m_renderingSystem.Create(eid, &m_renderingComponents["testObj2"]);
+	static void CreateTestObject2(Simulation * sim) {
+		SpawnTestObjects2(sim, 1);
 	}
 #endif
 
-	static EntityId CreatePlayer(Game * g)
+	static EntityRef CreatePlayer(Simulation * sim)
 	{
-		EntityId eid = g->m_entities.add(vector<ISystem*>{
-			&g->m_transformSystem
-		});
-
-		//get mesh and bounding box
-		MeshStore ms = g->m_contentManager.GetMeshStore("cone.obj");
+		EntityCommandBuffer& commands = sim->GetCommands();
+		EntityRef entity = commands.Create();
 
 		PhysicsComponent pc;
 		pc.m_velocity = XMFLOAT3(0, 0, 0);
@@ -94,20 +97,17 @@ public:
 		TransformComponent tc;
 		tc.m_scale = 1.0f;
 
-		ms.m_bb.m_collisionType = CollisionType::player;
-
 		//create components
-		g->m_transformSystem.Create(eid, tc, pc); //transform system
+		commands.AddComponent(entity, &sim->m_transformSystem, tc, pc); //transform system
+		Bind(sim, commands, entity, 1, "player");
 
-		return eid;
+		return entity;
 	}
 
-	static EntityId CreateGround(Game * g, DirectX::XMFLOAT3 position, float size)
+	static EntityRef CreateGround(Simulation * sim, DirectX::XMFLOAT3 position, float size)
 	{
-		EntityId eid = g->m_entities.add(vector<ISystem*>{
-			&g->m_transformSystem,
-			&g->m_renderingSystem
-		});
+		EntityCommandBuffer& commands = sim->GetCommands();
+		EntityRef entity = commands.Create();
 
 		PhysicsComponent pc;
 		pc.m_velocity = XMFLOAT3(0, 0, 0);
@@ -119,9 +119,14 @@ public:
 		tc.m_scale = size;
 
 		//create components
-		g->m_transformSystem.Create(eid, tc, pc); //transform system
-		g->m_renderingSystem.Create(eid, &m_renderingComponents["groundPlane"]); //rendering system
+		commands.AddComponent(entity, &sim->m_transformSystem, tc, pc); //transform system
+		Bind(sim, commands, entity, 1, "groundPlane");
 
-		return eid;
+		return entity;
+	}
+private:
+	static void Bind(Simulation * sim, EntityCommandBuffer& commands, EntityRef first, unsigned int count, StringId prefab) {
+		if (m_binding)
+			m_binding(sim, commands, first, count, prefab);
 	}
-};
\ No newline at end of file
+};
@@ -53,12 +53,12 @@ void ContentManager::Init(ID3D11Device * device, ID3D11DeviceContext * context)
 	m_device = device;
 	m_context = context;
 
-	m_materials = std::unordered_map<std::string, Material>();
-	m_meshStores = std::unordered_map<std::string, MeshStore>();
-	m_samplers = std::unordered_map<std::string, ID3D11SamplerState*>();
-	m_vshaders = std::unordered_map<std::string, SimpleVertexShader*>();
-	m_textures = std::unordered_map<std::string, ID3D11ShaderResourceView*>();
-	m_cubemaps = std::unordered_map<std::string, ID3D11ShaderResourceView*>();
+	m_materials = std::unordered_map<StringId, Material>();
+	m_meshStores = std::unordered_map<StringId, MeshStore>();
+	m_samplers = std::unordered_map<StringId, ID3D11SamplerState*>();
+	m_vshaders = std::unordered_map<StringId, SimpleVertexShader*>();
+	m_textures = std::unordered_map<StringId, ID3D11ShaderResourceView*>();
+	m_cubemaps = std::unordered_map<StringId, ID3D11ShaderResourceView*>();
 	
 	std::vector<std::wstring> vshaderNames;
 	std::vector<std::wstring> pshaderNames;
@@ -112,20 +112,20 @@ void ContentManager::Init(ID3D11Device * device, ID3D11DeviceContext * context)
 	LoadParticleMaterial("snowflake", "borderSampler", "ParticleVS.cso", "BillboardGS.cso", "ParticlePS.cso", "brightSpot.png");
 }
 
-Material ContentManager::LoadMaterial(std::string name, std::string samplerName, std::string vs, std::string ps, std::string textureName, std::string normalMapName)
+Material ContentManager::LoadMaterial(StringId name, StringId samplerName, StringId vs, StringId ps, StringId textureName, StringId normalMapName)
 {
 	SimpleVertexShader* vshader = m_vshaders[vs];
 	SimplePixelShader* pshader = m_pshaders[ps];
 	ID3D11SamplerState*  sampler = m_samplers[samplerName];
-	ID3D11ShaderResourceView* texture = (textureName != "null") ? m_textures[textureName] : nullptr;
-	ID3D11ShaderResourceView * normalMap = (normalMapName != "null") ? m_textures[normalMapName] : nullptr;
+	ID3D11ShaderResourceView* texture = (textureName != StringId("null")) ? m_textures[textureName] : nullptr;
+	ID3D11ShaderResourceView * normalMap = (normalMapName != StringId("null")) ? m_textures[normalMapName] : nullptr;
 
 	Material mat = { vshader, pshader, texture, normalMap, sampler };//new Material(vshader, pshader, texture, sampler);
 	m_materials[name] = mat;
 	return mat;
 }
 
-ParticleMaterial ContentManager::LoadParticleMaterial(std::string name, std::string samplerName, std::string vs, std::string gs, std::string ps, std::string textureName) {
+ParticleMaterial ContentManager::LoadParticleMaterial(StringId name, StringId samplerName, StringId vs, StringId gs, StringId ps, StringId textureName) {
 	SimpleVertexShader* vshader = m_vshaders[vs];
 	SimpleGeometryShader * gShader = m_gshaders[gs];
 	SimplePixelShader* pshader = m_pshaders[ps];
@@ -137,7 +137,7 @@ ParticleMaterial ContentManager::LoadParticleMaterial(std::string name, std::str
 	return pMat;
 }
 
-SkyBoxMaterial ContentManager::LoadSkyBoxMaterial(std::string name, std::string samplerName, std::string vs, std::string ps, std::string textureName) {
+SkyBoxMaterial ContentManager::LoadSkyBoxMaterial(StringId name, StringId samplerName, StringId vs, StringId ps, StringId textureName) {
 	SimpleVertexShader* vshader = m_vshaders[vs];
 	SimplePixelShader* pshader = m_pshaders[ps];
 	ID3D11SamplerState*  sampler = m_samplers[samplerName];
@@ -148,37 +148,37 @@ SkyBoxMaterial ContentManager::LoadSkyBoxMaterial(std::string name, std::string
 	return sbMat;
 }
 
-MeshStore ContentManager::GetMeshStore(std::string mesh)
+MeshStore ContentManager::GetMeshStore(StringId mesh)
 {
 	return m_meshStores[mesh];
 }
 
-Material ContentManager::GetMaterial(std::string name)
+Material ContentManager::GetMaterial(StringId name)
 {
 	return m_materials[name];
 }
 
-ParticleMaterial ContentManager::GetParticleMaterial(std::string name) {
+ParticleMaterial ContentManager::GetParticleMaterial(StringId name) {
 	return m_particleMaterials[name];
 }
 
-SkyBoxMaterial ContentManager::GetSkyBoxMaterial(std::string name) {
+SkyBoxMaterial ContentManager::GetSkyBoxMaterial(StringId name) {
 	return m_skyBoxMaterials[name];
 }
 
-SimpleGeometryShader* ContentManager::GetGShader(std::string name) {
+SimpleGeometryShader* ContentManager::GetGShader(StringId name) {
 	return m_gshaders[name];
 }
 
-SimpleVertexShader* ContentManager::GetVShader(std::string name) {
+SimpleVertexShader* ContentManager::GetVShader(StringId name) {
 	return m_vshaders[name];
 }
 
-SimplePixelShader* ContentManager::GetPShader(std::string name) {
+SimplePixelShader* ContentManager::GetPShader(StringId name) {
 	return m_pshaders[name];
 }
 
-ID3D11SamplerState* ContentManager::GetSampler(std::string name) {
+ID3D11SamplerState* ContentManager::GetSampler(StringId name) {
 	return m_samplers[name];
 }
 
@@ -473,7 +473,7 @@ void ContentManager::CreateMeshStore(std::string objFile)
 			} 
 		}
 	};
-	m_meshStores[objFile] = ms;
+	m_meshStores[StringId(objFile)] = ms;
 }
 
 void ContentManager::CreateSamplers(std::string name, D3D11_TEXTURE_ADDRESS_MODE addressMode, UINT maxAnisotropy)
@@ -496,7 +496,7 @@ void ContentManager::CreateSamplers(std::string name, D3D11_TEXTURE_ADDRESS_MODE
 	if (result != S_OK)
 		printf("ERROR: Failed to create Sampler State.");
 	else
-		m_samplers[name] = sampler;
+		m_samplers[StringId(name)] = sampler;
 }
 
 void ContentManager::CreateTexture(std::wstring textureName)
@@ -510,7 +510,7 @@ void ContentManager::CreateTexture(std::wstring textureName)
 	if (result != S_OK)
 		printf("ERROR: Failed to Load Texture.");
 	std::string name(textureName.begin(), textureName.end());
-	m_textures[name] = texture;
+	m_textures[StringId(name)] = texture;
 }
 
 void ContentManager::CreateCubeMap(std::wstring cubeName)
@@ -523,7 +523,7 @@ void ContentManager::CreateCubeMap(std::wstring cubeName)
 	DirectX::CreateDDSTextureFromFile(m_device, debugPath.c_str(), 0, &cubemap);
 
 	std::string name(cubeName.begin(), cubeName.end());
-	m_cubemaps[name] = cubemap;
+	m_cubemaps[StringId(name)] = cubemap;
 }
 
 void ContentManager::CreateVShader(std::wstring shader)
@@ -536,7 +536,7 @@ void ContentManager::CreateVShader(std::wstring shader)
 		vertexShader->LoadShaderFile(shader.c_str());
 
 	std::string shaderString(shader.begin(), shader.end());
-	m_vshaders[shaderString] = vertexShader;
+	m_vshaders[StringId(shaderString)] = vertexShader;
 }
 
 void ContentManager::CreatePShader(std::wstring shader)
@@ -549,7 +549,7 @@ void ContentManager::CreatePShader(std::wstring shader)
 		pixelShader->LoadShaderFile(shader.c_str());
 
 	std::string shaderString(shader.begin(), shader.end());
-	m_pshaders[shaderString] = pixelShader;
+	m_pshaders[StringId(shaderString)] = pixelShader;
 }
 
 void ContentManager::CreateGShader(std::wstring shader)
@@ -562,7 +562,7 @@ void ContentManager::CreateGShader(std::wstring shader)
 		geometryShader->LoadShaderFile(shader.c_str());
 
 	std::string shaderString(shader.begin(), shader.end());
-	m_gshaders[shaderString] = geometryShader;
+	m_gshaders[StringId(shaderString)] = geometryShader;
 }
 
 //I took the basic code from below and modified it to work for both UNICODE and non-UNICODE character sets
@@ -13,6 +13,8 @@
 #include "Vertex.h"
 #include "RenderingComponent.h"
 #include "MeshStore.h"
+#include "StringId.h"
+#include <unordered_map>
 
 class ContentManager
 {
@@ -27,29 +29,31 @@ public:
 
 	void Init(ID3D11Device* device, ID3D11DeviceContext* context);
 
-	Material LoadMaterial(std::string name, std::string samplerName, std::string vs, std::string ps, std::string textureName, std::string normalMapName);
-	ParticleMaterial LoadParticleMaterial(std::string name, std::string samplerName, std::string vs, std::string gs, std::string ps, std::string textureName);
-	SkyBoxMaterial LoadSkyBoxMaterial(std::string name, std::string samplerName, std::string vs, std::string ps, std::string textureName);
-	MeshStore GetMeshStore(std::string);
-	Material GetMaterial(std::string);
-	ParticleMaterial GetParticleMaterial(std::string);
-	SkyBoxMaterial GetSkyBoxMaterial(std::string);
-	SimpleGeometryShader* GetGShader(std::string);
-	SimpleVertexShader* GetVShader(std::string);
-	SimplePixelShader* GetPShader(std::string);
-	ID3D11SamplerState* GetSampler(std::string);
+	//Assets are looked up by StringId, hashed from their file or material name
+	//Pass literals, which hash at compile time, or StringId(name) for names built at run time
+	Material LoadMaterial(StringId name, StringId samplerName, StringId vs, StringId ps, StringId textureName, StringId normalMapName);
+	ParticleMaterial LoadParticleMaterial(StringId name, StringId samplerName, StringId vs, StringId gs, StringId ps, StringId textureName);
+	SkyBoxMaterial LoadSkyBoxMaterial(StringId name, StringId samplerName, StringId vs, StringId ps, StringId textureName);
+	MeshStore GetMeshStore(StringId);
+	Material GetMaterial(StringId);
+	ParticleMaterial GetParticleMaterial(StringId);
+	SkyBoxMaterial GetSkyBoxMaterial(StringId);
+	SimpleGeometryShader* GetGShader(StringId);
+	SimpleVertexShader* GetVShader(StringId);
+	SimplePixelShader* GetPShader(StringId);
+	ID3D11SamplerState* GetSampler(StringId);
 
 private:
-	std::unordered_map<std::string, Material>					m_materials;	//List of materials
-	std::unordered_map<std::string, ParticleMaterial>			m_particleMaterials; //list of particle materials
-	std::unordered_map<std::string, SkyBoxMaterial>				m_skyBoxMaterials;
-	std::unordered_map<std::string, MeshStore>					m_meshStores;		//List of meshes
-	std::unordered_map<std::string, ID3D11SamplerState*>		m_samplers;		//List of sampler states
-	std::unordered_map<std::string, ID3D11ShaderResourceView*>	m_textures;	//List of textures
-	std::unordered_map<std::string, ID3D11ShaderResourceView*>	m_cubemaps;	//List of textures
-	std::unordered_map<std::string, SimpleVertexShader*>		m_vshaders;		//List of vertex shaders
-	std::unordered_map<std::string, SimplePixelShader*>			m_pshaders;		//List of pixel shaders
-	std::unordered_map<std::string, SimpleGeometryShader*>		m_gshaders;
+	std::unordered_map<StringId, Material>					m_materials;	//List of materials
+	std::unordered_map<StringId, ParticleMaterial>			m_particleMaterials; //list of particle materials
+	std::unordered_map<StringId, SkyBoxMaterial>				m_skyBoxMaterials;
+	std::unordered_map<StringId, MeshStore>					m_meshStores;		//List of meshes
+	std::unordered_map<StringId, ID3D11SamplerState*>		m_samplers;		//List of sampler states
+	std::unordered_map<StringId, ID3D11ShaderResourceView*>	m_textures;	//List of textures
+	std::unordered_map<StringId, ID3D11ShaderResourceView*>	m_cubemaps;	//List of textures
+	std::unordered_map<StringId, SimpleVertexShader*>		m_vshaders;		//List of vertex shaders
+	std::unordered_map<StringId, SimplePixelShader*>			m_pshaders;		//List of pixel shaders
+	std::unordered_map<StringId, SimpleGeometryShader*>		m_gshaders;
 
 	ID3D11Device*								m_device;		//Pointer to the D3D11 Device
 	ID3D11DeviceContext*						m_context;		//Pointer to the D3D11 Device Context
@@ -0,0 +1,122 @@
+#include "EntityCommandBuffer.h"
+#include <algorithm>
+
+namespace {
+	//The last queue this thread recorded into, so lookups after the first are lock free
+	struct ThreadCommandCache {
+		uint64_t m_queueId = 0;
+		EntityCommandBuffer* m_buffer = nullptr;
+	};
+
+	thread_local ThreadCommandCache t_cache;
+
+	atomic<uint64_t> s_nextQueueId(1);
+}
+
+size_t EntityCommandBuffer::size() const
+{
+	size_t count = m_createCount + m_destroys.size() + m_removes.size();
+	for (auto& b : m_batches)
+		count += b.second->size();
+	return count;
+}
+
+void EntityCommandBuffer::clear()
+{
+	m_createCount = 0;
+	m_destroys.clear();
+	m_removes.clear();
+	for (auto& b : m_batches)
+		b.second->clear();
+}
+
+EntityCommandQueue::EntityCommandQueue() : m_id(s_nextQueueId++)
+{
+}
+
+EntityCommandBuffer & EntityCommandQueue::GetBuffer()
+{
+	if (t_cache.m_queueId == m_id)
+		return *t_cache.m_buffer;
+	EntityCommandBuffer& buffer = AddBuffer();
+	t_cache.m_queueId = m_id;
+	t_cache.m_buffer = &buffer;
+	return buffer;
+}
+
+void EntityCommandQueue::Playback(EntityTable & entities)
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	//give every created entity its ID first, so any buffer's commands can refer to it
+	size_t createCount = 0;
+	for (auto& buffer : m_buffers)
+		createCount += buffer->m_createCount;
+	entities.ReserveAdditional(createCount);
+	for (auto& buffer : m_buffers) {
+		buffer->m_created.resize(buffer->m_createCount);
+		for (uint32_t c = 0; c < buffer->m_createCount; c++)
+			buffer->m_created[c] = entities.Create({});
+	}
+
+	//add components one system at a time
+	m_systems.clear();
+	for (auto& buffer : m_buffers) {
+		for (auto& b : buffer->m_batches) {
+			ISystem* system = b.second->GetSystem();
+			if (b.second->size() > 0 && find(m_systems.begin(), m_systems.end(), system) == m_systems.end())
+				m_systems.push_back(system);
+		}
+	}
+	for (ISystem* system : m_systems) {
+		for (auto& buffer : m_buffers) {
+			for (auto& b : buffer->m_batches) {
+				if (b.second->GetSystem() == system)
+					b.second->Playback(entities, buffer->m_created);
+			}
+		}
+	}
+
+	for (auto& buffer : m_buffers) {
+		for (auto& r : buffer->m_removes) {
+			EntityId entityId = buffer->Resolve(r.first);
+			if (entities.IsAlive(entityId) && entities.RemoveSystem(entityId, r.second))
+				r.second->Remove(entityId);
+		}
+	}
+
+	for (auto& buffer : m_buffers) {
+		for (EntityRef& d : buffer->m_destroys) {
+			//an entity can be destroyed more than once per playback, so skip handles that have already gone stale
+			EntityId entityId = buffer->Resolve(d);
+			if (!entities.IsAlive(entityId))
+				continue;
+			//call remove on the entity ID for each system associated with the entity
+			for (ISystem* s : entities.GetSystems(entityId))
+				s->Remove(entityId);
+			//free the ID in entity list
+			entities.Destroy(entityId);
+		}
+		buffer->clear();
+	}
+}
+
+size_t EntityCommandQueue::size()
+{
+	lock_guard<mutex> lock(m_mutex);
+	size_t count = 0;
+	for (auto& buffer : m_buffers)
+		count += buffer->size();
+	return count;
+}
+
+EntityCommandBuffer & EntityCommandQueue::AddBuffer()
+{
+	lock_guard<mutex> lock(m_mutex);
+	auto found = m_threadBuffers.find(this_thread::get_id());
+	if (found != m_threadBuffers.end())
+		return *found->second;
+	m_buffers.emplace_back(new EntityCommandBuffer);
+	m_threadBuffers[this_thread::get_id()] = m_buffers.back().get();
+	return *m_buffers.back();
+}
\ No newline at end of file
@@ -0,0 +1,213 @@
+#pragma once
+#include "ISystem.h"
+#include "EntityTable.h"
+#include "EntityIdTypeDef.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+//An existing entity, or one created earlier in the same command buffer that has no ID until playback
+struct EntityRef {
+	EntityId m_entityId;	//The entity, when it already exists
+	uint32_t m_pending;		//Index into the buffer's creations, or INVALID_ENTITY_INDEX for an existing entity
+
+	EntityRef(EntityId entityId) : m_entityId(entityId), m_pending(INVALID_ENTITY_INDEX) {}
+
+	bool IsPending() const {
+		return m_pending != INVALID_ENTITY_INDEX;
+	}
+
+	//Gets the entity created offset entities after this one by the same EntityCommandBuffer::Create call
+	EntityRef operator+(uint32_t offset) const {
+		return EntityRef(m_pending + offset);
+	}
+private:
+	friend class EntityCommandBuffer;
+	explicit EntityRef(uint32_t pending) : m_pending(pending) {}
+};
+
+//Recorded component creations for one system, played back together
+class ICommandBatch {
+public:
+	virtual ~ICommandBatch() {}
+
+	//Creates every recorded component whose entity is still alive
+	void virtual Playback(EntityTable& entities, const vector<EntityId>& created) = 0;
+
+	virtual ISystem* GetSystem() = 0;
+	virtual size_t size() = 0;
+	virtual void clear() = 0;
+};
+
+//Component creations recorded for one system with one set of component types
+template <typename S, typename... Ts>
+class CommandBatch : public ICommandBatch {
+public:
+	CommandBatch(S * system) : m_system(system) {}
+
+	//Records the components for one entity
+	void Add(EntityRef entity, Ts... components) {
+		m_entities.push_back(entity);
+		m_components.emplace_back(components...);
+	}
+
+	//Records the same components for count entities created by one EntityCommandBuffer::Create call
+	void AddRange(EntityRef first, uint32_t count, Ts... components) {
+		Reserve(count);
+		tuple<Ts...> value(components...);
+		for (uint32_t c = 0; c < count; c++) {
+			m_entities.push_back(first + c);
+			m_components.push_back(value);
+		}
+	}
+
+	//Makes room for count more entities without reallocating
+	void Reserve(size_t count) {
+		size_t needed = m_entities.size() + count;
+		if (needed > m_entities.capacity()) {
+			m_entities.reserve(max(needed, m_entities.capacity() * 2));
+			m_components.reserve(max(needed, m_components.capacity() * 2));
+		}
+	}
+
+	void Playback(EntityTable& entities, const vector<EntityId>& created) {
+		m_system->ReserveAdditional(m_entities.size());
+		for (size_t c = 0; c < m_entities.size(); c++) {
+			EntityId entityId = m_entities[c].IsPending() ? created[m_entities[c].m_pending] : m_entities[c].m_entityId;
+			if (!entities.IsAlive(entityId))
+				continue;
+			Create(entityId, m_components[c], index_sequence_for<Ts...>());
+			entities.AddSystem(entityId, m_system);
+		}
+	}
+
+	ISystem* GetSystem() {
+		return m_system;
+	}
+	size_t size() {
+		return m_entities.size();
+	}
+	void clear() {
+		m_entities.clear();
+		m_components.clear();
+	}
+private:
+	template <size_t... I>
+	void Create(EntityId entityId, tuple<Ts...>& components, index_sequence<I...>) {
+		m_system->Create(entityId, get<I>(components)...);
+	}
+
+	S * m_system;
+	vector<EntityRef> m_entities;
+	vector<tuple<Ts...>> m_components;
+};
+
+//Records entity changes on one thread so they can be applied later in one place
+//Nothing is applied until the owning EntityCommandQueue plays it back
+class EntityCommandBuffer {
+public:
+	//Records a new entity with no components
+	EntityRef Create() {
+		return EntityRef(m_createCount++);
+	}
+
+	//Records count new entities with no components and returns the first; the rest follow it
+	EntityRef Create(uint32_t count) {
+		EntityRef first(m_createCount);
+		m_createCount += count;
+		return first;
+	}
+
+	//Records the entity's removal from every system and from the entity table
+	void Destroy(EntityRef entity) {
+		m_destroys.push_back(entity);
+	}
+
+	//Records a call to system->Create(entityId, components...), and registers the system with the entity
+	//A system must always be recorded with the same component types
+	template <typename S, typename... Ts>
+	void AddComponent(EntityRef entity, S * system, Ts... components) {
+		GetBatch<S, Ts...>(system).Add(entity, components...);
+	}
+
+	//Records the same components for count entities created by one Create call
+	template <typename S, typename... Ts>
+	void AddComponents(EntityRef first, uint32_t count, S * system, Ts... components) {
+		GetBatch<S, Ts...>(system).AddRange(first, count, components...);
+	}
+
+	//Gets the batch AddComponent records into, so bulk spawns can look it up once
+	template <typename S, typename... Ts>
+	CommandBatch<S, Ts...>& GetBatch(S * system) {
+		typedef CommandBatch<S, Ts...> Batch;
+		type_index type = typeid(Batch);
+		for (auto& b : m_batches) {
+			if (b.first == type && b.second->GetSystem() == system)
+				return *static_cast<Batch*>(b.second.get());
+		}
+		Batch* batch = new Batch(system);
+		m_batches.emplace_back(type, unique_ptr<ICommandBatch>(batch));
+		return *batch;
+	}
+
+	//Records the removal of the entity's components from a system
+	void RemoveComponent(EntityRef entity, ISystem * system) {
+		m_removes.emplace_back(entity, system);
+	}
+
+	//Gets the ID of a recorded entity
+	//Entities created by this buffer only have one after playback, until the buffer is played back again
+	EntityId Resolve(EntityRef entity) const {
+		return entity.IsPending() ? m_created[entity.m_pending] : entity.m_entityId;
+	}
+
+	//Gets the number of recorded commands
+	size_t size() const;
+
+	//Discards every recorded command
+	void clear();
+
+	friend class EntityCommandQueue;
+private:
+	uint32_t m_createCount = 0;								//Entities recorded since the last playback
+	vector<EntityId> m_created;								//IDs given to the entities at the last playback
+	vector<EntityRef> m_destroys;
+	vector<pair<EntityRef, ISystem*>> m_removes;
+	vector<pair<type_index, unique_ptr<ICommandBatch>>> m_batches;	//One per system and component types
+};
+
+//Hands each thread its own EntityCommandBuffer, so recording never takes a lock,
+//and plays every buffer back at a single point
+class EntityCommandQueue {
+public:
+	EntityCommandQueue();
+
+	//Gets the calling thread's buffer
+	EntityCommandBuffer& GetBuffer();
+
+	//Applies every recorded command, then clears the buffers
+	//Creations come first, then component additions grouped by system, then component removals, then destructions,
+	//each in buffer order. Must not run while another thread is recording
+	void Playback(EntityTable& entities);
+
+	//Gets the number of commands waiting for playback
+	size_t size();
+private:
+	EntityCommandBuffer& AddBuffer();
+
+	mutex m_mutex;
+	vector<unique_ptr<EntityCommandBuffer>> m_buffers;				//In the order threads first recorded
+	unordered_map<thread::id, EntityCommandBuffer*> m_threadBuffers;
+	uint64_t m_id;													//Distinguishes queues in each thread's cached lookup
+	vector<ISystem*> m_systems;										//Scratch list of systems with batches during playback
+};
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+
+#define INVALID_ENTITY_INDEX 0xffffffff
+
+//A generational reference to an entity
+//The index addresses a slot in the EntityTable, the generation detects handles to slots that have since been reused
+struct EntityHandle {
+	uint32_t m_index;		//Slot in the entity table
+	uint32_t m_generation;	//Generation of the slot when the handle was issued
+
+	EntityHandle() : m_index(INVALID_ENTITY_INDEX), m_generation(0) {}
+	EntityHandle(uint32_t index, uint32_t generation) : m_index(index), m_generation(generation) {}
+
+	bool operator==(const EntityHandle& other) const {
+		return m_index == other.m_index && m_generation == other.m_generation;
+	}
+	bool operator!=(const EntityHandle& other) const {
+		return !(*this == other);
+	}
+};
+
+namespace std {
+	template <>
+	struct hash<EntityHandle> {
+		size_t operator()(const EntityHandle& handle) const {
+			return hash<uint64_t>()((static_cast<uint64_t>(handle.m_generation) << 32) | handle.m_index);
+		}
+	};
+}
@@ -1,2 +1,3 @@
 #pragma once
-typedef unsigned int EntityId;
\ No newline at end of file
+#include "EntityHandle.h"
+typedef EntityHandle EntityId;
@@ -0,0 +1,144 @@
+#pragma once
+#include "ISystem.h"
+#include "ClearArray.h"
+#include "EntityIdTypeDef.h"
+#include "Snapshot.h"
+#include <algorithm>
+#include <vector>
+#include <initializer_list>
+
+using namespace std;
+
+//An entity can have components in at most this many systems; associating one more throws
+#define MAX_ENTITY_SYSTEMS 4
+
+//Dense table of entity slots with an intrusive free list
+//Spawning and despawning only touch the slot itself, and stale handles are rejected by the generation check
+class EntityTable {
+public:
+	//Takes a free slot, or appends one, and records the systems holding the entity's components
+	EntityId Create(initializer_list<ISystem*> systems) {
+		uint32_t index;
+		if (m_firstFree != INVALID_ENTITY_INDEX)
+		{
+			index = m_firstFree;
+			m_firstFree = m_records[index].m_nextFree;
+		}
+		else
+		{
+			index = static_cast<uint32_t>(m_records.size());
+			m_records.push_back(EntityRecord());
+		}
+		EntityRecord& record = m_records[index];
+		record.m_alive = true;
+		record.m_nextFree = INVALID_ENTITY_INDEX;
+		record.m_systems.clear();
+		for (ISystem* s : systems)
+			record.m_systems.push(s);
+		m_count++;
+		return EntityId(index, record.m_generation);
+	}
+
+	//Returns the slot to the free list and bumps its generation so outstanding handles go stale
+	//Returns false if the handle was already stale
+	bool Destroy(EntityId entityId) {
+		if (!IsAlive(entityId))
+			return false;
+		EntityRecord& record = m_records[entityId.m_index];
+		record.m_alive = false;
+		record.m_generation++;
+		record.m_nextFree = m_firstFree;
+		m_firstFree = entityId.m_index;
+		m_count--;
+		return true;
+	}
+
+	//Whether the handle refers to a live entity
+	bool IsAlive(EntityId entityId) const {
+		return entityId.m_index < m_records.size()
+			&& m_records[entityId.m_index].m_alive
+			&& m_records[entityId.m_index].m_generation == entityId.m_generation;
+	}
+
+	//Returns the systems associated with a live entity
+	ClearArray<MAX_ENTITY_SYSTEMS, ISystem*>& GetSystems(EntityId entityId) {
+		return m_records[entityId.m_index].m_systems;
+	}
+
+	//Associates another system with a live entity
+	//Throws if the entity is already associated with MAX_ENTITY_SYSTEMS systems
+	void AddSystem(EntityId entityId, ISystem* system) {
+		m_records[entityId.m_index].m_systems.push(system, true);
+	}
+
+	//Dissociates a system from a live entity
+	//Returns false if the system wasn't associated with it
+	bool RemoveSystem(EntityId entityId, ISystem* system) {
+		return m_records[entityId.m_index].m_systems.remove(system);
+	}
+
+	//Pre-allocates slots for the given number of entities
+	void Reserve(size_t capacity) {
+		m_records.reserve(capacity);
+	}
+
+	//Makes room for count more entities than are alive, at least doubling the slots when they grow
+	void ReserveAdditional(size_t count) {
+		size_t needed = m_count + count;
+		if (needed > m_records.capacity())
+			m_records.reserve(max(needed, m_records.capacity() * 2));
+	}
+
+	//Adds every slot's generation and liveness to a snapshot
+	void SaveSnapshot(SnapshotWriter& writer) const {
+		vector<SnapshotEntitySlot> slots(m_records.size());
+		for (size_t c = 0; c < m_records.size(); c++)
+			slots[c] = { m_records[c].m_generation, m_records[c].m_alive ? 1u : 0u };
+		writer.AddCopy(SNAPSHOT_ENTITY_SLOTS, slots);
+	}
+
+	//Replaces every slot with a snapshot's, rebuilding the free list with the lowest dead slot first
+	//Restored entities have no systems until their components are restored
+	void Restore(const SnapshotEntitySlot* slots, size_t count) {
+		m_records.assign(count, EntityRecord());
+		m_firstFree = INVALID_ENTITY_INDEX;
+		m_count = 0;
+		for (size_t c = count; c-- > 0;) {
+			EntityRecord& record = m_records[c];
+			record.m_generation = slots[c].m_generation;
+			record.m_alive = slots[c].m_alive != 0;
+			if (record.m_alive) {
+				m_count++;
+			}
+			else {
+				record.m_nextFree = m_firstFree;
+				m_firstFree = static_cast<uint32_t>(c);
+			}
+		}
+	}
+
+	//Gets the number of slots, live or free
+	size_t size() const {
+		return m_records.size();
+	}
+
+	//Gets the number of live entities
+	size_t count() const {
+		return m_count;
+	}
+private:
+	struct EntityRecord {
+		ClearArray<MAX_ENTITY_SYSTEMS, ISystem*> m_systems;	//Systems holding this entity's components
+		uint32_t m_generation = 0;							//Incremented every time the slot is freed
+		uint32_t m_nextFree = INVALID_ENTITY_INDEX;			//Next slot in the free list while this one is dead
+		bool m_alive = false;
+	};
+
+	//Slot storage
+	vector<EntityRecord> m_records;
+
+	//Head of the free list threaded through dead slots
+	uint32_t m_firstFree = INVALID_ENTITY_INDEX;
+
+	size_t m_count = 0;
+};
@@ -0,0 +1,76 @@
+#include "FrameArena.h"
+#include <mutex>
+
+namespace {
+	//Every thread's arena, so they can all be reset at once
+	//Arenas live as long as the program, since the job system's threads do
+	mutex s_arenasMutex;
+	vector<unique_ptr<FrameArena>> s_arenas;
+
+	thread_local FrameArena* t_arena = nullptr;
+}
+
+FrameArena::FrameArena(size_t blockSize) : m_blockSize(blockSize) {
+}
+
+void* FrameArena::Allocate(size_t bytes, size_t alignment) {
+	if (m_blocks.empty())
+		NextBlock(bytes, alignment);
+	uintptr_t base = reinterpret_cast<uintptr_t>(m_blocks[m_current].m_data.get());
+	uintptr_t start = (base + m_offset + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+	if (start + bytes > base + m_blocks[m_current].m_size) {
+		NextBlock(bytes, alignment);
+		base = reinterpret_cast<uintptr_t>(m_blocks[m_current].m_data.get());
+		start = (base + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+	}
+	m_offset = start + bytes - base;
+	m_used += bytes;
+	return reinterpret_cast<void*>(start);
+}
+
+void FrameArena::NextBlock(size_t bytes, size_t alignment) {
+	//later blocks are only kept if they're big enough, so skip any that aren't
+	size_t needed = bytes + alignment;
+	size_t next = m_blocks.empty() ? 0 : m_current + 1;
+	while (next < m_blocks.size() && m_blocks[next].m_size < needed)
+		next++;
+	if (next == m_blocks.size()) {
+		Block block;
+		block.m_size = needed > m_blockSize ? needed : m_blockSize;
+		block.m_data.reset(new uint8_t[block.m_size]);
+		m_blocks.push_back(move(block));
+	}
+	m_current = next;
+	m_offset = 0;
+}
+
+void FrameArena::Reset() {
+	if (m_blocks.size() > 1) {
+		size_t total = 0;
+		for (Block& block : m_blocks)
+			total += block.m_size;
+		m_blocks.clear();
+		Block block;
+		block.m_size = total;
+		block.m_data.reset(new uint8_t[total]);
+		m_blocks.push_back(move(block));
+	}
+	m_current = 0;
+	m_offset = 0;
+	m_used = 0;
+}
+
+FrameArena & FrameArena::GetThreadArena() {
+	if (t_arena != nullptr)
+		return *t_arena;
+	lock_guard<mutex> lock(s_arenasMutex);
+	s_arenas.emplace_back(new FrameArena());
+	t_arena = s_arenas.back().get();
+	return *t_arena;
+}
+
+void FrameArena::ResetAll() {
+	lock_guard<mutex> lock(s_arenasMutex);
+	for (auto& arena : s_arenas)
+		arena->Reset();
+}
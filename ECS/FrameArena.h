@@ -0,0 +1,107 @@
+#pragma once
+#include "Span.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+
+//Size of an arena's first block. A frame that needs more gets extra blocks, merged into one at the next reset
+#define FRAME_ARENA_BLOCK_SIZE (256 * 1024)
+
+//Linear allocator for data that only lives until the end of the frame
+//Each thread has its own, so allocating is a pointer bump with no lock. Freeing does nothing; ResetAll releases everything at once
+class FrameArena {
+public:
+	explicit FrameArena(size_t blockSize = FRAME_ARENA_BLOCK_SIZE);
+
+	//Returns bytes of uninitialized storage
+	void* Allocate(size_t bytes, size_t alignment);
+
+	//Returns count default constructed Ts
+	//Their destructors are never run, so Ts must not own anything
+	template <typename T>
+	Span<T> Allocate(size_t count) {
+		static_assert(is_trivially_destructible<T>::value, "Frame arena elements are never destroyed");
+		T* data = static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+		for (size_t c = 0; c < count; c++)
+			new (data + c) T();
+		return Span<T>(data, count);
+	}
+
+	//Releases everything allocated since the last reset
+	//If the frame spilled into extra blocks they're merged, so the same frame fits in one block next time
+	void Reset();
+
+	//Bytes handed out since the last reset
+	size_t GetUsed() const {
+		return m_used;
+	}
+
+	//Gets the calling thread's arena, creating it on first use
+	static FrameArena& GetThreadArena();
+
+	//Resets every thread's arena
+	//Call once per frame, when no jobs are running and nothing allocated from an arena is still in use
+	static void ResetAll();
+private:
+	struct Block {
+		unique_ptr<uint8_t[]> m_data;
+		size_t m_size;
+	};
+
+	//Moves to the next block, adding one if none is left that fits
+	void NextBlock(size_t bytes, size_t alignment);
+
+	vector<Block> m_blocks;
+	size_t m_blockSize;
+	size_t m_current = 0;	//Block being allocated from
+	size_t m_offset = 0;	//Next free byte in the current block
+	size_t m_used = 0;
+};
+
+//An STL allocator that allocates from a frame arena, for containers that are thrown away before the frame ends
+//Deallocating does nothing, so growing a container leaves its old storage behind until the reset
+template <typename T>
+class ArenaAllocator {
+public:
+	typedef T value_type;
+	template <typename U>
+	struct rebind {
+		typedef ArenaAllocator<U> other;
+	};
+
+	//Allocates from the calling thread's arena
+	ArenaAllocator() : m_arena(&FrameArena::GetThreadArena()) {}
+	explicit ArenaAllocator(FrameArena& arena) : m_arena(&arena) {}
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : m_arena(other.m_arena) {}
+
+	T* allocate(size_t n) {
+		return static_cast<T*>(m_arena->Allocate(sizeof(T) * n, alignof(T)));
+	}
+
+	void deallocate(T*, size_t) {
+	}
+
+	template <typename U>
+	bool operator==(const ArenaAllocator<U>& other) const {
+		return m_arena == other.m_arena;
+	}
+	template <typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const {
+		return m_arena != other.m_arena;
+	}
+
+	template <typename U>
+	friend class ArenaAllocator;
+private:
+	FrameArena* m_arena;
+};
+
+//A vector in the calling thread's frame arena
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
@@ -1,50 +1,70 @@
 #pragma once
+#include "BitOps.h"
+#include "JobSystem.h"
+#include "Compaction.h"
 #include <vector>
-#include <deque>
-#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
 
 using namespace std;
 
+#define FREE_VECTOR_END 0xffffffff
+
 //A vector wrapper for easy index reuse
+//Dead slots hold the free list, and an occupancy bitmap lets iteration skip 64 dead slots at a time
+//Compact moves items down into the holes over as many frames as it needs, and the free list is only rebuilt once no holes remain
 template <typename T>
 class FreeVector {
+	static_assert(is_trivially_copyable<T>::value && sizeof(T) >= sizeof(uint32_t), "FreeVector stores its free list in the bytes of dead items");
 public:
 	FreeVector() {
 	}
 	~FreeVector() {
 	}
 
-	//Adds the given item at the first available index
+	//Adds the given item at the most recently freed index, or at the end
 	unsigned int add(T item) {
+		//while compacting there is no free list, so fill the lowest hole instead
+		unsigned int index = m_compacting ? FindHole() : static_cast<unsigned int>(m_vector.size());
+		if (index < m_vector.size())
+		{
+			m_vector[index] = item;
+		}
 		//if there are unused indices
-		if (m_freeIndices.size() > 0)
+		else if (m_firstFree != FREE_VECTOR_END)
 		{
-			//add at the first unused index
-			unsigned int index = m_freeIndices[0];
+			//pop the head of the free list and overwrite its link
+			index = m_firstFree;
+			memcpy(&m_firstFree, static_cast<const void*>(&m_vector[index]), sizeof(uint32_t));
 			m_vector[index] = item;
-			m_indexCatalog[index] = true;
-			//then remove the index
-			m_freeIndices.pop_front();
-			m_count++;
-			return index;
 		}
 		//if there are no unused indices
 		else
 		{
 			//add at the end of the vector
 			m_vector.push_back(item);
-			m_indexCatalog.push_back(true);
-			m_count++;
-			return m_vector.size() - 1;
+			if ((index & 63) == 0)
+				m_occupancy.push_back(0);
 		}
+		m_occupancy[index >> 6] |= 1ull << (index & 63);
+		m_count++;
+		return index;
 	}
 
 	//Marks an index as available
 	void free(unsigned int index) {
-		if (m_vector.size() > index && m_indexCatalog[index] == true)
+		if (used(index))
 		{
-			m_freeIndices.push_back(index);
-			m_indexCatalog[index] = false;
+			m_occupancy[index >> 6] &= ~(1ull << (index & 63));
+			if (m_compacting)
+				m_holeWord = min<size_t>(m_holeWord, index >> 6);
+			else
+			{
+				memcpy(static_cast<void*>(&m_vector[index]), &m_firstFree, sizeof(uint32_t));
+				m_firstFree = index;
+			}
 			m_count--;
 		}
 	}
@@ -59,17 +79,164 @@ public:
 		return m_count;
 	}
 
+	//Gets the number of filled slots in [begin, end)
+	size_t count(size_t begin, size_t end) {
+		size_t total = 0;
+		ForEachWord(begin, end, [&total](size_t, uint64_t bits) {
+			total += PopCount(bits);
+		});
+		return total;
+	}
+
+	//Returns whether the index holds an item
+	bool used(unsigned int index) {
+		return index < m_vector.size() && ((m_occupancy[index >> 6] >> (index & 63)) & 1) != 0;
+	}
+
 	T& operator[] (const int index) {
 		return m_vector[index];
 	}
+
+	//Calls f(index) for every filled index in ascending order
+	template <typename F>
+	void ForEachIndex(F f) {
+		ForEachIndex(0, m_vector.size(), f);
+	}
+
+	//Calls f(index) for every filled index in [begin, end) in ascending order
+	template <typename F>
+	void ForEachIndex(size_t begin, size_t end, F f) {
+		ForEachWord(begin, end, [&f](size_t base, uint64_t bits) {
+			while (bits != 0) {
+				f(static_cast<unsigned int>(base + CountTrailingZeros(bits)));
+				bits &= bits - 1;
+			}
+		});
+	}
+
+	//Calls f(index, item) for every filled index in ascending order
+	template <typename F>
+	void ForEach(F f) {
+		ForEachIndex(0, m_vector.size(), [this, &f](unsigned int index) {
+			f(index, m_vector[index]);
+		});
+	}
+
+	//Calls f(index, item) for every filled index, splitting the slots into chunks of at least grainSize across the default JobSystem
+	//Chunks start on bitmap words, so no two jobs share one
+	template <typename F>
+	void ParallelForEach(size_t grainSize, const F& f, const char* name = "FreeVector") {
+		size_t size = m_vector.size();
+		JobSystem::GetDefault().ParallelForRange(0, m_occupancy.size(), max<size_t>(1, grainSize / 64), [this, size, &f](size_t wordBegin, size_t wordEnd) {
+			ForEachIndex(wordBegin * 64, min(wordEnd * 64, size), [this, &f](unsigned int index) {
+				f(index, m_vector[index]);
+			});
+		}, name);
+	}
+	//Moves items from the end into the lowest holes until none are left or the budget runs out,
+	//calling remap(oldIndex, newIndex) for each item moved so handles can follow it
+	//Trailing dead slots are dropped as they appear, and memory is released once occupancy has stayed low
+	//Returns true when there is nothing left to move
+	template <typename F>
+	bool Compact(CompactionBudget& budget, F remap) {
+		if (!m_compacting)
+		{
+			if (m_count != m_vector.size())
+			{
+				m_compacting = true;
+				m_firstFree = FREE_VECTOR_END;
+				m_holeWord = 0;
+			}
+		}
+		if (m_compacting)
+		{
+			for (unsigned int moves = 1; ; moves++) {
+				TrimEnd();
+				unsigned int hole = FindHole();
+				if (hole >= m_vector.size())
+					break;
+				unsigned int last = static_cast<unsigned int>(m_vector.size() - 1);
+				m_vector[hole] = m_vector[last];
+				m_occupancy[hole >> 6] |= 1ull << (hole & 63);
+				m_occupancy[last >> 6] &= ~(1ull << (last & 63));
+				remap(last, hole);
+				//reading the clock costs more than a move, so only check it every so often
+				if ((moves & 63) == 0 && budget.Expired())
+					return false;
+			}
+			//every slot below the end is filled, so the free list is correctly empty
+			m_compacting = false;
+		}
+		if (m_occupancyTracker.ShouldShrink(m_vector.size(), m_vector.capacity()))
+		{
+			ShrinkToFit(m_vector);
+			ShrinkToFit(m_occupancy);
+		}
+		return true;
+	}
+
+	//Gets the number of items the vector has room for
+	size_t capacity() {
+		return m_vector.capacity();
+	}
 private:
-	//Data store
+	//Drops the dead slots at the end of the vector
+	void TrimEnd() {
+		while (!m_occupancy.empty() && m_occupancy.back() == 0)
+			m_occupancy.pop_back();
+		size_t size = m_occupancy.empty() ? 0 : (m_occupancy.size() - 1) * 64 + 64 - CountLeadingZeros(m_occupancy.back());
+		m_vector.resize(size);
+	}
+
+	//Returns the lowest dead index below the end of the vector, or the size of the vector if there is none
+	unsigned int FindHole() {
+		size_t size = m_vector.size();
+		for (; m_holeWord < m_occupancy.size(); m_holeWord++) {
+			uint64_t holes = ~m_occupancy[m_holeWord];
+			if (holes != 0)
+			{
+				size_t index = (m_holeWord << 6) + CountTrailingZeros(holes);
+				return static_cast<unsigned int>(min(index, size));
+			}
+		}
+		return static_cast<unsigned int>(size);
+	}
+
+	//Calls f(base, bits) for each bitmap word overlapping [begin, end), with bits outside the range cleared
+	template <typename F>
+	void ForEachWord(size_t begin, size_t end, F f) {
+		end = min(end, m_vector.size());
+		if (begin >= end)
+			return;
+		size_t firstWord = begin >> 6;
+		size_t lastWord = (end - 1) >> 6;
+		for (size_t w = firstWord; w <= lastWord; w++) {
+			uint64_t bits = m_occupancy[w];
+			if (w == firstWord)
+				bits &= ~0ull << (begin & 63);
+			if (w == lastWord && (end & 63) != 0)
+				bits &= (1ull << (end & 63)) - 1;
+			if (bits != 0)
+				f(w << 6, bits);
+		}
+	}
+
+	//Data store, where dead items hold the index of the next free slot
 	vector<T> m_vector;
 
-	//List of available indices before the end of the vector
-	deque<int> m_freeIndices;
+	//One bit per slot, set while the slot holds an item
+	vector<uint64_t> m_occupancy;
 
-	vector<bool> m_indexCatalog;
+	//Most recently freed index, or FREE_VECTOR_END
+	uint32_t m_firstFree = FREE_VECTOR_END;
 
 	size_t m_count = 0;
+
+	//Set from the start of a compaction until no holes are left
+	bool m_compacting = false;
+
+	//No word before this one has a hole while compacting
+	size_t m_holeWord = 0;
+
+	OccupancyTracker m_occupancyTracker;
 };
\ No newline at end of file
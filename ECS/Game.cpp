@@ -1,5 +1,9 @@
 #include "Game.h"
 #include "Constructors.h"
+#include "Profiler.h"
+#include "JobSystem.h"
+#include "FrameArena.h"
+#include "AllocationTracker.h"
 
 Game::Game(HINSTANCE hInstance) 
 	: DXCore(
@@ -17,12 +21,42 @@ Game::Game(HINSTANCE hInstance)
 void Game::Init() {
 	m_contentManager.Init(m_device, m_context);
 	m_renderingSystem.Init(this, m_swapChain, m_device, m_context, m_backBufferRTV, m_depthStencilView);
-	Constructors::Init(this);
+
+	//give Constructors the mesh bounds and attach rendering to what they create
+#if BENCHMARK >= 0
+	m_renderingComponents["testObj"] = {
+		m_contentManager.GetMaterial("brickLightingNormalMap"),
+		m_contentManager.GetMeshStore("cone.obj").m_m
+	};
+	m_renderingComponents["testObj2"] = {
+		m_contentManager.GetMaterial("brickLightingNormalMap"),
+		m_contentManager.GetMeshStore("cube.obj").m_m
+	};
+	Constructors::SetBoundingBox("testObj", m_contentManager.GetMeshStore("cone.obj").m_bb);
+	Constructors::SetBoundingBox("testObj2", m_contentManager.GetMeshStore("cube.obj").m_bb);
+#endif
+	m_renderingComponents["groundPlane"] = {
+		m_contentManager.GetMaterial("Ground"),
+		m_contentManager.GetMeshStore("Quad.obj").m_m
+	};
+	Constructors::SetBinding(&Game::BindRendering);
+
 	Constructors::CreateGround(this, DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f), 1.0f);
+	m_compactedSystems.push_back(&m_renderingSystem);
 	m_toggles.push_back(Toggle('L', &m_renderingSystem.m_fxaaToggle));
 	m_toggles.push_back(Toggle('B', &m_renderingSystem.m_bloomToggle));
+	m_toggles.push_back(Toggle('P', &m_serialSchedule));
+	m_toggles.push_back(Toggle('O', &m_pipelined));
+	m_toggles.push_back(Toggle('T', &m_captureTrace));
+	m_toggles.push_back(Toggle(VK_F5, &m_saveSnapshot));
+	m_toggles.push_back(Toggle(VK_F9, &m_loadSnapshot));
+	m_toggles.push_back(Toggle('R', &m_recordReplay));
+	m_toggles.push_back(Toggle('G', &m_sweepAndPrune));
+	Profiler::SetThreadName("Main");
 
-	m_playerId = Constructors::CreatePlayer(this);
+	EntityRef player = Constructors::CreatePlayer(this);
+	PlaybackCommands();
+	SetPlayer(GetCommands().Resolve(player));
 }
 
 //delete system objects
@@ -34,88 +68,189 @@ void Game::Update(float dt, float totalTime) {
 	for (Toggle& t : m_toggles)
 		t.Check();
 
+	if (m_captureTrace) {
+		m_captureTrace = false;
+		Profiler::BeginCapture(TRACE_FRAMES);
+	}
+
 	if (dt > m_timeStep * 4)
 		dt = m_timeStep;
 
 	m_accumulator += dt;
-
+	unsigned int ticks = 0;
 	while (m_accumulator >= m_timeStep) {
-#if BENCHMARK >= 0
-#ifdef _DEBUG
-		unsigned int newComponents = 100 * m_timeStep;
-#else
-		unsigned int newComponents = BENCHMARK * 100 * m_timeStep;
-#endif
-		for (unsigned int c = 0; c < newComponents; c++)
-		{
-			Constructors::CreateTestObject(this);
-			Constructors::CreateTestObject2(this);
-		}
-#endif
+		m_accumulator -= m_timeStep;
+		++ticks;
+	}
 
-		m_transformSystem.Update(this, m_timeStep);
-		m_collisionSystem.Update(this, m_timeStep);
-
-		auto& playerTransform = m_transformSystem.GetComponent1(m_playerId);
-		auto& playerPhysics = m_transformSystem.GetComponent2(m_playerId);
-		const float PLAYER_SPEED = 20;
-		XMVECTOR direction = XMLoadFloat3(&XMFLOAT3(0, 0, 0));
-		//forward and back
-		if (GetAsyncKeyState('W') & 0x8000)
-		{
-			direction = XMVectorAdd(direction, XMLoadFloat3(&XMFLOAT3(0, 0, 1)));
-		}
-		if (GetAsyncKeyState('S') & 0x8000)
-		{
-			direction = XMVectorAdd(direction, XMLoadFloat3(&XMFLOAT3(0, 0, -1)));
+	//a recording starts from a saved scene, so it can be replayed from the same one
+	if (m_recordReplay && !m_recorder.IsOpen()) {
+		if (!SaveSnapshot(REPLAY_SNAPSHOT_FILE) || !m_recorder.Open(REPLAY_FILE, m_timeStep)) {
+			printf("Could not start recording to %s\n", REPLAY_FILE);
+			m_recordReplay = false;
 		}
+	}
+	else if (!m_recordReplay && m_recorder.IsOpen() && !m_recorder.Close()) {
+		printf("Could not write %s\n", REPLAY_FILE);
+	}
 
-		//left and right
-		if (GetAsyncKeyState('A') & 0x8000)
-		{
-			direction = XMVectorAdd(direction, XMLoadFloat3(&XMFLOAT3(-1, 0, 0)));
-		}
-		if (GetAsyncKeyState('D') & 0x8000)
-		{
-			direction = XMVectorAdd(direction, XMLoadFloat3(&XMFLOAT3(1, 0, 0)));
+	FrameInput frame = SampleInput(dt, totalTime, ticks);
+	if (m_recorder.IsOpen() && !m_recorder.Record(frame)) {
+		printf("Could not write %s\n", REPLAY_FILE);
+		m_recorder.Close();
+		m_recordReplay = false;
+	}
+
+	m_scheduler.SetMode(m_serialSchedule ? ScheduleMode::Serial : ScheduleMode::Parallel);
+	m_collisionSystem.SetBroadphase(m_sweepAndPrune ? Broadphase::SweepAndPrune : Broadphase::Grid);
+	//the simulation fills the back frame, which is handed to the renderer once it's done
+	RenderFrame & simulated = m_frames[1 - m_frontFrame];
+	auto simulate = [this, frame, &simulated]() {
+		auto start = steady_clock::now();
+		RunFrame(frame);
+		ExtractFrame(frame, simulated);
+		m_simulationTime = duration<double, milli>(steady_clock::now() - start).count();
+	};
+	if (m_pipelined) {
+		//step on a worker while this thread draws the last frame, so the screen is always one frame behind
+		JobHandle job = JobSystem::GetDefault().Run(simulate);
+		Render(m_frames[m_frontFrame]);
+		JobSystem::GetDefault().Wait(job);
+		m_frontFrame = 1 - m_frontFrame;
+	}
+	else {
+		simulate();
+		m_frontFrame = 1 - m_frontFrame;
+		Render(m_frames[m_frontFrame]);
+	}
+
+	//the simulation is idle from here until the next frame, so it's safe to change
+	Compact();
+
+	if (m_saveSnapshot) {
+		m_saveSnapshot = false;
+		if (!SaveSnapshot(SNAPSHOT_FILE))
+			printf("Could not write %s\n", SNAPSHOT_FILE);
+	}
+	if (m_loadSnapshot) {
+		m_loadSnapshot = false;
+		//the recording can't be replayed past a jump to another scene
+		if (m_recorder.IsOpen()) {
+			m_recorder.Close();
+			m_recordReplay = false;
 		}
+		if (!LoadSnapshot(SNAPSHOT_FILE))
+			printf("Could not load %s\n", SNAPSHOT_FILE);
+		//the scene brings its own broadphase
+		m_sweepAndPrune = m_collisionSystem.GetBroadphase() == Broadphase::SweepAndPrune;
+	}
 
-		direction = XMVector3Rotate(XMVector3Normalize(direction), XMQuaternionRotationRollPitchYaw(0,m_playerRotation.y,0));
-		XMStoreFloat3(&playerPhysics.m_velocity, XMVectorScale(direction, PLAYER_SPEED));
+	//nothing from this frame's jobs is still in use
+	FrameArena::ResetAll();
 
-		XMFLOAT3 cameraPos = XMFLOAT3(playerTransform.m_position.x, 8, playerTransform.m_position.z);
-		m_renderingSystem.m_camera.SetPosition(cameraPos);
-		m_renderingSystem.m_camera.rotationQuat = playerTransform.m_rotation;
+	Profiler::MarkFrame();
+	if (Profiler::HasCapture())
+		Profiler::WriteChromeTrace("trace.json");
+}
 
-		m_accumulator -= m_timeStep;
+void Game::SaveSnapshotSections(SnapshotWriter & writer) {
+	vector<uint64_t> prefabs;
+	vector<GameSnapshotInstance> instances;
+	uint32_t prefab = 0;
+	for (auto& kv : m_renderingComponents) {
+		prefabs.push_back(kv.first.GetHash());
+		const vector<EntityId>* entities = m_renderingSystem.GetInstances(&kv.second);
+		if (entities != nullptr) {
+			for (EntityId entityId : *entities)
+				instances.push_back({ entityId, prefab });
+		}
+		prefab++;
 	}
+	writer.AddCopy(GAME_SNAPSHOT_PREFABS, prefabs);
+	writer.AddCopy(GAME_SNAPSHOT_INSTANCES, instances);
+}
 
-	m_particleSystem.Update(this, dt, totalTime);
-	m_renderingSystem.Update(this, dt, totalTime);
+void Game::LoadSnapshotSections(const SnapshotReader & reader) {
+	m_renderingSystem.Clear();
 
-	//remove all entities queued for removal
-	for (unsigned int eId : m_removeQueue) {
-		//call remove on the entity ID for each system associated with the entity
-		vector<ISystem*> systems = m_entities[eId];
-		for (ISystem* s : systems) {
-			s->Remove(eId);
+	//look up each saved prefab once
+	size_t prefabCount, instanceCount;
+	const uint64_t* prefabs = reader.Get<uint64_t>(GAME_SNAPSHOT_PREFABS, prefabCount);
+	const GameSnapshotInstance* instances = reader.Get<GameSnapshotInstance>(GAME_SNAPSHOT_INSTANCES, instanceCount);
+	if (prefabs != nullptr && instances != nullptr) {
+		vector<RenderingComponent*> components;
+		for (size_t c = 0; c < prefabCount; c++) {
+			auto found = m_renderingComponents.find(StringId::FromHash(prefabs[c]));
+			components.push_back(found == m_renderingComponents.end() ? nullptr : &found->second);
+		}
+		for (size_t c = 0; c < instanceCount; c++) {
+			const GameSnapshotInstance& instance = instances[c];
+			if (instance.m_prefab >= components.size() || components[instance.m_prefab] == nullptr || !m_entities.IsAlive(instance.m_entityId))
+				continue;
+			m_renderingSystem.Create(instance.m_entityId, components[instance.m_prefab]);
+			m_entities.AddSystem(instance.m_entityId, &m_renderingSystem);
 		}
-		//free the ID in entity list
-		m_entities.free(eId);
 	}
-	m_removeQueue.clear();
+
+	if (!m_entities.IsAlive(m_playerId)) {
+		EntityRef created = Constructors::CreatePlayer(this);
+		PlaybackCommands();
+		SetPlayer(GetCommands().Resolve(created));
+	}
 }
 
-//Removes an entity from all its systems
-void Game::QueueRemoveEntity(EntityId entityId) {
-	//bounds check
-	if (m_entities.size() > entityId)
-	{
-		m_removeQueue.add(entityId);
+//Records the rendering component registered for a prefab, if there is one
+void Game::BindRendering(Simulation * sim, EntityCommandBuffer & commands, EntityRef first, unsigned int count, StringId prefab) {
+	Game * game = static_cast<Game*>(sim);
+	auto found = game->m_renderingComponents.find(prefab);
+	if (found == game->m_renderingComponents.end())
+		return;
+	commands.AddComponents(first, count, &game->m_renderingSystem, &found->second);
+}
+
+//Reads the movement keys once per frame, so every step of the frame sees the same input
+FrameInput Game::SampleInput(float dt, float totalTime, unsigned int ticks) {
+	FrameInput frame = {};
+	frame.m_dt = dt;
+	frame.m_totalTime = totalTime;
+	frame.m_ticks = ticks;
+	frame.m_seed = static_cast<uint32_t>(rand());
+	if (GetAsyncKeyState('W') & 0x8000)
+		frame.m_moveFlags |= PLAYER_MOVE_FORWARD;
+	if (GetAsyncKeyState('S') & 0x8000)
+		frame.m_moveFlags |= PLAYER_MOVE_BACK;
+	if (GetAsyncKeyState('A') & 0x8000)
+		frame.m_moveFlags |= PLAYER_MOVE_LEFT;
+	if (GetAsyncKeyState('D') & 0x8000)
+		frame.m_moveFlags |= PLAYER_MOVE_RIGHT;
+	frame.m_pitch = m_playerRotation.x;
+	frame.m_yaw = m_playerRotation.y;
+	return frame;
+}
+
+//Copies what the renderer needs out of the simulation, with the camera following the player
+void Game::ExtractFrame(const FrameInput & input, RenderFrame & frame) {
+	m_renderingSystem.Extract(this, frame);
+	frame.m_dt = input.m_dt;
+	frame.m_totalTime = input.m_totalTime;
+	if (m_entities.IsAlive(m_playerId)) {
+		XMFLOAT3 playerPosition = m_transformSystem.GetPosition(m_playerId);
+		frame.m_cameraPosition = XMFLOAT3(playerPosition.x, 8, playerPosition.z);
+		frame.m_cameraRotation = m_transformSystem.GetRotation(m_playerId);
 	}
 }
 
+//Draws a frame on this thread, since rendering uses the immediate context
+void Game::Render(const RenderFrame & frame) {
+	auto start = steady_clock::now();
+	m_renderingSystem.Update(this, frame);
+	m_renderTime = duration<double, milli>(steady_clock::now() - start).count();
+}
+
 void Game::UpdateTitleBarForGame(std::string in) {
+	//the last frame's heap allocations, in builds that count them
+	if (AllocationTracker::IsEnabled())
+		in += " Allocations: " + std::to_string(AllocationTracker::GetFrameCounts().m_count);
 	double totalUpdateTime = m_collisionSystem.GetTotalTime() + m_particleSystem.GetTotalTime() + m_renderingSystem.GetTotalTime() + m_transformSystem.GetTotalTime();
 	XMFLOAT3 cellCounts = m_collisionSystem.GetCellCounts();
 	SetWindowText(hWnd, 
@@ -125,6 +260,13 @@ void Game::UpdateTitleBarForGame(std::string in) {
 			" Cell Divisions: " + std::to_string(static_cast<int>(cellCounts.x)) + 
 			" FXAA: "+std::to_string(m_renderingSystem.m_fxaaToggle) + 
 			" Bloom: "+std::to_string(m_renderingSystem.m_bloomToggle) + 
+			" Serial: "+std::to_string(m_serialSchedule) + 
+			" Pipelined: "+std::to_string(m_pipelined) + 
+			" Sweep and Prune: "+std::to_string(m_sweepAndPrune) + 
+			" Simulation: " + std::to_string(m_simulationTime) + "ms" +
+			" Render: " + std::to_string(m_renderTime) + "ms" +
+			" Critical Path: " + std::to_string(m_scheduler.GetCriticalPathTime()) + "ms" +
+			" Frame Work: " + std::to_string(m_scheduler.GetWorkTime()) + "ms" +
 			" Collisions: "+std::to_string((m_collisionSystem.GetTotalTime()/totalUpdateTime)) +
 			" Particles: " + std::to_string((m_particleSystem.GetTotalTime() / totalUpdateTime)) +
 			" Rendering: " + std::to_string((m_renderingSystem.GetTotalTime() / totalUpdateTime)) +
@@ -162,12 +304,10 @@ void Game::OnMouseUp(WPARAM buttonState, int x, int y)
 // --------------------------------------------------------
 void Game::OnMouseMove(WPARAM buttonState, int x, int y)
 {
-	auto& playerTransform = m_transformSystem.GetComponent1(m_playerId);
 	if (buttonState & 0x0002)
 	{
 		m_playerRotation.x += .3f*XM_PI*(y - prevMousePos.y) / 180;
 		m_playerRotation.y += .3f*XM_PI*(x - prevMousePos.x) / 180;
-		XMStoreFloat4(&playerTransform.m_rotation, XMQuaternionRotationRollPitchYaw(m_playerRotation.x, m_playerRotation.y, 0));
 	}
 
 	// Save the previous mouse position, so we have it for the future
@@ -1,32 +1,49 @@
 #pragma once
 
-#define BENCHMARK 100
-
-#include "CollisionSystem.h"
-#include "TransformSystem.h"
+#include "Simulation.h"
 #include "RenderingSystem.h"
-#include "ParticleSystem.h"
 #include "ContentManager.h"
 #include "DXCore.h"
 #include "EntityIdTypeDef.h"
 #include "Toggle.h"
+#include <string>
+#include <unordered_map>
 #include <vector>
 #include <chrono>
 #include <math.h>
 
+//Frames written to trace.json when T is pressed
+#define TRACE_FRAMES 300
+
+//Written by F5 and restored by F9
+#define SNAPSHOT_FILE "snapshot.bin"
+
+//R records every frame's input to REPLAY_FILE, starting from the scene saved to REPLAY_SNAPSHOT_FILE
+//Replay them with swamped_bench --load replay.bin --replay replay.rec
+#define REPLAY_FILE "replay.rec"
+#define REPLAY_SNAPSHOT_FILE "replay.bin"
+
+//The game's snapshot sections, after the simulation's
+enum GameSnapshotSectionId : uint32_t {
+	GAME_SNAPSHOT_PREFABS = SNAPSHOT_FRONT_END,	//StringId hash of each prefab with a rendering component
+	GAME_SNAPSHOT_INSTANCES						//GameSnapshotInstance per rendered entity
+};
+
+//A rendered entity and the index of its prefab in GAME_SNAPSHOT_PREFABS
+struct GameSnapshotInstance {
+	EntityId m_entityId;
+	uint32_t m_prefab;
+};
+
 using namespace std;
 using namespace std::chrono;
 
 //The game instance. Not a singleton
-class Game : public DXCore {
+//Adds a window, rendering and input to the simulation
+class Game : public DXCore, public Simulation {
 public:
 	//Systems
-	CollisionSystem m_collisionSystem;
-	TransformSystem m_transformSystem;
 	RenderingSystem m_renderingSystem;
-	ParticleSystem m_particleSystem;
-
-	EntityId m_playerId;
 
 	ContentManager m_contentManager;
 
@@ -38,25 +55,66 @@ public:
 	//Update for the game. The program's main loop will call this
 	void Update(float dT, float totalTime);
 
-	//Frees an entity's components, and frees its entry in m_entities
-	void QueueRemoveEntity(EntityId entityId);
-
 	POINT prevMousePos;
 	void OnMouseDown(WPARAM buttonState, int x, int y);
 	void OnMouseUp(WPARAM buttonState, int x, int y);
 	void OnMouseMove(WPARAM buttonState, int x, int y);
 
-	friend class Constructors;
 private:
-	//Associates systems with entity IDs for deletion
-	FreeVector<vector<ISystem*>> m_entities;
-	ClearVector<EntityId> m_removeQueue;
 	void UpdateTitleBarForGame(std::string in);
 
+	//Saves the rendering components, by prefab name
+	void SaveSnapshotSections(SnapshotWriter& writer);
+
+	//Restores the rendering components of prefabs this game knows, and creates a player if the snapshot has none
+	void LoadSnapshotSections(const SnapshotReader& reader);
+
+	//Rendering components for each prefab
+	unordered_map<StringId, RenderingComponent> m_renderingComponents;
+
+	//Records a prefab's rendering component for each entity Constructors record
+	static void BindRendering(Simulation * sim, EntityCommandBuffer& commands, EntityRef first, unsigned int count, StringId prefab);
+
 	vector<Toggle> m_toggles;
 
+	//Runs the scheduler's jobs one at a time when set
+	bool m_serialSchedule = false;
+
+	//Finds collision pairs with sweep and prune instead of the grid when set
+	bool m_sweepAndPrune = false;
+
+	//Starts a profiler capture when set
+	bool m_captureTrace = false;
+
+	//Save to or load from SNAPSHOT_FILE at the end of the frame when set
+	bool m_saveSnapshot = false;
+	bool m_loadSnapshot = false;
+
+	//Records to REPLAY_FILE while set
+	bool m_recordReplay = false;
+	ReplayRecorder m_recorder;
+
+	//Samples the keyboard and mouselook into the frame's input
+	FrameInput SampleInput(float dt, float totalTime, unsigned int ticks);
+
+	//Steps a frame while the last one is drawn when set, instead of stepping then drawing
+	bool m_pipelined = true;
+
+	//The simulation extracts into one while the renderer draws the other, then they swap
+	RenderFrame m_frames[2];
+	unsigned int m_frontFrame = 0;
+
+	//Milliseconds the last frame spent simulating and drawing, which overlap when pipelined
+	double m_simulationTime = 0;
+	double m_renderTime = 0;
+
+	//Copies what the renderer needs out of the simulation, with the camera following the player
+	void ExtractFrame(const FrameInput& input, RenderFrame& frame);
+
+	//Draws a frame and times it
+	void Render(const RenderFrame& frame);
+
 	float m_accumulator = 0;
-	const float m_timeStep = 1.0f / 60;
 
 	void OnResize();
 
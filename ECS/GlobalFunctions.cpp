@@ -3,4 +3,15 @@
 float fRand(float min, float max) {
 	float f = (float)rand() / RAND_MAX;
 	return min + f * (max - min);
-}
\ No newline at end of file
+}
+
+FILE* OpenStdioFile(const char* path, const char* mode) {
+#ifdef _MSC_VER
+	FILE* file = nullptr;
+	if (fopen_s(&file, path, mode) != 0)
+		return nullptr;
+	return file;
+#else
+	return fopen(path, mode);
+#endif
+}
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <cstdio>
 #include <cstdlib>
 
 float fRand(float min, float max);
+
+//Opens a file like fopen, returning nullptr on failure
+//MSVC's /sdl turns fopen's deprecation warning into an error, so it goes through fopen_s there
+FILE* OpenStdioFile(const char* path, const char* mode);
@@ -2,9 +2,19 @@
 #include "ComponentData.h"
 #include "GameForwardDecl.h"
 #include "EntityIdTypeDef.h"
+#include "Compaction.h"
 #include <vector>
 using namespace std;
 class ISystem {
 public:
 	void virtual Remove(EntityId entityId) = 0;
+
+	//Makes room for count more components, so batched creation doesn't reallocate part way through
+	void virtual ReserveAdditional(size_t count) {}
+
+	//Releases memory left over from despawned entities, a step at a time until the budget runs out
+	//Returns true when there is nothing left to do this pass
+	bool virtual Compact(CompactionBudget& budget) {
+		return true;
+	}
 };
\ No newline at end of file
@@ -0,0 +1,296 @@
+#include "JobSystem.h"
+
+namespace {
+	//Which job system and queue the current thread works for
+	thread_local JobSystem* t_jobSystem = nullptr;
+	thread_local unsigned int t_queueIndex = 0;
+
+	unsigned int s_defaultWorkerCount = 0;
+
+	//A free block in the job pool
+	struct FreeJobBlock {
+		FreeJobBlock* m_next;
+	};
+
+	//Free blocks kept by one thread
+	struct JobBlockCache {
+		FreeJobBlock* m_head = nullptr;
+		unsigned int m_count = 0;
+	};
+
+	mutex s_jobPoolMutex;
+	FreeJobBlock* s_jobPoolHead = nullptr;				//Guarded by s_jobPoolMutex
+	thread_local JobBlockCache t_jobBlocks;
+
+	//Allocates half a cache of blocks at once and returns them linked together
+	//Blocks are never given back to the heap, so the pool grows in slabs instead of a block at a time
+	FreeJobBlock* AllocateSlab() {
+		unsigned char* slab = static_cast<unsigned char*>(::operator new(JOB_BLOCK_SIZE * (JOB_POOL_CACHE / 2)));
+		FreeJobBlock* head = nullptr;
+		for (unsigned int b = JOB_POOL_CACHE / 2; b-- > 0;) {
+			FreeJobBlock* block = reinterpret_cast<FreeJobBlock*>(slab + b * JOB_BLOCK_SIZE);
+			block->m_next = head;
+			head = block;
+		}
+		return head;
+	}
+}
+
+void* JobPool::Allocate(size_t bytes)
+{
+	if (bytes > JOB_BLOCK_SIZE)
+		return ::operator new(bytes);
+	JobBlockCache& cache = t_jobBlocks;
+	if (cache.m_head == nullptr) {
+		//refill half the cache at once, so threads that mostly make jobs don't take the lock for each one
+		lock_guard<mutex> lock(s_jobPoolMutex);
+		while (s_jobPoolHead && cache.m_count < JOB_POOL_CACHE / 2) {
+			FreeJobBlock* block = s_jobPoolHead;
+			s_jobPoolHead = block->m_next;
+			block->m_next = cache.m_head;
+			cache.m_head = block;
+			cache.m_count++;
+		}
+	}
+	if (cache.m_head == nullptr) {
+		cache.m_head = AllocateSlab();
+		cache.m_count = JOB_POOL_CACHE / 2;
+	}
+	FreeJobBlock* block = cache.m_head;
+	cache.m_head = block->m_next;
+	cache.m_count--;
+	return block;
+}
+
+void JobPool::Reserve(size_t blocks)
+{
+	for (size_t reserved = 0; reserved < blocks; reserved += JOB_POOL_CACHE / 2) {
+		FreeJobBlock* head = AllocateSlab();
+		FreeJobBlock* last = head;
+		while (last->m_next)
+			last = last->m_next;
+		lock_guard<mutex> lock(s_jobPoolMutex);
+		last->m_next = s_jobPoolHead;
+		s_jobPoolHead = head;
+	}
+}
+
+void JobPool::Free(void * block, size_t bytes)
+{
+	if (bytes > JOB_BLOCK_SIZE) {
+		::operator delete(block);
+		return;
+	}
+	JobBlockCache& cache = t_jobBlocks;
+	FreeJobBlock* freed = static_cast<FreeJobBlock*>(block);
+	freed->m_next = cache.m_head;
+	cache.m_head = freed;
+	if (++cache.m_count < JOB_POOL_CACHE)
+		return;
+	//hand half back, so threads that mostly finish jobs don't hoard them
+	FreeJobBlock* first = cache.m_head;
+	FreeJobBlock* last = first;
+	for (unsigned int b = 1; b < JOB_POOL_CACHE / 2; b++)
+		last = last->m_next;
+	cache.m_head = last->m_next;
+	cache.m_count -= JOB_POOL_CACHE / 2;
+	lock_guard<mutex> lock(s_jobPoolMutex);
+	last->m_next = s_jobPoolHead;
+	s_jobPoolHead = first;
+}
+
+void JobSystem::WorkQueue::PushBack(const JobHandle & job)
+{
+	if (m_count == m_jobs.size()) {
+		//unroll the ring into a buffer twice the size
+		vector<JobHandle> grown(m_jobs.empty() ? 64 : m_jobs.size() * 2);
+		for (size_t j = 0; j < m_count; j++)
+			grown[j] = move(m_jobs[(m_front + j) % m_jobs.size()]);
+		m_jobs.swap(grown);
+		m_front = 0;
+	}
+	m_jobs[(m_front + m_count) % m_jobs.size()] = job;
+	m_count++;
+}
+
+JobHandle JobSystem::WorkQueue::PopBack()
+{
+	if (m_count == 0)
+		return nullptr;
+	m_count--;
+	return move(m_jobs[(m_front + m_count) % m_jobs.size()]);
+}
+
+JobHandle JobSystem::WorkQueue::PopFront()
+{
+	if (m_count == 0)
+		return nullptr;
+	JobHandle job = move(m_jobs[m_front]);
+	m_front = (m_front + 1) % m_jobs.size();
+	m_count--;
+	return job;
+}
+
+JobSystem::JobSystem(unsigned int workerCount) : m_queuedJobs(0), m_stopping(false)
+{
+	if (workerCount == 0) {
+		unsigned int hardwareThreads = thread::hardware_concurrency();
+		workerCount = (hardwareThreads > 1) ? hardwareThreads - 1 : 1;
+	}
+	for (unsigned int q = 0; q <= workerCount; q++)
+		m_queues.emplace_back(new WorkQueue);
+	for (unsigned int w = 1; w <= workerCount; w++)
+		m_workers.emplace_back(&JobSystem::WorkerLoop, this, w);
+	//every thread can keep most of a cache of free blocks, so start with enough that jobs in flight rarely have to grow the pool
+	JobPool::Reserve(m_queues.size() * JOB_POOL_CACHE * 2);
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		lock_guard<mutex> lock(m_sleepMutex);
+		m_stopping = true;
+	}
+	m_wake.notify_all();
+	for (thread& worker : m_workers)
+		worker.join();
+}
+
+JobSystem & JobSystem::GetDefault()
+{
+	static JobSystem jobSystem(s_defaultWorkerCount);
+	return jobSystem;
+}
+
+void JobSystem::SetDefaultWorkerCount(unsigned int workerCount)
+{
+	s_defaultWorkerCount = workerCount;
+}
+
+void JobSystem::AddContinuation(const JobHandle & job, const JobHandle & continuation)
+{
+	{
+		lock_guard<mutex> lock(job->m_mutex);
+		if (!job->m_finished) {
+			job->m_continuations.push_back(continuation);
+			return;
+		}
+	}
+	Submit(continuation);
+}
+
+void JobSystem::Wait(const JobHandle & job)
+{
+	for (;;) {
+		{
+			lock_guard<mutex> lock(job->m_mutex);
+			if (job->m_finished)
+				return;
+		}
+		if (!TryRunOne())
+			this_thread::yield();
+	}
+}
+
+void JobSystem::Wait(JobGroup & group)
+{
+	while (!group.IsDone()) {
+		if (!TryRunOne())
+			this_thread::yield();
+	}
+}
+
+size_t JobSystem::GetDefaultGrainSize(size_t count) const
+{
+	size_t pieces = m_queues.size() * 4;
+	size_t grainSize = (count + pieces - 1) / pieces;
+	return grainSize ? grainSize : 1;
+}
+
+void JobSystem::Submit(const JobHandle & job)
+{
+	WorkQueue& queue = *m_queues[GetQueueIndex()];
+	{
+		lock_guard<mutex> lock(queue.m_mutex);
+		queue.PushBack(job);
+	}
+	{
+		lock_guard<mutex> lock(m_sleepMutex);
+		++m_queuedJobs;
+	}
+	m_wake.notify_one();
+}
+
+void JobSystem::Execute(const JobHandle & job)
+{
+	job->Run();
+
+	vector<JobHandle> continuations;
+	{
+		lock_guard<mutex> lock(job->m_mutex);
+		job->m_finished = true;
+		continuations.swap(job->m_continuations);
+	}
+	for (JobHandle& continuation : continuations)
+		Submit(continuation);
+
+	//continuations are counted before the group is released, so waiting on a group covers them
+	if (job->m_group)
+		job->m_group->m_pending.fetch_sub(1, memory_order_release);
+}
+
+bool JobSystem::TryRunOne()
+{
+	unsigned int queue = GetQueueIndex();
+	JobHandle job = Pop(queue);
+	if (!job)
+		job = Steal(queue);
+	if (!job)
+		return false;
+	{
+		lock_guard<mutex> lock(m_sleepMutex);
+		--m_queuedJobs;
+	}
+	Execute(job);
+	return true;
+}
+
+JobHandle JobSystem::Pop(unsigned int queue)
+{
+	WorkQueue& own = *m_queues[queue];
+	lock_guard<mutex> lock(own.m_mutex);
+	return own.PopBack();
+}
+
+JobHandle JobSystem::Steal(unsigned int thief)
+{
+	size_t count = m_queues.size();
+	for (size_t offset = 1; offset < count; offset++) {
+		WorkQueue& victim = *m_queues[(thief + offset) % count];
+		lock_guard<mutex> lock(victim.m_mutex);
+		JobHandle job = victim.PopFront();
+		if (job)
+			return job;
+	}
+	return nullptr;
+}
+
+unsigned int JobSystem::GetQueueIndex() const
+{
+	return (t_jobSystem == this) ? t_queueIndex : 0;
+}
+
+void JobSystem::WorkerLoop(unsigned int index)
+{
+	t_jobSystem = this;
+	t_queueIndex = index;
+	Profiler::SetThreadName("Worker " + to_string(index));
+	for (;;) {
+		if (TryRunOne())
+			continue;
+		unique_lock<mutex> lock(m_sleepMutex);
+		m_wake.wait(lock, [this]() { return m_stopping || m_queuedJobs > 0; });
+		if (m_stopping)
+			return;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,242 @@
+#pragma once
+#include "Profiler.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+//Closures up to this size are stored in their job; larger ones are moved into a std::function there
+#define JOB_STORAGE_SIZE 64
+//Size of the blocks the job pool hands out; jobs and their shared_ptr control blocks fit in one
+#define JOB_BLOCK_SIZE 256
+//Free blocks each thread keeps before handing them back to the shared list
+#define JOB_POOL_CACHE 128
+
+struct Job;
+typedef shared_ptr<Job> JobHandle;
+
+//Recycles the memory of finished jobs, so queuing work doesn't allocate once as many jobs have been in flight before
+//Each thread keeps a few free blocks of its own and trades them with a shared list, since jobs are often freed on a different thread than made them
+class JobPool {
+public:
+	static void* Allocate(size_t bytes);
+	static void Free(void* block, size_t bytes);
+	//Adds at least the given number of free blocks to the shared list
+	static void Reserve(size_t blocks);
+};
+
+//An STL allocator for the job pool, so allocate_shared puts jobs and their control blocks in pooled blocks
+template <typename T>
+class JobAllocator {
+public:
+	typedef T value_type;
+	template <typename U>
+	struct rebind {
+		typedef JobAllocator<U> other;
+	};
+
+	JobAllocator() {}
+	template <typename U>
+	JobAllocator(const JobAllocator<U>&) {}
+
+	T* allocate(size_t n) {
+		return static_cast<T*>(JobPool::Allocate(sizeof(T) * n));
+	}
+	void deallocate(T* block, size_t n) {
+		JobPool::Free(block, sizeof(T) * n);
+	}
+
+	template <typename U>
+	bool operator==(const JobAllocator<U>&) const {
+		return true;
+	}
+	template <typename U>
+	bool operator!=(const JobAllocator<U>&) const {
+		return false;
+	}
+};
+
+//Counts unfinished jobs so a caller can wait for all of them
+class JobGroup {
+public:
+	JobGroup() : m_pending(0) {}
+	bool IsDone() const {
+		return m_pending.load(memory_order_acquire) == 0;
+	}
+private:
+	friend class JobSystem;
+	atomic<unsigned int> m_pending;
+};
+
+//A queued piece of work and the continuations waiting on it
+struct Job {
+	Job() : m_run(nullptr), m_group(nullptr), m_finished(false) {}
+	~Job() {
+		//work that never ran still has to be destroyed
+		if (m_run)
+			m_run(m_work, false);
+	}
+
+	//Stores the work, in the job itself if it fits
+	template <typename F>
+	void SetWork(F&& work) {
+		typedef typename decay<F>::type Work;
+		SetStoredWork<Work>(forward<F>(work), integral_constant<bool, sizeof(Work) <= JOB_STORAGE_SIZE && alignof(Work) <= alignof(max_align_t)>());
+	}
+
+	//Runs the work, then destroys it so whatever it captured is released before the job is
+	void Run() {
+		void(*run)(void*, bool) = m_run;
+		m_run = nullptr;
+		run(m_work, true);
+	}
+
+	void(*m_run)(void* work, bool call);				//Calls the stored work if call is set, then destroys it
+	typename aligned_storage<JOB_STORAGE_SIZE, alignof(max_align_t)>::type m_work[1];
+	JobGroup* m_group;
+	mutex m_mutex;										//Guards m_finished and m_continuations
+	bool m_finished;
+	vector<JobHandle> m_continuations;
+private:
+	template <typename Work, typename F>
+	void SetStoredWork(F&& work, true_type) {
+		new (m_work) Work(forward<F>(work));
+		m_run = [](void* stored, bool call) {
+			Work& work = *static_cast<Work*>(stored);
+			if (call)
+				work();
+			work.~Work();
+		};
+	}
+	template <typename Work, typename F>
+	void SetStoredWork(F&& work, false_type) {
+		SetStoredWork<function<void()>>(function<void()>(forward<F>(work)), true_type());
+	}
+};
+
+//Engine-owned work-stealing thread pool
+//Each worker pushes and pops its own deque from the back and steals from the front of the others
+//Threads that wait run queued jobs instead of blocking
+class JobSystem {
+public:
+	//Zero workers means one per hardware thread, less the thread that owns the job system
+	explicit JobSystem(unsigned int workerCount = 0);
+	~JobSystem();
+
+	//Returns the shared instance, creating it on first use
+	static JobSystem& GetDefault();
+	//Sets the worker count the shared instance is created with
+	static void SetDefaultWorkerCount(unsigned int workerCount);
+
+	//Queues work, counting it in the group if one is given
+	template <typename F>
+	JobHandle Run(F&& work, JobGroup* group = nullptr) {
+		JobHandle job = MakeJob(forward<F>(work), group);
+		Submit(job);
+		return job;
+	}
+
+	//Queues work to run once another job has finished
+	template <typename F>
+	JobHandle Then(const JobHandle& job, F&& work, JobGroup* group = nullptr) {
+		JobHandle continuation = MakeJob(forward<F>(work), group);
+		AddContinuation(job, continuation);
+		return continuation;
+	}
+
+	//Runs queued jobs until the job has finished
+	void Wait(const JobHandle& job);
+
+	//Runs queued jobs until every job in the group has finished
+	void Wait(JobGroup& group);
+
+	//Calls f(rangeBegin, rangeEnd) over [begin, end), splitting the range in half until pieces are at most grainSize long
+	//Zero grain size picks one that gives every thread a few pieces. Each piece is profiled under name
+	template <typename F>
+	void ParallelForRange(size_t begin, size_t end, size_t grainSize, const F& f, const char* name = "ParallelFor") {
+		if (end <= begin)
+			return;
+		if (grainSize == 0)
+			grainSize = GetDefaultGrainSize(end - begin);
+		JobGroup group;
+		Split(begin, end, grainSize, f, name, group);
+		Wait(group);
+	}
+
+	//Calls f(i) for every i in [begin, end)
+	template <typename F>
+	void ParallelFor(size_t begin, size_t end, size_t grainSize, const F& f, const char* name = "ParallelFor") {
+		ParallelForRange(begin, end, grainSize, [&f](size_t rangeBegin, size_t rangeEnd) {
+			for (size_t i = rangeBegin; i < rangeEnd; i++)
+				f(i);
+		}, name);
+	}
+
+	//Gets the number of threads that run jobs, including the owner
+	unsigned int GetThreadCount() const {
+		return static_cast<unsigned int>(m_queues.size());
+	}
+private:
+	//A double-ended ring of jobs
+	//It only grows, so queuing doesn't allocate once a queue has been as deep before
+	struct WorkQueue {
+		mutex m_mutex;
+		vector<JobHandle> m_jobs;
+		size_t m_front = 0;
+		size_t m_count = 0;
+
+		void PushBack(const JobHandle& job);
+		JobHandle PopBack();
+		JobHandle PopFront();
+	};
+
+	template <typename F>
+	JobHandle MakeJob(F&& work, JobGroup* group) {
+		JobHandle job = allocate_shared<Job>(JobAllocator<Job>());
+		job->SetWork(forward<F>(work));
+		job->m_group = group;
+		if (group)
+			group->m_pending.fetch_add(1, memory_order_relaxed);
+		return job;
+	}
+
+	//Pushes the upper half of the range as a job and keeps the lower half until it is small enough to run here
+	template <typename F>
+	void Split(size_t begin, size_t end, size_t grainSize, const F& f, const char* name, JobGroup& group) {
+		while (end - begin > grainSize) {
+			size_t middle = begin + (end - begin) / 2;
+			Run([this, middle, end, grainSize, &f, name, &group]() {
+				Split(middle, end, grainSize, f, name, group);
+			}, &group);
+			end = middle;
+		}
+		PROFILE_ZONE(name);
+		f(begin, end);
+	}
+
+	size_t GetDefaultGrainSize(size_t count) const;
+	void AddContinuation(const JobHandle& job, const JobHandle& continuation);
+	void Submit(const JobHandle& job);
+	void Execute(const JobHandle& job);
+	bool TryRunOne();
+	JobHandle Pop(unsigned int queue);
+	JobHandle Steal(unsigned int thief);
+	unsigned int GetQueueIndex() const;
+	void WorkerLoop(unsigned int index);
+
+	vector<unique_ptr<WorkQueue>> m_queues;			//Queue 0 is shared by every thread that isn't a worker
+	vector<thread> m_workers;
+	mutex m_sleepMutex;
+	condition_variable m_wake;
+	int m_queuedJobs;									//Guarded by m_sleepMutex, briefly negative when a job is taken before it is counted
+	bool m_stopping;
+};
@@ -1,110 +1,102 @@
 #pragma once
 #include "SystemBase.h"
-#include "ComponentData.h"
-#include "CollapsedComponent.h"
-#include "FreeVector.h"
+#include "SparseSet.h"
 #include "EntityIdTypeDef.h"
 #include <vector>
-#include <map>
-#include <unordered_map>
 
 //A two component system that ensures the two component lists stay in sync
 template <typename T, typename U>
 class PairedSystem : public SystemBase {
 public:
-	void virtual Update(Game * game, float dT) = 0;
+	void virtual Update(Simulation * sim, float dT) = 0;
 
-	//Creates a component of type T and adds it to m_components and m_handles
+	//Creates a component of type T and a component of type U at the same dense index
 	void virtual Create(EntityId entityId, T tc, U uc) {
-		ComponentData comp = { true,entityId };
-		unsigned int index = m_components1.add(tc);
-		if (entityId+1 > m_handles.size())
-			m_handles.resize(entityId+1);
-		m_handles[entityId] = index;
-		m_components2.add(uc);
-		if (index == m_componentData.size())
-			m_componentData.push_back(comp);
+		unsigned int index = m_index.Insert(entityId);
+		if (index == m_components1.size())
+		{
+			m_components1.push_back(tc);
+			m_components2.push_back(uc);
+		}
 		else
-			m_componentData[index] = comp;
+		{
+			m_components1[index] = tc;
+			m_components2[index] = uc;
+		}
 	}
 
-	//Deactivates the component with the given ID, frees the space in m_components, and erases the handle
+	//Removes both components, moving the last pair into the vacated slot
 	void virtual Remove(EntityId entityId) {
-		unsigned int handle = m_handles[entityId];
-		m_componentData[handle].m_active = false;
-		m_components1.free(handle);
-		m_components2.free(handle);
-		//m_handles.free(entityId);
+		unsigned int index = m_index.Erase(entityId);
+		if (index == INVALID_DENSE_INDEX)
+			return;
+		if (index != m_components1.size() - 1)
+		{
+			m_components1[index] = m_components1.back();
+			m_components2[index] = m_components2.back();
+		}
+		m_components1.pop_back();
+		m_components2.pop_back();
 	}
 
-	void Collapse() {
-		m_collapsedCount = 0;
-		m_collapsedComponents1.resize(GetCount());
-		m_collapsedComponents2.resize(GetCount());
-		//m_collapsedEntityIds.resize(GetCount());
-		//m_collapsedHandles.resize(GetCount());
-		for (unsigned int c = 0; c < m_componentData.size(); c++)
-			if (m_componentData[c].m_active) {
-				m_collapsedComponents1[m_collapsedCount] = { m_components1[c], m_componentData[c].m_entityId,c };
-				m_collapsedComponents2[m_collapsedCount] = { m_components2[c],m_componentData[c].m_entityId,c };
-				//m_collapsedEntityIds[m_collapsedCount] = m_componentData[c].GetEntityId();
-				//m_collapsedHandles[m_collapsedCount] = c;
-				m_collapsedCount++;
-			}
+	void virtual ReserveAdditional(size_t count) {
+		m_index.ReserveAdditional(count);
+		size_t needed = m_components1.size() + count;
+		if (needed > m_components1.capacity()) {
+			m_components1.reserve(max(needed, m_components1.capacity() * 2));
+			m_components2.reserve(max(needed, m_components2.capacity() * 2));
+		}
+	}
+
+	bool virtual Compact(CompactionBudget& budget) {
+		if (!m_index.Compact(budget))
+			return false;
+		if (m_occupancyTracker.ShouldShrink(m_components1.size(), m_components1.capacity()))
+		{
+			ShrinkToFit(m_components1);
+			ShrinkToFit(m_components2);
+		}
+		return true;
 	}
 
 	//Returns a reference to the component of type T with the given ID
 	T& GetComponent1(EntityId entityId) {
-		return m_components1[m_handles[entityId]];
+		return m_components1[m_index.Get(entityId)];
 	}
 
 	//Returns a reference to the component of type U with the given ID
 	U& GetComponent2(EntityId entityId) {
-		return m_components2[m_handles[entityId]];
+		return m_components2[m_index.Get(entityId)];
 	}
 
-	//Returns a pointer to the component list for type T
-	FreeVector<T> & GetComponentList1() {
+	//Returns a reference to the dense component list for type T
+	vector<T> & GetComponentList1() {
 		return m_components1;
 	}
 
-	//Returns a pointer to the component list for type U
-	FreeVector<U> & GetComponentList2() {
+	//Returns a reference to the dense component list for type U
+	vector<U> & GetComponentList2() {
 		return m_components2;
 	}
 
-	//Returns a reference to the ComponentData vector
-	vector<ComponentData> & GetComponentData() {
-		return m_componentData;
-	}
-
 	//Gets the number of components
 	size_t GetCount() {
-		return m_components1.count();
+		return m_index.size();
 	}
 
-	//Initializes members
 	PairedSystem() : SystemBase(){
-		//m_components1 = FreeVector<T>();
-		//m_components2 = FreeVector<U>();
-		//m_collapsedEntityIds = vector<unsigned int>();
-		//m_collapsedHandles = vector<unsigned int>();
-		//m_handles = map<EntityId, unsigned int>();
 	}
 	~PairedSystem() {}
 protected:
+	//Maps entities to the shared dense index of both component lists
+	SparseIndex m_index;
+
 	//Holds components of type T
-	FreeVector<T> m_components1;
+	//Both lists are always packed, so systems iterate them in place
+	vector<T> m_components1;
 
 	//Holds components of type U
-	FreeVector<U> m_components2;
+	vector<U> m_components2;
 
-	vector<CollapsedComponent<T>> m_collapsedComponents1;
-	vector<CollapsedComponent<U>> m_collapsedComponents2;
-	//vector<unsigned int> m_collapsedEntityIds;
-	//vector<unsigned int> m_collapsedHandles;
-	unsigned int m_collapsedCount = 0;
-private:
-	//Holds entityId - index pairs
-	vector<unsigned int> m_handles;
+	OccupancyTracker m_occupancyTracker;
 };
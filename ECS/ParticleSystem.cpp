@@ -1,8 +1,7 @@
 #include "ParticleSystem.h"
-#include "Game.h"
-#include "GlobalFunctions.h"
+#include "Simulation.h"
 
-ParticleSystem::ParticleSystem(unsigned int maxParticles, float particleLifeTime) {
+ParticleSystem::ParticleSystem(unsigned int maxParticles, float particleLifeTime) : Timeable("ParticleSystem"), m_particleIndex(0), m_particleCount(0) {
 	m_bounds.m_max = XMFLOAT3(100, 100, 100);
 	m_bounds.m_min = XMFLOAT3(-100, 0, -100);
 	m_particlesPerSecond = maxParticles / particleLifeTime;
@@ -31,7 +30,17 @@ float ParticleSystem::GetLifeTime()
 	return m_lifeTime;
 }
 
-void ParticleSystem::Update(Game * g, float dt, float totalTime) {
+SystemAccess ParticleSystem::GetAccess() const
+{
+	return { 0, MakeComponentMask<Particle>() };
+}
+
+float ParticleSystem::Random(float min, float max)
+{
+	return uniform_real_distribution<float>(min, max)(m_random);
+}
+
+void ParticleSystem::Update(Simulation * sim, float dt, float totalTime) {
 	StartTimer();
 	//generate new particles
 	unsigned int newParticles = m_particlesPerSecond * dt;
@@ -39,10 +48,10 @@ void ParticleSystem::Update(Game * g, float dt, float totalTime) {
 		if (m_particleIndex >= m_particles.size())
 			m_particleIndex = 0;
 		Particle & p = m_particles[m_particleIndex];
-		p.m_startPosition = XMFLOAT3(fRand(-100, 100), fRand(0, 100), fRand(-100, 100));
-		p.m_velocity = XMFLOAT3(fRand(-1, 1), fRand(-2, -1), fRand(-1, 1));
+		p.m_startPosition = XMFLOAT3(Random(-100, 100), Random(0, 100), Random(-100, 100));
+		p.m_velocity = XMFLOAT3(Random(-1, 1), Random(-2, -1), Random(-1, 1));
 		p.m_birthTime = totalTime;
-		float size = fRand(.1f, .15f);
+		float size = Random(.1f, .15f);
 		p.m_size = size;
 		++m_particleIndex;
 		if (m_particleCount < m_particles.size())
@@ -1,7 +1,6 @@
 #pragma once
-#include <ppl.h>
 #include <mutex>
-#include "GameForwardDecl.h"
+#include "SimulationForwardDecl.h"
 #include "FreeVector.h"
 #include "ClearVector.h"
 #include "Particle.h"
@@ -9,17 +8,26 @@
 #include "CollapsedComponent.h"
 #include "CollisionComponent.h"
 #include "Timeable.h"
+#include "SystemAccess.h"
+#include <random>
 
 class ParticleSystem : public Timeable{
 public:
 	ParticleSystem(unsigned int maxParticles, float particleLifetime);
 	ParticleSystem();
 	~ParticleSystem();
-	void Update(Game * g, float dt, float totalTime);
+	void Update(Simulation * sim, float dt, float totalTime);
 	size_t GetParticleCount();
 	vector<Particle> & GetParticles();
 	float GetLifeTime();
+
+	//Particles touch no entity state, so they can run alongside the fixed step
+	SystemAccess GetAccess() const;
 private:
+	//Particles keep their own generator so they don't share rand()'s state with the simulation
+	float Random(float min, float max);
+
+	minstd_rand m_random;
 	vector<Particle> m_particles;
 	MaxMin m_bounds;
 	float m_lifeTime;
@@ -0,0 +1,248 @@
+#include "Profiler.h"
+#include "GlobalFunctions.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+using namespace std::chrono;
+
+namespace {
+	//A drained event and the thread it came from
+	struct CapturedEvent {
+		ProfileEvent m_event;
+		uint32_t m_threadIndex;
+	};
+
+	//Shared profiler state, guarded by m_mutex except for the enabled flag
+	struct ProfilerState {
+		mutex m_mutex;
+		vector<unique_ptr<ProfileThreadBuffer>> m_buffers;	//Never freed, so threads can keep pointers to theirs
+		vector<CapturedEvent> m_captured;
+		vector<uint64_t> m_frames;
+		vector<ZoneAllocations> m_frameAllocations;		//Reused every frame, so tracking doesn't allocate in steady state
+		unsigned int m_framesToCapture = 0;
+		atomic<bool> m_enabled;
+
+		ProfilerState() : m_enabled(true) {
+			m_frameAllocations.reserve(256);
+		}
+	};
+
+	ProfilerState& GetState() {
+		static ProfilerState state;
+		return state;
+	}
+
+	thread_local ProfileThreadBuffer* t_buffer = nullptr;
+	thread_local uint32_t t_depth = 0;
+	//Per open zone, the thread's allocations when it began and the allocations of the zones closed inside it
+	thread_local AllocationCounts t_zoneStart[PROFILER_MAX_DEPTH];
+	thread_local AllocationCounts t_zoneChildren[PROFILER_MAX_DEPTH];
+
+	ProfileThreadBuffer* GetThreadBuffer() {
+		if (t_buffer)
+			return t_buffer;
+		ProfilerState& state = GetState();
+		lock_guard<mutex> lock(state.m_mutex);
+		ProfileThreadBuffer* buffer = new ProfileThreadBuffer;
+		buffer->m_head = 0;
+		buffer->m_tail = 0;
+		buffer->m_dropped = 0;
+		buffer->m_threadIndex = static_cast<uint32_t>(state.m_buffers.size());
+		buffer->m_name = "Thread " + to_string(buffer->m_threadIndex);
+		state.m_buffers.emplace_back(buffer);
+		t_buffer = buffer;
+		return buffer;
+	}
+
+	//Copies a string into a JSON string body
+	string Escape(const string& text) {
+		string escaped;
+		for (char c : text) {
+			if (c == '"' || c == '\\')
+				escaped += '\\';
+			escaped += c;
+		}
+		return escaped;
+	}
+}
+
+uint64_t Profiler::Now()
+{
+	return static_cast<uint64_t>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+uint64_t Profiler::BeginZone()
+{
+	if (AllocationTracker::IsEnabled() && t_depth < PROFILER_MAX_DEPTH) {
+		t_zoneStart[t_depth] = AllocationTracker::GetThreadCounts();
+		t_zoneChildren[t_depth] = {};
+	}
+	++t_depth;
+	return Now();
+}
+
+uint64_t Profiler::EndZone(const char * name, uint64_t start)
+{
+	uint64_t end = Now();
+	--t_depth;
+	AllocationCounts allocations = {};
+	if (AllocationTracker::IsEnabled() && t_depth < PROFILER_MAX_DEPTH) {
+		AllocationCounts now = AllocationTracker::GetThreadCounts();
+		AllocationCounts total = { now.m_count - t_zoneStart[t_depth].m_count, now.m_bytes - t_zoneStart[t_depth].m_bytes };
+		allocations = { total.m_count - t_zoneChildren[t_depth].m_count, total.m_bytes - t_zoneChildren[t_depth].m_bytes };
+		if (t_depth > 0) {
+			t_zoneChildren[t_depth - 1].m_count += total.m_count;
+			t_zoneChildren[t_depth - 1].m_bytes += total.m_bytes;
+		}
+	}
+	if (!GetState().m_enabled.load(memory_order_relaxed))
+		return end;
+
+	ProfileThreadBuffer* buffer = GetThreadBuffer();
+	uint32_t head = buffer->m_head.load(memory_order_relaxed);
+	if (head - buffer->m_tail.load(memory_order_acquire) == PROFILER_RING_SIZE) {
+		buffer->m_dropped.fetch_add(1, memory_order_relaxed);
+		return end;
+	}
+	buffer->m_events[head & (PROFILER_RING_SIZE - 1)] = { name, start, end, t_depth, allocations };
+	buffer->m_head.store(head + 1, memory_order_release);
+	return end;
+}
+
+void Profiler::SetThreadName(const string & name)
+{
+	ProfileThreadBuffer* buffer = GetThreadBuffer();
+	lock_guard<mutex> lock(GetState().m_mutex);
+	buffer->m_name = name;
+	AllocationTracker::SetThreadName(name.c_str());
+}
+
+void Profiler::MarkFrame()
+{
+	ProfilerState& state = GetState();
+	uint64_t now = Now();
+	lock_guard<mutex> lock(state.m_mutex);
+	bool capturing = state.m_framesToCapture > 0;
+	state.m_frameAllocations.clear();
+	for (auto& buffer : state.m_buffers) {
+		uint32_t tail = buffer->m_tail.load(memory_order_relaxed);
+		uint32_t head = buffer->m_head.load(memory_order_acquire);
+		if (capturing) {
+			for (uint32_t e = tail; e != head; e++)
+				state.m_captured.push_back({ buffer->m_events[e & (PROFILER_RING_SIZE - 1)], buffer->m_threadIndex });
+		}
+		if (AllocationTracker::IsEnabled()) {
+			for (uint32_t e = tail; e != head; e++) {
+				const ProfileEvent& event = buffer->m_events[e & (PROFILER_RING_SIZE - 1)];
+				if (event.m_allocations.m_count == 0)
+					continue;
+				//few zones allocate, so a linear search on the name pointer is enough
+				auto zone = find_if(state.m_frameAllocations.begin(), state.m_frameAllocations.end(),
+					[&event](const ZoneAllocations& z) { return z.m_name == event.m_name; });
+				if (zone == state.m_frameAllocations.end())
+					state.m_frameAllocations.push_back({ event.m_name, event.m_allocations });
+				else {
+					zone->m_allocations.m_count += event.m_allocations.m_count;
+					zone->m_allocations.m_bytes += event.m_allocations.m_bytes;
+				}
+			}
+		}
+		buffer->m_tail.store(head, memory_order_release);
+	}
+	AllocationTracker::MarkFrame();
+	if (capturing) {
+		state.m_frames.push_back(now);
+		--state.m_framesToCapture;
+	}
+}
+
+void Profiler::GetFrameAllocations(vector<ZoneAllocations>& zones)
+{
+	ProfilerState& state = GetState();
+	lock_guard<mutex> lock(state.m_mutex);
+	zones = state.m_frameAllocations;
+	sort(zones.begin(), zones.end(), [](const ZoneAllocations& a, const ZoneAllocations& b) {
+		return a.m_allocations.m_bytes > b.m_allocations.m_bytes;
+	});
+}
+
+void Profiler::BeginCapture(unsigned int frames)
+{
+	ProfilerState& state = GetState();
+	lock_guard<mutex> lock(state.m_mutex);
+	state.m_captured.clear();
+	state.m_frames.clear();
+	state.m_framesToCapture = frames;
+	//the first frame starts now, so discard anything recorded before it
+	for (auto& buffer : state.m_buffers)
+		buffer->m_tail.store(buffer->m_head.load(memory_order_acquire), memory_order_release);
+	state.m_frames.push_back(Now());
+}
+
+bool Profiler::IsCapturing()
+{
+	ProfilerState& state = GetState();
+	lock_guard<mutex> lock(state.m_mutex);
+	return state.m_framesToCapture > 0;
+}
+
+bool Profiler::HasCapture()
+{
+	ProfilerState& state = GetState();
+	lock_guard<mutex> lock(state.m_mutex);
+	return state.m_framesToCapture == 0 && state.m_frames.size() > 1;
+}
+
+bool Profiler::WriteChromeTrace(const string & path)
+{
+	ProfilerState& state = GetState();
+	lock_guard<mutex> lock(state.m_mutex);
+	FILE* out = OpenStdioFile(path.c_str(), "w");
+	if (!out)
+		return false;
+
+	uint64_t origin = state.m_frames.empty() ? 0 : state.m_frames.front();
+	auto micros = [origin](uint64_t ns) {
+		return (ns >= origin) ? (ns - origin) / 1000.0 : 0.0;
+	};
+
+	fprintf(out, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+	for (auto& buffer : state.m_buffers) {
+		fprintf(out, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"%s\"}},\n",
+			buffer->m_threadIndex, Escape(buffer->m_name).c_str());
+		if (buffer->m_dropped.load() > 0)
+			fprintf(out, "{\"name\": \"dropped %llu events\", \"ph\": \"i\", \"s\": \"t\", \"pid\": 1, \"tid\": %u, \"ts\": 0},\n",
+				static_cast<unsigned long long>(buffer->m_dropped.load()), buffer->m_threadIndex);
+	}
+	for (size_t f = 1; f < state.m_frames.size(); f++) {
+		fprintf(out, "{\"name\": \"Frame %zu\", \"ph\": \"i\", \"s\": \"g\", \"pid\": 1, \"tid\": 0, \"ts\": %.3f},\n",
+			f, micros(state.m_frames[f]));
+	}
+	for (const CapturedEvent& captured : state.m_captured) {
+		const ProfileEvent& e = captured.m_event;
+		fprintf(out, "{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f, \"args\": {\"depth\": %u",
+			Escape(e.m_name).c_str(), captured.m_threadIndex, micros(e.m_start), (e.m_end - e.m_start) / 1000.0, e.m_depth);
+		if (AllocationTracker::IsEnabled())
+			fprintf(out, ", \"allocations\": %llu, \"allocated bytes\": %llu",
+				static_cast<unsigned long long>(e.m_allocations.m_count), static_cast<unsigned long long>(e.m_allocations.m_bytes));
+		fprintf(out, "}},\n");
+	}
+	//the trailing empty object keeps every event line ending in a comma
+	fprintf(out, "{}\n]}\n");
+	fclose(out);
+
+	state.m_captured.clear();
+	state.m_frames.clear();
+	return true;
+}
+
+void Profiler::SetEnabled(bool enabled)
+{
+	GetState().m_enabled = enabled;
+}
+
+bool Profiler::IsEnabled()
+{
+	return GetState().m_enabled;
+}
\ No newline at end of file
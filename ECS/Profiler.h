@@ -0,0 +1,99 @@
+#pragma once
+#include "AllocationTracker.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//Events each thread can hold between frame markers before new ones are dropped
+#define PROFILER_RING_SIZE 65536
+//Zones that can be open at once on a thread while allocations are tracked; allocations in deeper zones count toward the deepest one tracked
+#define PROFILER_MAX_DEPTH 64
+
+//A finished zone
+struct ProfileEvent {
+	const char* m_name;									//Must outlive the capture, so use string literals
+	uint64_t m_start;									//Nanoseconds
+	uint64_t m_end;
+	uint32_t m_depth;									//Zones open on the thread when this one started
+	AllocationCounts m_allocations;						//Made by the zone itself and not the zones inside it; zero unless allocations are tracked
+};
+
+//A zone's allocations over a frame, summed over every time it ran
+struct ZoneAllocations {
+	const char* m_name;
+	AllocationCounts m_allocations;
+};
+
+//A single-producer, single-consumer ring of one thread's events
+//The owning thread pushes, and whichever thread marks frames drains it
+struct ProfileThreadBuffer {
+	ProfileEvent m_events[PROFILER_RING_SIZE];
+	atomic<uint32_t> m_head;							//Written by the owning thread
+	atomic<uint32_t> m_tail;							//Written by the draining thread
+	atomic<uint64_t> m_dropped;
+	uint32_t m_threadIndex;
+	string m_name;
+};
+
+//Scoped-zone profiler with per-thread lock-free rings and Chrome trace export
+//Zones are recorded whenever the profiler is enabled and kept only while a capture is running
+class Profiler {
+public:
+	//Nanoseconds on a steady clock
+	static uint64_t Now();
+
+	//Opens a zone on this thread and returns its start time
+	static uint64_t BeginZone();
+
+	//Closes the innermost zone opened on this thread and returns its end time
+	static uint64_t EndZone(const char* name, uint64_t start);
+
+	//Names this thread in exported traces
+	static void SetThreadName(const string& name);
+
+	//Ends a frame: drains every thread's ring, keeping the events if a capture is running
+	//Also ends the allocation tracker's frame
+	static void MarkFrame();
+
+	//Copies the zones that allocated in the last frame into zones, most bytes first
+	//Allocations made outside any zone aren't included, so these can add up to less than AllocationTracker::GetFrameCounts
+	static void GetFrameAllocations(vector<ZoneAllocations>& zones);
+
+	//Keeps the events of the next number of frames
+	static void BeginCapture(unsigned int frames);
+
+	//Returns whether frames are still being captured
+	static bool IsCapturing();
+
+	//Returns whether a finished capture is waiting to be written
+	static bool HasCapture();
+
+	//Writes the captured frames as Chrome trace JSON, which Perfetto also opens, and discards them
+	static bool WriteChromeTrace(const string& path);
+
+	static void SetEnabled(bool enabled);
+	static bool IsEnabled();
+};
+
+//Records a zone from construction to destruction
+class ProfileZone {
+public:
+	ProfileZone(const char* name) : m_name(name), m_start(Profiler::BeginZone()) {
+	}
+	~ProfileZone() {
+		Profiler::EndZone(m_name, m_start);
+	}
+private:
+	const char* m_name;
+	uint64_t m_start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+//Profiles the rest of the enclosing scope
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
@@ -1,7 +1,9 @@
 #pragma once
 #include "SimpleShader.h"
-#include "FreeVector.h"
-#include "ComponentData.h"
+#include "EntityIdTypeDef.h"
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
 
 struct Material {
 	SimpleVertexShader * vertexShader;
@@ -42,7 +44,15 @@ struct SkyBoxComponent {
 	Mesh m_mesh;
 };
 
+//Packed instances of one mesh/material, with the world matrices last copied for them
+struct InstanceList {
+	std::vector<EntityId> m_entities;
+	std::vector<DirectX::XMFLOAT4X4> m_worldMatrices;	//Transposed for the instance buffer
+	std::vector<uint32_t> m_versions;					//Transform version each matrix was copied at, 0 until it is copied
+};
+
+//Locates an entity's slot in the packed instance list of its mesh/material
 struct RenderingHandle {
-	FreeVector<ComponentData> * m_rcList;
+	InstanceList * m_instances;
 	unsigned int m_index;
 };
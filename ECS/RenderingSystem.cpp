@@ -1,5 +1,8 @@
 #include "RenderingSystem.h"
 #include "Game.h"
+#include "JobSystem.h"
+
+#define INSTANCE_GRAIN_SIZE 1024
 
 RenderingSystem::~RenderingSystem() {
 	m_particleBlendState->Release();
@@ -150,41 +153,90 @@ void RenderingSystem::Init(Game * game, IDXGISwapChain * swapChain, ID3D11Device
 //Create a rendering component
 void RenderingSystem::Create(EntityId entityId, RenderingComponent * rc) {
 	//get collection in map
-	FreeVector<ComponentData> * collection = &(m_instancedComponents[rc]);
-	//create render handle and add to collection
-	m_renderHandles[entityId] = { collection, collection->add({true, entityId}) };
+	InstanceList * collection = &(m_instancedComponents[rc]);
+	//create render handle and append to collection, its matrix is built on the next extract
+	m_renderHandles.Insert(entityId, { collection, static_cast<unsigned int>(collection->m_entities.size()) });
+	collection->m_entities.push_back(entityId);
+	collection->m_worldMatrices.emplace_back();
+	collection->m_versions.push_back(0);
 }
 
 //Remove a rendering component
 void RenderingSystem::Remove(EntityId entityId) {
-	//get handle
-	RenderingHandle rh = m_renderHandles[entityId];
-	//de-activate and remove from collection if handle is valid (it won't be on a double remove)
-	if (rh.m_rcList != nullptr)
-	{
-		(*rh.m_rcList)[rh.m_index].m_active = false;
-		rh.m_rcList->free(rh.m_index);
-	}
+	//get handle (it won't exist on a double remove)
+	RenderingHandle * rh = m_renderHandles.TryGet(entityId);
+	if (rh == nullptr)
+		return;
+	//move the last instance into the vacated slot to keep the collection packed
+	InstanceList & collection = *rh->m_instances;
+	EntityId last = collection.m_entities.back();
+	collection.m_entities[rh->m_index] = last;
+	collection.m_worldMatrices[rh->m_index] = collection.m_worldMatrices.back();
+	collection.m_versions[rh->m_index] = collection.m_versions.back();
+	m_renderHandles.Get(last).m_index = rh->m_index;
+	collection.m_entities.pop_back();
+	collection.m_worldMatrices.pop_back();
+	collection.m_versions.pop_back();
 	//remove handle
-	m_renderHandles.erase(entityId);
+	m_renderHandles.Erase(entityId);
 }
 
-//Copies all active components into the collapsed component list
-void RenderingSystem::Collapse() {
-	//clear collapsed collections
-	for (auto& rcp : m_collapsedInstancedComponents) {
-		rcp.second.clear();
-	}
-	//iterate through each collection in the component map
+void RenderingSystem::Clear() {
+	m_instancedComponents.clear();
+	m_renderHandles = SparseSet<RenderingHandle>();
+}
+
+//Refreshes the cached matrices of instances whose transform changed, then copies every list into the frame
+void RenderingSystem::Extract(Game * game, RenderFrame & frame) {
+	PROFILE_ZONE("Render extract");
+	TransformSystem & ts = game->m_transformSystem;
+	//batches keep their storage from frame to frame, since the set of meshes rarely changes
+	frame.m_batches.resize(m_instancedComponents.size());
+	size_t b = 0;
 	for (auto& rcp : m_instancedComponents) {
-		FreeVector<ComponentData> & collection = rcp.second;
-		for (unsigned int c = 0; c < collection.size(); c++)
-		{
-			//if a component in the collection is active, copy its entityID to the corresponding collapsed collection
-			if (collection[c].m_active)
-				m_collapsedInstancedComponents[rcp.first].add(collection[c].m_entityId);
+		InstanceList & collection = rcp.second;
+		vector<XMFLOAT4X4> & worldMatrices = collection.m_worldMatrices;
+		JobSystem::GetDefault().ParallelFor(0, collection.m_entities.size(), INSTANCE_GRAIN_SIZE, [&](size_t c){
+			unsigned int index = ts.GetIndex(collection.m_entities[c]);
+			uint32_t version = ts.GetVersion(index);
+			if (collection.m_versions[c] == version)
+				return;
+			ts.GetWorldMatrix(index).StoreTransposed(&worldMatrices[c]);
+			collection.m_versions[c] = version;
+		}, "Instance matrices");
+
+		RenderBatch & batch = frame.m_batches[b++];
+		batch.m_component = rcp.first;
+		batch.m_worldMatrices.assign(worldMatrices.begin(), worldMatrices.end());
+	}
+
+	ParticleSystem & ps = game->m_particleSystem;
+	frame.m_particles.assign(ps.GetParticles().begin(), ps.GetParticles().begin() + ps.GetParticleCount());
+	frame.m_particleLifeTime = ps.GetLifeTime();
+}
+
+const vector<EntityId>* RenderingSystem::GetInstances(RenderingComponent * rc) {
+	auto found = m_instancedComponents.find(rc);
+	return (found == m_instancedComponents.end()) ? nullptr : &found->second.m_entities;
+}
+
+bool RenderingSystem::Compact(CompactionBudget& budget) {
+	if (!m_renderHandles.Compact(budget))
+		return false;
+	size_t instances = 0;
+	size_t capacity = 0;
+	for (auto& kv : m_instancedComponents) {
+		instances += kv.second.m_entities.size();
+		capacity += kv.second.m_entities.capacity();
+	}
+	if (m_instanceOccupancy.ShouldShrink(instances, capacity)) {
+		for (auto& kv : m_instancedComponents) {
+			ShrinkToFit(kv.second.m_entities);
+			ShrinkToFit(kv.second.m_worldMatrices);
+			ShrinkToFit(kv.second.m_versions);
 		}
 	}
+	return true;
 }
 
 void RenderingSystem::OnResize(Game * game)
@@ -300,10 +352,11 @@ void RenderingSystem::OnResize(Game * game)
 }
 
 //Draws all the stuff
-void RenderingSystem::Update(Game * game, float dt, float totalTime) {
+void RenderingSystem::Update(Game * game, const RenderFrame & frame) {
 	StartTimer();
-	Collapse();
-	m_camera.Update(dt);
+	m_camera.SetPosition(frame.m_cameraPosition);
+	m_camera.rotationQuat = frame.m_cameraRotation;
+	m_camera.Update(frame.m_dt);
 
 	// Background color (Cornflower Blue in this case) for clearing
 	const float color[4] = { 0.4f, 0.6f, 0.75f, 0.0f };
@@ -329,22 +382,17 @@ void RenderingSystem::Update(Game * game, float dt, float totalTime) {
 	m_context->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
 	//for each mesh/material combination
-	for (auto& rcp : m_collapsedInstancedComponents)
+	for (const RenderBatch& batch : frame.m_batches)
 	{
-		//assemble list of world matrices
-		RenderingComponent rc = *rcp.first;
-		ClearVector<EntityId> & collection = rcp.second;
-		vector<XMFLOAT4X4> worldMatrices;
-		worldMatrices.resize(collection.size());
-		parallel_for(size_t(0), collection.size(),[&](unsigned int c){
-			TransformComponent tc = game->m_transformSystem.GetComponent1(collection[c]);
-			XMStoreFloat4x4(&worldMatrices[c], XMMatrixTranspose(TransformSystem::GetMatrix(tc)));
-		});
+		RenderingComponent rc = *batch.m_component;
+		const vector<XMFLOAT4X4> & worldMatrices = batch.m_worldMatrices;
+		if (worldMatrices.empty())
+			continue;
 
 		//create buffer for world matrices
 		D3D11_BUFFER_DESC instDesc = {};
 		instDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-		instDesc.ByteWidth = sizeof(XMFLOAT4X4) * collection.size();
+		instDesc.ByteWidth = sizeof(XMFLOAT4X4) * worldMatrices.size();
 		instDesc.CPUAccessFlags = 0;
 		instDesc.MiscFlags = 0;
 		instDesc.StructureByteStride = 0;
@@ -396,7 +444,7 @@ void RenderingSystem::Update(Game * game, float dt, float totalTime) {
 		//draw
 		m_context->DrawIndexedInstanced(
 			m.indexCount,		// Number of indices from index buffer
-			collection.size(),	// Number of instances to actually draw
+			worldMatrices.size(),	// Number of instances to actually draw
 			0, 0, 0);
 
 		instanceBuffer->Release();
@@ -436,15 +484,15 @@ void RenderingSystem::Update(Game * game, float dt, float totalTime) {
 	m_context->RSSetState(0);
 	m_context->OMSetDepthStencilState(0, 0);
 
-	vector<Particle> & particles = game->m_particleSystem.GetParticles();
-	unsigned int particleCount = game->m_particleSystem.GetParticleCount();
+	const vector<Particle> & particles = frame.m_particles;
+	unsigned int particleCount = static_cast<unsigned int>(particles.size());
 
 	if (particleCount > 0) {
 
 		m_particleMaterial.vertexShader->SetShader();
-		m_particleMaterial.vertexShader->SetFloat("currentTime", totalTime);
+		m_particleMaterial.vertexShader->SetFloat("currentTime", frame.m_totalTime);
 		m_particleMaterial.vertexShader->SetFloat("pulses", 10);
-		m_particleMaterial.vertexShader->SetFloat("lifeTime", game->m_particleSystem.GetLifeTime());
+		m_particleMaterial.vertexShader->SetFloat("lifeTime", frame.m_particleLifeTime);
 		m_particleMaterial.geometryShader->SetShader();
 		m_particleMaterial.geometryShader->SetMatrix4x4("view", m_camera.GetView());
 		m_particleMaterial.geometryShader->SetMatrix4x4("projection", m_camera.GetProjection());
@@ -7,7 +7,7 @@
 #include "FreeVector.h"
 #include "EntityIdTypeDef.h"
 #include "ClearVector.h"
-#include "CollapsedComponent.h"
+#include "SparseSet.h"
 #include "Particle.h"
 #include "ParticleInput.h"
 #include "Timeable.h"
@@ -20,15 +20,42 @@ struct RenderingComponentData{
 	unsigned int m_instanceHandle;
 };
 
+//Instances of one mesh/material as a frame draws them
+struct RenderBatch {
+	RenderingComponent * m_component;
+	vector<XMFLOAT4X4> m_worldMatrices;	//Transposed for the instance buffer
+};
+
+//Everything a frame draws, copied out of the simulation once the frame's steps have run
+//Game keeps two, so in pipelined mode the simulation fills one while the renderer draws the other
+struct RenderFrame {
+	vector<RenderBatch> m_batches;
+	vector<Particle> m_particles;
+	float m_particleLifeTime = 0;
+	XMFLOAT3 m_cameraPosition = XMFLOAT3(0, 8, 0);
+	XMFLOAT4 m_cameraRotation = XMFLOAT4(0, 0, 0, 1);
+	float m_dt = 0;
+	float m_totalTime = 0;
+};
+
 class RenderingSystem : public ISystem , public Timeable{
 public:
-	void Update(Game * game, float dt, float totalTime);
+	//Draws a frame. Only reads the frame and the device, so it can run while the simulation steps
+	void Update(Game * game, const RenderFrame & frame);
+	//Copies the instances' world matrices and the particles into a frame
+	//Doesn't touch the device, so it can run on the simulation's thread once its steps have finished
+	void Extract(Game * game, RenderFrame & frame);
 	void Init(Game * game, IDXGISwapChain * swapChain, ID3D11Device * device, ID3D11DeviceContext * context, ID3D11RenderTargetView * renderTargetView, ID3D11DepthStencilView * depthStencilView);
 	void Create(EntityId entityId, RenderingComponent * rc);
 	void Remove(EntityId enttyId);
-	void Collapse();
+	//Removes every rendering component at once
+	void Clear();
+	//Returns the entities drawn with a rendering component, or nullptr if there are none
+	const vector<EntityId>* GetInstances(RenderingComponent * rc);
+	//Compacts the render handles, then shrinks the instance lists once they have stayed mostly empty
+	bool Compact(CompactionBudget& budget);
 	void OnResize(Game * game);
-	RenderingSystem() {};
+	RenderingSystem() : Timeable("RenderingSystem") {};
 	~RenderingSystem();
 
 	bool m_fxaaToggle = true;
@@ -41,9 +68,9 @@ private:
 	ID3D11DeviceContext*		m_context;
 	ID3D11RenderTargetView*		m_backBufferRTV;
 	ID3D11DepthStencilView*		m_depthStencilView;
-	unordered_map<RenderingComponent*, FreeVector<ComponentData>>	m_instancedComponents;
-	unordered_map<RenderingComponent*, ClearVector<EntityId>> m_collapsedInstancedComponents;
-	unordered_map<EntityId, RenderingHandle> m_renderHandles;
+	unordered_map<RenderingComponent*, InstanceList>	m_instancedComponents;	//Packed instance lists per mesh/material
+	SparseSet<RenderingHandle>	m_renderHandles;
+	OccupancyTracker			m_instanceOccupancy;
 	//DirectionalLight		m_dirLights[3];
 	Lights						m_lights;
 
@@ -0,0 +1,79 @@
+#include "Replay.h"
+#include "Simulation.h"
+#include "GlobalFunctions.h"
+#include <cstring>
+
+static const char REPLAY_MAGIC[8] = { 'S', 'W', 'A', 'M', 'P', 'R', 'E', 'C' };
+
+ReplayRecorder::~ReplayRecorder() {
+	Close();
+}
+
+bool ReplayRecorder::Open(const string& path, float timeStep) {
+	Close();
+	m_file = OpenStdioFile(path.c_str(), "wb");
+	if (m_file == nullptr)
+		return false;
+	m_failed = false;
+
+	ReplayHeader header = {};
+	memcpy(header.m_magic, REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+	header.m_version = REPLAY_VERSION;
+	header.m_benchmark = BENCHMARK;
+	header.m_timeStep = timeStep;
+	if (fwrite(&header, sizeof(header), 1, m_file) != 1) {
+		Close();
+		return false;
+	}
+	return true;
+}
+
+bool ReplayRecorder::Record(const FrameInput& frame) {
+	if (m_file == nullptr)
+		return false;
+	//stdio buffers the frames, so this doesn't touch the disk every frame
+	if (fwrite(&frame, sizeof(frame), 1, m_file) != 1)
+		m_failed = true;
+	return !m_failed;
+}
+
+bool ReplayRecorder::Close() {
+	if (m_file == nullptr)
+		return false;
+	bool ok = fclose(m_file) == 0 && !m_failed;
+	m_file = nullptr;
+	return ok;
+}
+
+bool ReplayRecorder::IsOpen() const {
+	return m_file != nullptr;
+}
+
+bool ReplayReader::Open(const string& path, float timeStep) {
+	m_frames.clear();
+	FILE* file = OpenStdioFile(path.c_str(), "rb");
+	if (file == nullptr)
+		return false;
+
+	ReplayHeader header;
+	bool valid = fread(&header, sizeof(header), 1, file) == 1
+		&& memcmp(header.m_magic, REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) == 0
+		&& header.m_version == REPLAY_VERSION
+		&& header.m_benchmark == BENCHMARK
+		&& header.m_timeStep == timeStep;
+	FrameInput frame;
+	size_t read = 0;
+	while (valid && (read = fread(&frame, 1, sizeof(frame), file)) == sizeof(frame))
+		m_frames.push_back(frame);
+	//a partial frame means the file was cut off
+	if (valid && (read != 0 || ferror(file)))
+		valid = false;
+	fclose(file);
+	if (!valid)
+		m_frames.clear();
+	return valid;
+}
+
+const vector<FrameInput>& ReplayReader::GetFrames() const {
+	return m_frames;
+}
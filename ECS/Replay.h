@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//Bumped whenever FrameInput's layout changes; older recordings are rejected rather than misread
+#define REPLAY_VERSION 1
+
+//Movement keys held during a frame
+enum PlayerMoveFlags : uint32_t {
+	PLAYER_MOVE_FORWARD = 1,
+	PLAYER_MOVE_BACK = 2,
+	PLAYER_MOVE_LEFT = 4,
+	PLAYER_MOVE_RIGHT = 8
+};
+
+//Everything from outside the simulation that one frame depends on
+//Running the same frames from the same scene gives the same simulation
+struct FrameInput {
+	float m_dt;
+	float m_totalTime;
+	uint32_t m_ticks;		//Fixed steps the frame runs
+	uint32_t m_seed;		//Seeds the simulation's random generator before the frame's steps
+	uint32_t m_moveFlags;	//PlayerMoveFlags
+	float m_pitch;			//Player rotation in radians
+	float m_yaw;
+};
+
+//Fixed header at the start of every recording
+struct ReplayHeader {
+	char m_magic[8];		//"SWAMPREC"
+	uint32_t m_version;
+	int32_t m_benchmark;	//BENCHMARK of the build that recorded, since it sets the spawn rate
+	float m_timeStep;
+};
+
+//Appends frames to a recording file as they run
+class ReplayRecorder {
+public:
+	~ReplayRecorder();
+
+	//Creates the file and writes its header
+	//Returns false if it can't be written
+	bool Open(const string& path, float timeStep);
+
+	//Appends a frame. Returns false if the write fails
+	bool Record(const FrameInput& frame);
+
+	//Flushes and closes the file. Returns false if anything failed to reach it
+	bool Close();
+
+	bool IsOpen() const;
+private:
+	FILE* m_file = nullptr;
+	bool m_failed = false;
+};
+
+//Reads a whole recording up front, so replaying it doesn't wait on the disk
+class ReplayReader {
+public:
+	//Returns false if the file can't be read, isn't a recording of this version, or was recorded with a different BENCHMARK or time step
+	bool Open(const string& path, float timeStep);
+
+	const vector<FrameInput>& GetFrames() const;
+private:
+	vector<FrameInput> m_frames;
+};
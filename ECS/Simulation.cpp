@@ -0,0 +1,185 @@
+#include "Simulation.h"
+#include "Constructors.h"
+#include "Profiler.h"
+
+Simulation::Simulation() {
+	m_compactedSystems = { &m_transformSystem, &m_collisionSystem };
+}
+
+Simulation::~Simulation() {
+}
+
+//Advances the simulation in time
+void Simulation::Step(unsigned int ticks, float dt, float totalTime) {
+	SystemAccess transformAccess = m_transformSystem.GetAccess();
+	SystemAccess collisionAccess = m_collisionSystem.GetAccess();
+	//playback can touch any system, so it waits for everything before it and everything after waits for it
+	SystemAccess playbackAccess = { 0, ~ComponentMask(0) };
+	SystemAccess playerAccess = {
+		MakeComponentMask<EntityTableResource>(),
+		MakeComponentMask<TransformComponent, PhysicsComponent>()
+	};
+
+	for (unsigned int t = 0; t < ticks; t++) {
+#if BENCHMARK >= 0
+		if (m_spawning) {
+			SystemAccess spawnAccess = { MakeComponentMask<CommandBufferResource>(), MakeComponentMask<RandomResource>() };
+			m_scheduler.AddJob("Spawn", spawnAccess, [this]() {
+#ifdef _DEBUG
+				unsigned int newComponents = 100 * m_timeStep;
+#else
+				unsigned int newComponents = BENCHMARK * 100 * m_timeStep;
+#endif
+				Constructors::SpawnTestObjects(this, newComponents);
+				Constructors::SpawnTestObjects2(this, newComponents);
+			});
+		}
+#endif
+		m_scheduler.AddJob("Player", playerAccess, [this]() { UpdatePlayer(); });
+		m_scheduler.AddJob("Transforms", transformAccess, [this]() { m_transformSystem.Update(this, m_timeStep); });
+		m_scheduler.AddJob("Collisions", collisionAccess, [this]() { m_collisionSystem.Update(this, m_timeStep); });
+		ScheduleTick();
+		m_scheduler.AddJob("Commands", playbackAccess, [this]() { PlaybackCommands(); });
+	}
+	m_scheduler.AddJob("Particles", m_particleSystem.GetAccess(), [this, dt, totalTime]() { m_particleSystem.Update(this, dt, totalTime); });
+	m_scheduler.Run();
+}
+
+//Steps with everything from outside the simulation taken from the frame
+void Simulation::RunFrame(const FrameInput& frame) {
+	m_random.seed(frame.m_seed);
+	m_input = frame;
+	Step(frame.m_ticks, frame.m_dt, frame.m_totalTime);
+}
+
+float Simulation::Random(float min, float max) {
+	//scaled by hand rather than through a distribution, whose output differs between standard libraries
+	float f = static_cast<float>(m_random() - minstd_rand::min()) / (minstd_rand::max() - minstd_rand::min());
+	return min + f * (max - min);
+}
+
+void Simulation::SetSpawning(bool spawning) {
+	m_spawning = spawning;
+}
+
+bool Simulation::IsSpawning() {
+	return m_spawning;
+}
+
+void Simulation::SetPlayer(EntityId entityId) {
+	m_playerId = entityId;
+}
+
+EntityId Simulation::GetPlayer() {
+	return m_playerId;
+}
+
+//Moves the player with the held keys, relative to where it faces, and turns it to face the input's rotation
+void Simulation::UpdatePlayer() {
+	if (!m_entities.IsAlive(m_playerId))
+		return;
+	const float PLAYER_SPEED = 20;
+	XMVECTOR direction = XMVectorZero();
+	//forward and back
+	if (m_input.m_moveFlags & PLAYER_MOVE_FORWARD)
+		direction = XMVectorAdd(direction, XMVectorSet(0, 0, 1, 0));
+	if (m_input.m_moveFlags & PLAYER_MOVE_BACK)
+		direction = XMVectorAdd(direction, XMVectorSet(0, 0, -1, 0));
+
+	//left and right
+	if (m_input.m_moveFlags & PLAYER_MOVE_LEFT)
+		direction = XMVectorAdd(direction, XMVectorSet(-1, 0, 0, 0));
+	if (m_input.m_moveFlags & PLAYER_MOVE_RIGHT)
+		direction = XMVectorAdd(direction, XMVectorSet(1, 0, 0, 0));
+
+	direction = XMVector3Rotate(XMVector3Normalize(direction), XMQuaternionRotationRollPitchYaw(0, m_input.m_yaw, 0));
+	XMFLOAT3 playerVelocity;
+	XMStoreFloat3(&playerVelocity, XMVectorScale(direction, PLAYER_SPEED));
+	m_transformSystem.SetVelocity(m_playerId, playerVelocity);
+
+	XMFLOAT4 playerRotation;
+	XMStoreFloat4(&playerRotation, XMQuaternionRotationRollPitchYaw(m_input.m_pitch, m_input.m_yaw, 0));
+	m_transformSystem.SetRotation(m_playerId, playerRotation);
+}
+
+EntityCommandBuffer & Simulation::GetCommands() {
+	return m_commands.GetBuffer();
+}
+
+void Simulation::PlaybackCommands() {
+	m_commands.Playback(m_entities);
+}
+
+//Removes an entity from all its systems
+void Simulation::QueueRemoveEntity(EntityId entityId) {
+	//generation check
+	if (m_entities.IsAlive(entityId))
+	{
+		GetCommands().Destroy(entityId);
+	}
+}
+
+//Compacts one system after another until the budget runs out
+void Simulation::Compact(double budgetMs) {
+	PROFILE_ZONE("Compact");
+	CompactionBudget budget(budgetMs);
+	for (size_t visited = 0; visited < m_compactedSystems.size() && !budget.Expired(); visited++) {
+		//a system that runs out of time is resumed first next frame
+		if (!m_compactedSystems[m_compactCursor]->Compact(budget))
+			return;
+		m_compactCursor = (m_compactCursor + 1) % m_compactedSystems.size();
+	}
+}
+
+bool Simulation::SaveSnapshot(const std::string& path) {
+	PROFILE_ZONE("Save snapshot");
+	SnapshotWriter writer;
+	m_entities.SaveSnapshot(writer);
+	m_transformSystem.SaveSnapshot(writer);
+	m_collisionSystem.SaveSnapshot(writer, SNAPSHOT_COLLISION_ENTITIES, SNAPSHOT_COLLISION_BOXES);
+	writer.Add(SNAPSHOT_PLAYER, &m_playerId, 1);
+	writer.AddCopy(SNAPSHOT_COLLISION_BROADPHASE, vector<uint32_t>{ static_cast<uint32_t>(m_collisionSystem.GetBroadphase()) });
+	SaveSnapshotSections(writer);
+	return writer.Write(path);
+}
+
+bool Simulation::LoadSnapshot(const std::string& path) {
+	PROFILE_ZONE("Load snapshot");
+	SnapshotReader reader;
+	if (!reader.Open(path))
+		return false;
+
+	//check everything before touching anything
+	size_t slotCount;
+	const SnapshotEntitySlot* slots = reader.Get<SnapshotEntitySlot>(SNAPSHOT_ENTITY_SLOTS, slotCount);
+	if (slots == nullptr
+		|| !m_transformSystem.CanLoadSnapshot(reader, slots, slotCount)
+		|| !m_collisionSystem.CanLoadSnapshot(reader, SNAPSHOT_COLLISION_ENTITIES, SNAPSHOT_COLLISION_BOXES, slots, slotCount))
+		return false;
+
+	m_entities.Restore(slots, slotCount);
+	m_transformSystem.LoadSnapshot(reader, m_entities);
+	m_collisionSystem.LoadSnapshot(reader, SNAPSHOT_COLLISION_ENTITIES, SNAPSHOT_COLLISION_BOXES, m_entities);
+	size_t playerCount;
+	const EntityId* player = reader.Get<EntityId>(SNAPSHOT_PLAYER, playerCount);
+	m_playerId = player != nullptr && playerCount == 1 ? *player : EntityId();
+	//scenes saved before the broadphase was selectable use the grid
+	size_t broadphaseCount;
+	const uint32_t* broadphase = reader.Get<uint32_t>(SNAPSHOT_COLLISION_BROADPHASE, broadphaseCount);
+	bool sweepAndPrune = broadphase != nullptr && broadphaseCount == 1 && *broadphase == static_cast<uint32_t>(Broadphase::SweepAndPrune);
+	m_collisionSystem.SetBroadphase(sweepAndPrune ? Broadphase::SweepAndPrune : Broadphase::Grid);
+	LoadSnapshotSections(reader);
+	return true;
+}
+
+size_t Simulation::GetEntityCount() {
+	return m_entities.count();
+}
+
+SystemScheduler & Simulation::GetScheduler() {
+	return m_scheduler;
+}
+
+float Simulation::GetTimeStep() {
+	return m_timeStep;
+}
\ No newline at end of file
@@ -0,0 +1,114 @@
+#pragma once
+
+//Test objects spawned per second, in hundreds. Negative disables the spawner
+#ifndef BENCHMARK
+#define BENCHMARK 100
+#endif
+
+#include "CollisionSystem.h"
+#include "TransformSystem.h"
+#include "ParticleSystem.h"
+#include "SystemScheduler.h"
+#include "EntityIdTypeDef.h"
+#include "EntityTable.h"
+#include "EntityCommandBuffer.h"
+#include "Snapshot.h"
+#include "Replay.h"
+#include <random>
+#include <string>
+
+//Entities and the systems that simulate them, with no window or device
+//Game adds rendering and input on top; swamped_bench runs it on its own
+class Simulation {
+public:
+	//Systems
+	CollisionSystem m_collisionSystem;
+	TransformSystem m_transformSystem;
+	ParticleSystem m_particleSystem;
+
+	Simulation();
+	virtual ~Simulation();
+
+	//Runs a number of fixed steps, then advances particles by dt, through the scheduler
+	//Entity commands are played back at the end of every step
+	void Step(unsigned int ticks, float dt, float totalTime);
+
+	//Runs a frame's steps from its input alone: reseeds the random generator, steers the player, then steps
+	//Recording the frames a session runs and running them again from the same scene reproduces it
+	void RunFrame(const FrameInput& frame);
+
+	//Returns a number in [min, max] from the simulation's generator, which RunFrame reseeds every frame
+	//Only jobs that write RandomResource may draw from it, so the draws happen in the same order every run
+	float Random(float min, float max);
+
+	//Sets whether each step spawns the BENCHMARK workload's test objects
+	//With spawning off, a loaded scene settles into the same number of entities every frame
+	void SetSpawning(bool spawning);
+	bool IsSpawning();
+
+	//Sets the entity that frame input steers
+	void SetPlayer(EntityId entityId);
+	EntityId GetPlayer();
+
+	//Gets the calling thread's command buffer
+	//Jobs that record into it must read CommandBufferResource
+	EntityCommandBuffer& GetCommands();
+
+	//Applies the commands recorded by every thread
+	void PlaybackCommands();
+
+	//Queues a live entity for removal from its systems and from m_entities
+	void QueueRemoveEntity(EntityId entityId);
+
+	//Spends up to the budget releasing storage left behind by despawned entities
+	//Each call picks up where the last one ran out of time, so call it once per frame outside Step
+	void Compact(double budgetMs = COMPACTION_BUDGET_MS);
+
+	//Writes every entity and its transform, physics and bounding box to a snapshot file
+	//Call between steps, with no commands waiting for playback. Particles aren't saved
+	bool SaveSnapshot(const std::string& path);
+
+	//Replaces every entity and component with a snapshot file's, mapping it and copying whole arrays instead of creating entities one by one
+	//Returns false, leaving the simulation unchanged, if the file isn't a snapshot of this version or its sections don't agree
+	//Call between steps, with no commands waiting for playback
+	bool LoadSnapshot(const std::string& path);
+
+	//Gets the number of live entities
+	size_t GetEntityCount();
+
+	//Gets the scheduler that runs each step's jobs
+	SystemScheduler& GetScheduler();
+
+	//Gets the length of a fixed step in seconds
+	float GetTimeStep();
+
+	friend class Constructors;
+protected:
+	//Lets a front end add its own jobs to each fixed step, after the simulation's
+	void virtual ScheduleTick() {}
+
+	//Let a front end save and restore its own components, in sections numbered from SNAPSHOT_FRONT_END
+	//Loading runs after the simulation's own components are restored
+	void virtual SaveSnapshotSections(SnapshotWriter& writer) {}
+	void virtual LoadSnapshotSections(const SnapshotReader& reader) {}
+
+	//Steers the player from the current frame's input
+	void UpdatePlayer();
+
+	//Associates systems with entity IDs for deletion
+	EntityTable m_entities;
+	EntityCommandQueue m_commands;
+
+	SystemScheduler m_scheduler;
+
+	//Systems Compact visits in turn; front ends add their own
+	vector<ISystem*> m_compactedSystems;
+	size_t m_compactCursor = 0;
+
+	EntityId m_playerId;
+	FrameInput m_input = {};
+	bool m_spawning = true;
+	minstd_rand m_random;
+
+	const float m_timeStep = 1.0f / 60;
+};
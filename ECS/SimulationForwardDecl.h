@@ -0,0 +1,2 @@
+#pragma once
+class Simulation;
\ No newline at end of file
@@ -0,0 +1,197 @@
+#include "Snapshot.h"
+#include "GlobalFunctions.h"
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char SNAPSHOT_MAGIC[8] = { 'S', 'W', 'A', 'M', 'P', 'S', 'N', 'P' };
+
+static uint64_t AlignOffset(uint64_t offset) {
+	return (offset + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+}
+
+bool SnapshotEntitiesAlive(const EntityId* entities, size_t count, const SnapshotEntitySlot* slots, size_t slotCount) {
+	for (size_t c = 0; c < count; c++) {
+		if (entities[c].m_index >= slotCount || !slots[entities[c].m_index].m_alive || slots[entities[c].m_index].m_generation != entities[c].m_generation)
+			return false;
+	}
+	return true;
+}
+
+void SnapshotWriter::AddRaw(uint32_t id, const void* data, uint32_t elementSize, size_t count) {
+	PendingSection pending;
+	pending.m_section.m_id = id;
+	pending.m_section.m_elementSize = elementSize;
+	pending.m_section.m_offset = 0;
+	pending.m_section.m_count = count;
+	pending.m_data = data;
+	m_sections.push_back(pending);
+}
+
+bool SnapshotWriter::Write(const string& path) {
+	//lay the sections out after the table
+	uint64_t offset = AlignOffset(sizeof(SnapshotHeader) + sizeof(SnapshotSection) * m_sections.size());
+	vector<SnapshotSection> table;
+	for (PendingSection& pending : m_sections) {
+		pending.m_section.m_offset = offset;
+		table.push_back(pending.m_section);
+		offset = AlignOffset(offset + pending.m_section.m_elementSize * pending.m_section.m_count);
+	}
+
+	SnapshotHeader header = {};
+	memcpy(header.m_magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+	header.m_version = SNAPSHOT_VERSION;
+	header.m_sectionCount = static_cast<uint32_t>(table.size());
+	header.m_size = offset;
+
+	FILE* file = OpenStdioFile(path.c_str(), "wb");
+	if (file == nullptr)
+		return false;
+	static const uint8_t padding[SNAPSHOT_ALIGNMENT] = {};
+	uint64_t written = 0;
+	//pads up to the next section, then writes it
+	auto write = [&](const void* data, uint64_t bytes, uint64_t at) {
+		if (at > written && fwrite(padding, 1, static_cast<size_t>(at - written), file) != at - written)
+			return false;
+		written = at;
+		if (bytes > 0 && fwrite(data, 1, static_cast<size_t>(bytes), file) != bytes)
+			return false;
+		written += bytes;
+		return true;
+	};
+	bool ok = write(&header, sizeof(header), 0);
+	if (ok && !table.empty())
+		ok = write(table.data(), sizeof(SnapshotSection) * table.size(), written);
+	for (size_t s = 0; ok && s < table.size(); s++)
+		ok = write(m_sections[s].m_data, table[s].m_elementSize * table[s].m_count, table[s].m_offset);
+	if (ok)
+		ok = write(nullptr, 0, header.m_size);
+	if (fclose(file) != 0)
+		ok = false;
+	return ok;
+}
+
+SnapshotReader::SnapshotReader() {
+}
+
+SnapshotReader::~SnapshotReader() {
+	Close();
+}
+
+bool SnapshotReader::Open(const string& path) {
+	Close();
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr) {
+		CloseHandle(file);
+		return false;
+	}
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == nullptr) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	m_file = file;
+	m_mapping = mapping;
+	m_data = static_cast<const uint8_t*>(view);
+	m_size = static_cast<size_t>(size.QuadPart);
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+	struct stat status;
+	if (fstat(file, &status) != 0 || status.st_size == 0) {
+		close(file);
+		return false;
+	}
+	void* view = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	//the mapping keeps the file open
+	close(file);
+	if (view == MAP_FAILED)
+		return false;
+	//a restore reads every section, so start paging the file in now
+	madvise(view, static_cast<size_t>(status.st_size), MADV_WILLNEED);
+	m_data = static_cast<const uint8_t*>(view);
+	m_size = static_cast<size_t>(status.st_size);
+#endif
+
+	//check the header and that every section lies inside the file
+	const SnapshotHeader* header = reinterpret_cast<const SnapshotHeader*>(m_data);
+	bool valid = m_size >= sizeof(SnapshotHeader)
+		&& memcmp(header->m_magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0
+		&& header->m_version == SNAPSHOT_VERSION
+		&& header->m_size == m_size
+		&& sizeof(SnapshotHeader) + sizeof(SnapshotSection) * static_cast<uint64_t>(header->m_sectionCount) <= m_size;
+	for (uint32_t s = 0; valid && s < header->m_sectionCount; s++) {
+		const SnapshotSection& section = reinterpret_cast<const SnapshotSection*>(header + 1)[s];
+		valid = section.m_offset % SNAPSHOT_ALIGNMENT == 0
+			&& section.m_offset <= m_size
+			&& section.m_elementSize != 0
+			&& section.m_count <= (m_size - section.m_offset) / section.m_elementSize;
+	}
+	if (!valid)
+		Close();
+	return valid;
+}
+
+const void* SnapshotReader::GetRaw(uint32_t id, uint32_t elementSize, size_t& count) const {
+	const SnapshotSection* section = Find(id);
+	if (section == nullptr || section->m_elementSize != elementSize) {
+		count = 0;
+		return nullptr;
+	}
+	count = static_cast<size_t>(section->m_count);
+	return m_data + section->m_offset;
+}
+
+bool SnapshotReader::Has(uint32_t id) const {
+	return Find(id) != nullptr;
+}
+
+void SnapshotReader::Close() {
+	if (m_data == nullptr)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(m_data);
+	CloseHandle(m_mapping);
+	CloseHandle(m_file);
+	m_mapping = nullptr;
+	m_file = nullptr;
+#else
+	munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+	m_data = nullptr;
+	m_size = 0;
+}
+
+const SnapshotSection* SnapshotReader::Find(uint32_t id) const {
+	if (m_data == nullptr)
+		return nullptr;
+	const SnapshotHeader* header = reinterpret_cast<const SnapshotHeader*>(m_data);
+	const SnapshotSection* table = reinterpret_cast<const SnapshotSection*>(header + 1);
+	for (uint32_t s = 0; s < header->m_sectionCount; s++) {
+		if (table[s].m_id == id)
+			return &table[s];
+	}
+	return nullptr;
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include "EntityIdTypeDef.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//Bumped whenever a section's layout changes; older files are rejected rather than misread
+#define SNAPSHOT_VERSION 3
+
+//Every section starts on this boundary, so arrays can be read in place from a mapped file
+#define SNAPSHOT_ALIGNMENT 64
+
+//Identifies a section of a snapshot
+//Readers skip sections they don't know, so front ends can add their own from SNAPSHOT_FRONT_END on
+enum SnapshotSectionId : uint32_t {
+	SNAPSHOT_ENTITY_SLOTS = 1,			//SnapshotEntitySlot per entity table slot
+	SNAPSHOT_TRANSFORM_ENTITIES,		//EntityId per transform, in dense order
+	SNAPSHOT_COLLISION_ENTITIES,		//EntityId per collider, in dense order
+	SNAPSHOT_COLLISION_BOXES,			//BoundingBox per collider, in dense order
+	SNAPSHOT_PLAYER,					//The player's EntityId
+	SNAPSHOT_COLLISION_BROADPHASE,		//The collision system's Broadphase, as a uint32_t
+	SNAPSHOT_TRANSFORM_STREAMS = 64,	//One float section per TransformStream, SNAPSHOT_TRANSFORM_STREAMS + stream
+	SNAPSHOT_FRONT_END = 1024
+};
+
+//An entity table slot; dead slots keep their generation so stale handles stay stale after a restore
+struct SnapshotEntitySlot {
+	uint32_t m_generation;
+	uint32_t m_alive;
+};
+
+//Returns whether every entity refers to a live slot, so a component section can be restored against the slots
+bool SnapshotEntitiesAlive(const EntityId* entities, size_t count, const SnapshotEntitySlot* slots, size_t slotCount);
+
+//Fixed header at the start of every snapshot file
+struct SnapshotHeader {
+	char m_magic[8];			//"SWAMPSNP"
+	uint32_t m_version;
+	uint32_t m_sectionCount;	//Entries in the section table that follows the header
+	uint64_t m_size;			//Size of the whole file, to catch truncation
+};
+
+//Section table entry
+struct SnapshotSection {
+	uint32_t m_id;
+	uint32_t m_elementSize;		//Checked on load, so a changed struct can't be read with the old layout
+	uint64_t m_offset;			//From the start of the file, a multiple of SNAPSHOT_ALIGNMENT
+	uint64_t m_count;
+};
+
+//Gathers arrays into sections and writes them out in one pass
+//Add doesn't copy, so its arrays must stay unchanged until Write returns
+class SnapshotWriter {
+public:
+	template <typename T>
+	void Add(uint32_t id, const T* data, size_t count) {
+		AddRaw(id, data, sizeof(T), count);
+	}
+
+	//Keeps a copy of an array built just for the snapshot
+	template <typename T>
+	void AddCopy(uint32_t id, const vector<T>& data) {
+		size_t bytes = sizeof(T) * data.size();
+		m_copies.emplace_back(new uint8_t[bytes > 0 ? bytes : 1]);
+		if (bytes > 0)
+			memcpy(m_copies.back().get(), data.data(), bytes);
+		AddRaw(id, m_copies.back().get(), sizeof(T), data.size());
+	}
+
+	void AddRaw(uint32_t id, const void* data, uint32_t elementSize, size_t count);
+
+	//Writes the header, the section table and every section
+	//Returns false if the file can't be written
+	bool Write(const string& path);
+private:
+	struct PendingSection {
+		SnapshotSection m_section;
+		const void* m_data;
+	};
+	vector<PendingSection> m_sections;
+	vector<unique_ptr<uint8_t[]>> m_copies;
+};
+
+//Maps a snapshot file into memory and hands out its sections in place
+//Sections stay valid until the reader is destroyed
+class SnapshotReader {
+public:
+	SnapshotReader();
+	~SnapshotReader();
+
+	//Maps the file and checks its header and section table
+	//Returns false if it can't be mapped or isn't a snapshot of this version
+	bool Open(const string& path);
+
+	//Returns a section's elements and sets count, or returns nullptr if the section is missing or its elements aren't Ts
+	template <typename T>
+	const T* Get(uint32_t id, size_t& count) const {
+		return static_cast<const T*>(GetRaw(id, sizeof(T), count));
+	}
+
+	const void* GetRaw(uint32_t id, uint32_t elementSize, size_t& count) const;
+
+	//Returns whether the file has the section
+	bool Has(uint32_t id) const;
+private:
+	SnapshotReader(const SnapshotReader&) = delete;
+	SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+	void Close();
+
+	const SnapshotSection* Find(uint32_t id) const;
+
+	const uint8_t* m_data = nullptr;
+	size_t m_size = 0;
+#ifdef _WIN32
+	void* m_file = nullptr;
+	void* m_mapping = nullptr;
+#endif
+};
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+
+//A non-owning view of contiguous elements
+template <typename T>
+struct Span {
+	T* m_data;
+	size_t m_size;
+
+	Span() : m_data(nullptr), m_size(0) {}
+	Span(T* data, size_t size) : m_data(data), m_size(size) {}
+
+	T& operator[](const size_t index) const {
+		return m_data[index];
+	}
+	T* begin() const {
+		return m_data;
+	}
+	T* end() const {
+		return m_data + m_size;
+	}
+	T* data() const {
+		return m_data;
+	}
+	size_t size() const {
+		return m_size;
+	}
+	bool empty() const {
+		return m_size == 0;
+	}
+};
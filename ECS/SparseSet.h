@@ -0,0 +1,256 @@
+#pragma once
+#include "EntityIdTypeDef.h"
+#include "Compaction.h"
+#include <algorithm>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+using namespace std;
+
+#define SPARSE_PAGE_BITS 12
+#define SPARSE_PAGE_SIZE (1 << SPARSE_PAGE_BITS)
+#define INVALID_DENSE_INDEX 0xffffffff
+
+//Maps entity indices to dense indices through lazily allocated pages
+//Owners keep their component arrays in the same dense order, so every live element is contiguous
+class SparseIndex {
+public:
+	//Adds the entity at the end of the dense order and returns its dense index
+	//Returns the existing dense index if the entity, or a stale generation of its index, is already present,
+	//so owners overwrite the element there instead of leaving an entry behind that can no longer be found
+	unsigned int Insert(EntityId entityId) {
+		uint32_t& slot = GetSlot(entityId.m_index);
+		if (slot != INVALID_DENSE_INDEX) {
+			m_entities[slot] = entityId;
+			return slot;
+		}
+		m_pageCounts[entityId.m_index >> SPARSE_PAGE_BITS]++;
+		slot = static_cast<uint32_t>(m_entities.size());
+		m_entities.push_back(entityId);
+		return slot;
+	}
+
+	//Removes the entity by moving the last entity into its dense slot
+	//Returns the vacated dense index, which owners must fill with their last element, or INVALID_DENSE_INDEX if absent
+	unsigned int Erase(EntityId entityId) {
+		unsigned int index = Find(entityId);
+		if (index == INVALID_DENSE_INDEX)
+			return INVALID_DENSE_INDEX;
+		EntityId last = m_entities.back();
+		m_entities[index] = last;
+		GetSlot(last.m_index) = index;
+		GetSlot(entityId.m_index) = INVALID_DENSE_INDEX;
+		m_pageCounts[entityId.m_index >> SPARSE_PAGE_BITS]--;
+		m_entities.pop_back();
+		return index;
+	}
+
+	//Returns the dense index of the entity, or INVALID_DENSE_INDEX if absent or stale
+	unsigned int Find(EntityId entityId) const {
+		uint32_t page = entityId.m_index >> SPARSE_PAGE_BITS;
+		if (page >= m_pages.size() || !m_pages[page])
+			return INVALID_DENSE_INDEX;
+		uint32_t index = m_pages[page][entityId.m_index & (SPARSE_PAGE_SIZE - 1)];
+		if (index == INVALID_DENSE_INDEX || m_entities[index] != entityId)
+			return INVALID_DENSE_INDEX;
+		return index;
+	}
+
+	//Returns the dense index of an entity known to be present
+	unsigned int Get(EntityId entityId) const {
+		return m_pages[entityId.m_index >> SPARSE_PAGE_BITS][entityId.m_index & (SPARSE_PAGE_SIZE - 1)];
+	}
+
+	//Returns the entity stored at the given dense index
+	EntityId GetEntity(unsigned int index) const {
+		return m_entities[index];
+	}
+
+	//Returns the dense entity array
+	const vector<EntityId>& GetEntities() const {
+		return m_entities;
+	}
+
+	void Reserve(size_t capacity) {
+		m_entities.reserve(capacity);
+	}
+
+	//Replaces the contents with the given entities, keeping their order as the dense order
+	void Assign(const EntityId* entities, size_t count) {
+		m_pages.clear();
+		m_pageCounts.clear();
+		m_compactPage = 0;
+		m_entities.assign(entities, entities + count);
+		for (size_t c = 0; c < count; c++) {
+			GetSlot(entities[c].m_index) = static_cast<uint32_t>(c);
+			m_pageCounts[entities[c].m_index >> SPARSE_PAGE_BITS]++;
+		}
+	}
+
+	//Makes room for count more entities, at least doubling the capacity when it grows
+	void ReserveAdditional(size_t count) {
+		size_t needed = m_entities.size() + count;
+		if (needed > m_entities.capacity())
+			m_entities.reserve(max(needed, m_entities.capacity() * 2));
+	}
+
+	//Frees pages that no longer map any entity, then releases the dense array's spare memory once it has stayed mostly empty
+	//Returns true when the pass finished within the budget
+	bool Compact(CompactionBudget& budget) {
+		for (; m_compactPage < m_pages.size(); m_compactPage++) {
+			if (m_pages[m_compactPage] && m_pageCounts[m_compactPage] == 0)
+				m_pages[m_compactPage].reset();
+			if (budget.Expired())
+				return false;
+		}
+		m_compactPage = 0;
+		while (!m_pages.empty() && !m_pages.back()) {
+			m_pages.pop_back();
+			m_pageCounts.pop_back();
+		}
+		if (m_occupancyTracker.ShouldShrink(m_entities.size(), m_entities.capacity()))
+		{
+			ShrinkToFit(m_entities);
+			ShrinkToFit(m_pages);
+			ShrinkToFit(m_pageCounts);
+		}
+		return true;
+	}
+
+	size_t size() const {
+		return m_entities.size();
+	}
+private:
+	//Returns the sparse slot for an entity index, allocating its page if needed
+	uint32_t& GetSlot(uint32_t entityIndex) {
+		uint32_t page = entityIndex >> SPARSE_PAGE_BITS;
+		if (page >= m_pages.size())
+		{
+			m_pages.resize(page + 1);
+			m_pageCounts.resize(page + 1);
+		}
+		if (!m_pages[page])
+		{
+			m_pages[page].reset(new uint32_t[SPARSE_PAGE_SIZE]);
+			for (unsigned int c = 0; c < SPARSE_PAGE_SIZE; c++)
+				m_pages[page][c] = INVALID_DENSE_INDEX;
+		}
+		return m_pages[page][entityIndex & (SPARSE_PAGE_SIZE - 1)];
+	}
+
+	//Sparse pages of dense indices, indexed by entity index
+	vector<unique_ptr<uint32_t[]>> m_pages;
+
+	//Number of entities mapped by each page, so empty ones can be freed
+	vector<uint32_t> m_pageCounts;
+
+	//Next page Compact checks
+	size_t m_compactPage = 0;
+
+	OccupancyTracker m_occupancyTracker;
+
+	//Entities in dense order
+	vector<EntityId> m_entities;
+};
+
+//A sparse set of components keyed by entity
+//Lookups are two array reads, removal is swap-and-pop, and iteration only touches live components
+template <typename T>
+class SparseSet {
+public:
+	//Adds or overwrites the entity's component and returns its dense index
+	unsigned int Insert(EntityId entityId, const T& item) {
+		unsigned int index = m_index.Insert(entityId);
+		if (index == m_dense.size())
+			m_dense.push_back(item);
+		else
+			m_dense[index] = item;
+		return index;
+	}
+
+	//Removes the entity's component, moving the last component into the vacated slot
+	bool Erase(EntityId entityId) {
+		unsigned int index = m_index.Erase(entityId);
+		if (index == INVALID_DENSE_INDEX)
+			return false;
+		if (index != m_dense.size() - 1)
+			m_dense[index] = m_dense.back();
+		m_dense.pop_back();
+		return true;
+	}
+
+	//Returns the component of an entity known to be present
+	T& Get(EntityId entityId) {
+		return m_dense[m_index.Get(entityId)];
+	}
+
+	//Returns a pointer to the entity's component, or nullptr if absent or stale
+	T* TryGet(EntityId entityId) {
+		unsigned int index = m_index.Find(entityId);
+		return (index == INVALID_DENSE_INDEX) ? nullptr : &m_dense[index];
+	}
+
+	bool Contains(EntityId entityId) const {
+		return m_index.Find(entityId) != INVALID_DENSE_INDEX;
+	}
+
+	//Returns the entity stored at the given dense index
+	EntityId GetEntity(unsigned int index) const {
+		return m_index.GetEntity(index);
+	}
+
+	//Returns the dense component array
+	vector<T>& GetDense() {
+		return m_dense;
+	}
+
+	//Returns the dense entity array, in the same order as the components
+	const vector<EntityId>& GetEntities() const {
+		return m_index.GetEntities();
+	}
+
+	//Replaces the contents with the given entities and their components, in dense order
+	void Assign(const EntityId* entities, const T* components, size_t count) {
+		m_index.Assign(entities, count);
+		m_dense.assign(components, components + count);
+	}
+
+	void Reserve(size_t capacity) {
+		m_index.Reserve(capacity);
+		m_dense.reserve(capacity);
+	}
+
+	//Makes room for count more components, at least doubling the capacity when it grows
+	void ReserveAdditional(size_t count) {
+		m_index.ReserveAdditional(count);
+		size_t needed = m_dense.size() + count;
+		if (needed > m_dense.capacity())
+			m_dense.reserve(max(needed, m_dense.capacity() * 2));
+	}
+
+	size_t size() const {
+		return m_dense.size();
+	}
+
+	T& operator[](const unsigned int index) {
+		return m_dense[index];
+	}
+
+	//Frees empty index pages, then releases spare component memory once it has stayed mostly empty
+	//Returns true when the pass finished within the budget
+	bool Compact(CompactionBudget& budget) {
+		if (!m_index.Compact(budget))
+			return false;
+		if (m_occupancyTracker.ShouldShrink(m_dense.size(), m_dense.capacity()))
+			ShrinkToFit(m_dense);
+		return true;
+	}
+private:
+	SparseIndex m_index;
+
+	OccupancyTracker m_occupancyTracker;
+
+	//Components in dense order
+	vector<T> m_dense;
+};
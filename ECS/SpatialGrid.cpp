@@ -0,0 +1,82 @@
+#include "SpatialGrid.h"
+#include "JobSystem.h"
+#include "Compaction.h"
+
+using namespace DirectX;
+
+void SpatialGrid::Build(const vector<CollapsedComponent<TypedMaxMin>>& aabbs, XMFLOAT3 origin, XMFLOAT3 cellSize, unsigned int divisions) {
+	m_origin = origin;
+	m_cellSize = cellSize;
+	m_divisions = divisions;
+	m_cellCount = static_cast<size_t>(divisions) * divisions * divisions;
+	size_t bucketCount = m_cellCount * CollisionType::NUMTYPES;
+
+	//the cursors only grow, since atomics can't be moved into a bigger vector
+	if (m_cursorCapacity < bucketCount) {
+		m_cursors.reset(new atomic<uint32_t>[bucketCount]);
+		m_cursorCapacity = bucketCount;
+	}
+	for (size_t b = 0; b < bucketCount; b++)
+		m_cursors[b].store(0, memory_order_relaxed);
+
+	//count
+	JobSystem::GetDefault().ParallelForRange(0, aabbs.size(), GRID_GRAIN_SIZE, [&](size_t begin, size_t end) {
+		unsigned int cells[8];
+		for (size_t c = begin; c < end; c++) {
+			unsigned int cellCount = GetCells(aabbs[c].m_component, cells);
+			for (unsigned int n = 0; n < cellCount; n++)
+				m_cursors[cells[n] * CollisionType::NUMTYPES + aabbs[c].m_component.m_collisionType].fetch_add(1, memory_order_relaxed);
+		}
+	}, "Grid count range");
+
+	//prefix sum, leaving each cursor at the start of its bucket
+	m_offsets.resize(bucketCount + 1);
+	uint32_t total = 0;
+	for (size_t b = 0; b < bucketCount; b++) {
+		m_offsets[b] = total;
+		total += m_cursors[b].load(memory_order_relaxed);
+		m_cursors[b].store(m_offsets[b], memory_order_relaxed);
+	}
+	m_offsets[bucketCount] = total;
+	m_entries.resize(total);
+
+	//scatter
+	JobSystem::GetDefault().ParallelForRange(0, aabbs.size(), GRID_GRAIN_SIZE, [&](size_t begin, size_t end) {
+		unsigned int cells[8];
+		for (size_t c = begin; c < end; c++) {
+			const CollapsedComponent<TypedMaxMin>& caabb = aabbs[c];
+			unsigned int cellCount = GetCells(caabb.m_component, cells);
+			for (unsigned int n = 0; n < cellCount; n++) {
+				uint32_t entry = m_cursors[cells[n] * CollisionType::NUMTYPES + caabb.m_component.m_collisionType].fetch_add(1, memory_order_relaxed);
+				m_entries[entry] = { caabb.m_component, caabb.m_entityId, caabb.m_handle };
+			}
+		}
+	}, "Grid scatter range");
+}
+
+void SpatialGrid::ShrinkToFit() {
+	//the old blocks are freed on a worker, like the rest of compaction's
+	::ShrinkToFit(m_offsets);
+	::ShrinkToFit(m_entries);
+	size_t bucketCount = m_cellCount * CollisionType::NUMTYPES;
+	if (m_cursorCapacity > bucketCount) {
+		m_cursors.reset(bucketCount ? new atomic<uint32_t>[bucketCount] : nullptr);
+		m_cursorCapacity = bucketCount;
+	}
+}
+
+unsigned int SpatialGrid::GetCells(const MaxMin& aabb, unsigned int cells[8]) const {
+	//the corners only take two values on each axis, so find the two cells they fall in per axis and combine them
+	unsigned int x[2] = { GetCell(aabb.m_min.x, m_origin.x, m_cellSize.x), GetCell(aabb.m_max.x, m_origin.x, m_cellSize.x) };
+	unsigned int y[2] = { GetCell(aabb.m_min.y, m_origin.y, m_cellSize.y), GetCell(aabb.m_max.y, m_origin.y, m_cellSize.y) };
+	unsigned int z[2] = { GetCell(aabb.m_min.z, m_origin.z, m_cellSize.z), GetCell(aabb.m_max.z, m_origin.z, m_cellSize.z) };
+	unsigned int xCount = (x[0] == x[1]) ? 1 : 2;
+	unsigned int yCount = (y[0] == y[1]) ? 1 : 2;
+	unsigned int zCount = (z[0] == z[1]) ? 1 : 2;
+	unsigned int count = 0;
+	for (unsigned int k = 0; k < zCount; k++)
+		for (unsigned int j = 0; j < yCount; j++)
+			for (unsigned int i = 0; i < xCount; i++)
+				cells[count++] = (z[k] * m_divisions + y[j]) * m_divisions + x[i];
+	return count;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "CollapsedComponent.h"
+#include "CollisionComponent.h"
+#include "Span.h"
+#include <DirectXMath.h>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+//AABBs built into the grid by one job in each pass
+#define GRID_GRAIN_SIZE 512
+
+//A uniform grid of AABBs, bucketed by cell and collision type
+//Each AABB goes in the distinct cells holding its corners. Building takes two passes with no locks: the first counts every bucket's AABBs,
+//the counts are prefix summed into each bucket's offset, and the second scatters the AABBs into one flat array
+class SpatialGrid {
+public:
+	//Buckets the AABBs into a cube of divisions cells a side, starting at origin
+	//Every AABB must lie inside the cube
+	void Build(const vector<CollapsedComponent<TypedMaxMin>>& aabbs, DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 cellSize, unsigned int divisions);
+
+	size_t GetCellCount() const {
+		return m_cellCount;
+	}
+
+	//Gets the AABBs of a collision type in a cell, contiguous in memory
+	Span<const CollapsedComponent<MaxMin>> Get(size_t cell, CollisionType type) const {
+		size_t bucket = cell * CollisionType::NUMTYPES + type;
+		return Span<const CollapsedComponent<MaxMin>>(m_entries.data() + m_offsets[bucket], m_offsets[bucket + 1] - m_offsets[bucket]);
+	}
+
+	//Frees whatever the last build didn't use
+	void ShrinkToFit();
+private:
+	//Writes the distinct cells holding the AABB's corners and returns how many there are
+	unsigned int GetCells(const MaxMin& aabb, unsigned int cells[8]) const;
+
+	//Gets the cell a coordinate falls in along one axis
+	static unsigned int GetCell(float coordinate, float origin, float cellSize) {
+		return static_cast<unsigned int>(floorf((coordinate - origin) / cellSize));
+	}
+
+	vector<uint32_t> m_offsets;							//First entry of each bucket, then one past the last
+	unique_ptr<atomic<uint32_t>[]> m_cursors;			//Each bucket's count in the first pass and its next free entry in the second
+	size_t m_cursorCapacity = 0;
+	vector<CollapsedComponent<MaxMin>> m_entries;
+	DirectX::XMFLOAT3 m_origin;
+	DirectX::XMFLOAT3 m_cellSize;
+	unsigned int m_divisions = 0;
+	size_t m_cellCount = 0;
+};
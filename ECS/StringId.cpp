@@ -0,0 +1,52 @@
+#include "StringId.h"
+#include <cstdio>
+
+#ifdef _DEBUG
+#include <mutex>
+#include <unordered_map>
+
+//Every name hashed, by hash
+static std::unordered_map<uint64_t, std::string>& GetNames() {
+	static std::unordered_map<uint64_t, std::string> names;
+	return names;
+}
+
+static std::mutex& GetNamesMutex() {
+	static std::mutex namesMutex;
+	return namesMutex;
+}
+#endif
+
+StringId::StringId(const std::string& name) : m_hash(Hash(name.data(), name.size())) {
+#ifdef _DEBUG
+	Register(name.data(), name.size());
+#endif
+}
+
+#ifdef _DEBUG
+void StringId::Register(const char* name, size_t length) const {
+	size_t used = 0;
+	while (used < length && name[used] != '\0')
+		used++;
+	std::lock_guard<std::mutex> lock(GetNamesMutex());
+	auto found = GetNames().find(m_hash);
+	if (found == GetNames().end())
+		GetNames().emplace(m_hash, std::string(name, used));
+	else if (found->second.compare(0, std::string::npos, name, used) != 0)
+		printf("StringId collision between %s and %.*s\n", found->second.c_str(), static_cast<int>(used), name);
+}
+#endif
+
+std::string StringId::GetName() const {
+#ifdef _DEBUG
+	{
+		std::lock_guard<std::mutex> lock(GetNamesMutex());
+		auto found = GetNames().find(m_hash);
+		if (found != GetNames().end())
+			return found->second;
+	}
+#endif
+	char hex[19];
+	snprintf(hex, sizeof(hex), "0x%016llx", static_cast<unsigned long long>(m_hash));
+	return hex;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+//A name hashed with 64-bit FNV-1a
+//Literals hash at compile time, and IDs compare and hash as integers, so name-keyed lookups don't allocate
+//Debug builds remember every name hashed, so GetName can turn an ID back into its name
+class StringId {
+public:
+	constexpr StringId() : m_hash(0) {}
+
+#ifdef _DEBUG
+	//Hashes a literal and remembers its name, so debug builds can't hash literals in constant expressions
+	template <size_t N>
+	StringId(const char(&name)[N]) : m_hash(Hash(name, N - 1)) {
+		Register(name, N - 1);
+	}
+#else
+	//Hashes a literal; in a constant expression, such as a constexpr StringId, nothing is left to do at run time
+	template <size_t N>
+	constexpr StringId(const char(&name)[N]) : m_hash(Hash(name, N - 1)) {}
+#endif
+
+	//Hashes a name built at run time, such as an asset's file name
+	explicit StringId(const std::string& name);
+
+	//Rebuilds an ID from a hash saved with GetHash
+	static constexpr StringId FromHash(uint64_t hash) {
+		return StringId(hash, 0);
+	}
+
+	constexpr uint64_t GetHash() const {
+		return m_hash;
+	}
+
+	constexpr bool operator==(const StringId& other) const {
+		return m_hash == other.m_hash;
+	}
+	constexpr bool operator!=(const StringId& other) const {
+		return m_hash != other.m_hash;
+	}
+
+	//Gets the name an ID was hashed from in debug builds, or the hash in hex otherwise
+	std::string GetName() const;
+
+	//Hashes up to length characters, stopping early at a null
+	static constexpr uint64_t Hash(const char* name, size_t length) {
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t c = 0; c < length && name[c] != '\0'; c++)
+			hash = (hash ^ static_cast<uint8_t>(name[c])) * 1099511628211ull;
+		return hash;
+	}
+private:
+	constexpr StringId(uint64_t hash, int) : m_hash(hash) {}
+
+#ifdef _DEBUG
+	//Remembers the name this ID was hashed from, up to length characters or a null
+	void Register(const char* name, size_t length) const;
+#endif
+
+	uint64_t m_hash;
+};
+
+//Test vectors from the FNV reference implementation
+static_assert(StringId::Hash("", 0) == 0xcbf29ce484222325ull, "StringId must hash with 64-bit FNV-1a");
+static_assert(StringId::Hash("a", 1) == 0xaf63dc4c8601ec8cull, "StringId must hash with 64-bit FNV-1a");
+static_assert(StringId::Hash("foobar", 6) == 0x85944171f73967e8ull, "StringId must hash with 64-bit FNV-1a");
+
+namespace std {
+	template <>
+	struct hash<StringId> {
+		size_t operator()(const StringId& id) const {
+			//already well mixed, so it's used as is
+			return static_cast<size_t>(id.GetHash());
+		}
+	};
+}
@@ -0,0 +1,261 @@
+#include "SweepAndPrune.h"
+#include <algorithm>
+
+void SweepAndPrune::SetPairFilter(CollisionType type1, CollisionType type2, bool wanted) {
+	m_pairFilter[type1][type2] = wanted;
+	m_pairFilter[type2][type1] = wanted;
+}
+
+void SweepAndPrune::Update(const vector<CollapsedComponent<TypedMaxMin>>& aabbs) {
+	m_tick++;
+	m_added.clear();
+	m_startedPairs.clear();
+	if (m_live.empty())
+		ChooseAxes(aabbs);
+
+	//move the boxes that are still here and set the new ones aside until the arrays are sorted
+	for (const CollapsedComponent<TypedMaxMin>& caabb : aabbs) {
+		uint32_t slot = caabb.m_entityId.m_index;
+		if (slot >= m_boxes.size())
+			m_boxes.resize(slot + 1);
+		Box& box = m_boxes[slot];
+		//a slot taken over by another entity this tick is a removal and an addition
+		if (!box.m_alive || box.m_entityId != caabb.m_entityId) {
+			m_added.push_back(slot);
+			continue;
+		}
+		box.m_seenTick = m_tick;
+		//boxes at rest don't touch the endpoint arrays, which they'd mostly miss the cache on
+		const TypedMaxMin& aabb = caabb.m_component;
+		if (box.m_min[0] == aabb.m_min.x && box.m_min[1] == aabb.m_min.y && box.m_min[2] == aabb.m_min.z
+			&& box.m_max[0] == aabb.m_max.x && box.m_max[1] == aabb.m_max.y && box.m_max[2] == aabb.m_max.z)
+			continue;
+		box.m_min[0] = aabb.m_min.x;
+		box.m_min[1] = aabb.m_min.y;
+		box.m_min[2] = aabb.m_min.z;
+		box.m_max[0] = aabb.m_max.x;
+		box.m_max[1] = aabb.m_max.y;
+		box.m_max[2] = aabb.m_max.z;
+		for (unsigned int sorted = 0; sorted < m_sortedCount; sorted++) {
+			m_endpoints[sorted][box.m_minEndpoint[sorted]].m_value = box.m_min[m_axes[sorted]];
+			m_endpoints[sorted][box.m_maxEndpoint[sorted]].m_value = box.m_max[m_axes[sorted]];
+		}
+	}
+
+	//remove the boxes that weren't passed in, and their pairs, before any new box can take their slots
+	bool removedAny = false;
+	size_t live = 0;
+	for (uint32_t slot : m_live) {
+		if (m_boxes[slot].m_seenTick == m_tick)
+			m_live[live++] = slot;
+		else {
+			m_boxes[slot].m_alive = false;
+			removedAny = true;
+		}
+	}
+	m_live.resize(live);
+	if (removedAny) {
+		m_pairs.erase(remove_if(m_pairs.begin(), m_pairs.end(), [this](uint64_t key) {
+			return !m_boxes[static_cast<uint32_t>(key >> 32)].m_alive || !m_boxes[static_cast<uint32_t>(key)].m_alive;
+		}), m_pairs.end());
+		for (unsigned int sorted = 0; sorted < m_sortedCount; sorted++)
+			RemoveEndpoints(sorted);
+	}
+
+	for (unsigned int sorted = 0; sorted < m_sortedCount; sorted++)
+		SortAxis(sorted);
+
+	//the new boxes are merged in already sorted, and swept for the pairs they start in
+	if (!m_added.empty()) {
+		for (const CollapsedComponent<TypedMaxMin>& caabb : aabbs) {
+			uint32_t slot = caabb.m_entityId.m_index;
+			Box& box = m_boxes[slot];
+			if (box.m_alive)
+				continue;
+			box.m_min[0] = caabb.m_component.m_min.x;
+			box.m_min[1] = caabb.m_component.m_min.y;
+			box.m_min[2] = caabb.m_component.m_min.z;
+			box.m_max[0] = caabb.m_component.m_max.x;
+			box.m_max[1] = caabb.m_component.m_max.y;
+			box.m_max[2] = caabb.m_component.m_max.z;
+			box.m_entityId = caabb.m_entityId;
+			box.m_collisionType = caabb.m_component.m_collisionType;
+			box.m_seenTick = m_tick;
+			box.m_alive = true;
+			box.m_added = true;
+			m_live.push_back(slot);
+		}
+		for (unsigned int sorted = 0; sorted < m_sortedCount; sorted++)
+			AddEndpoints(sorted);
+		FindAddedPairs();
+		for (uint32_t slot : m_added)
+			m_boxes[slot].m_added = false;
+	}
+
+	//pairs that separated on a sorted axis are dropped by checking them again, which costs less than tracking the swaps that separate them
+	m_pairs.erase(remove_if(m_pairs.begin(), m_pairs.end(), [this](uint64_t key) {
+		return !OverlapsSorted(static_cast<uint32_t>(key >> 32), static_cast<uint32_t>(key));
+	}), m_pairs.end());
+	if (!m_startedPairs.empty()) {
+		sort(m_startedPairs.begin(), m_startedPairs.end());
+		m_scratchPairs.clear();
+		set_union(m_pairs.begin(), m_pairs.end(), m_startedPairs.begin(), m_startedPairs.end(), back_inserter(m_scratchPairs));
+		m_pairs.swap(m_scratchPairs);
+		//a pair can start on more than one axis
+		m_pairs.erase(unique(m_pairs.begin(), m_pairs.end()), m_pairs.end());
+	}
+
+	if (m_sortedCount == 3)
+		m_overlaps.assign(m_pairs.begin(), m_pairs.end());
+	else {
+		m_overlaps.clear();
+		for (uint64_t key : m_pairs)
+			if (Overlaps(static_cast<uint32_t>(key >> 32), static_cast<uint32_t>(key), m_axes[2]))
+				m_overlaps.push_back(key);
+	}
+}
+
+void SweepAndPrune::Clear() {
+	for (uint32_t slot : m_live)
+		m_boxes[slot].m_alive = false;
+	m_live.clear();
+	for (unsigned int sorted = 0; sorted < 3; sorted++)
+		m_endpoints[sorted].clear();
+	m_pairs.clear();
+	m_overlaps.clear();
+}
+
+void SweepAndPrune::ShrinkToFit() {
+	m_boxes.shrink_to_fit();
+	m_live.shrink_to_fit();
+	vector<uint32_t>().swap(m_added);
+	for (unsigned int sorted = 0; sorted < 3; sorted++)
+		m_endpoints[sorted].shrink_to_fit();
+	vector<Endpoint>().swap(m_merged);
+	vector<uint32_t>().swap(m_active);
+	vector<uint32_t>().swap(m_activeAdded);
+	m_pairs.shrink_to_fit();
+	m_overlaps.shrink_to_fit();
+	vector<uint64_t>().swap(m_startedPairs);
+	vector<uint64_t>().swap(m_scratchPairs);
+}
+
+void SweepAndPrune::ChooseAxes(const vector<CollapsedComponent<TypedMaxMin>>& aabbs) {
+	if (aabbs.empty())
+		return;
+	//an axis is as crowded as the number of pairs overlapping along it, which a sweep over its sorted endpoints counts
+	//a few far off colliders would throw off anything based on the scene's extent
+	size_t crowding[3];
+	for (unsigned int axis = 0; axis < 3; axis++) {
+		m_merged.clear();
+		for (const CollapsedComponent<TypedMaxMin>& caabb : aabbs) {
+			const TypedMaxMin& aabb = caabb.m_component;
+			m_merged.push_back({ (axis == 0) ? aabb.m_min.x : (axis == 1) ? aabb.m_min.y : aabb.m_min.z, 0 });
+			m_merged.push_back({ (axis == 0) ? aabb.m_max.x : (axis == 1) ? aabb.m_max.y : aabb.m_max.z, 1 });
+		}
+		sort(m_merged.begin(), m_merged.end());
+		size_t open = 0;
+		crowding[axis] = 0;
+		for (const Endpoint& endpoint : m_merged) {
+			if (!endpoint.IsMax())
+				crowding[axis] += open++;
+			//a box with no width has its maximum first, which only makes the count a little off
+			else if (open > 0)
+				open--;
+		}
+	}
+	m_axes[0] = 0;
+	m_axes[1] = 1;
+	m_axes[2] = 2;
+	sort(m_axes, m_axes + 3, [&crowding](unsigned int a, unsigned int b) {
+		return crowding[a] < crowding[b];
+	});
+	m_sortedCount = (crowding[m_axes[2]] > SAP_CROWDED_AXIS_RATIO * crowding[m_axes[1]]) ? 2 : 3;
+}
+
+void SweepAndPrune::SortAxis(unsigned int sorted) {
+	vector<Endpoint>& endpoints = m_endpoints[sorted];
+	for (size_t e = 1; e < endpoints.size(); e++) {
+		//nearly every endpoint is already in place, so this is usually one comparison
+		for (size_t n = e; n > 0 && endpoints[n] < endpoints[n - 1]; n--) {
+			Endpoint& moving = endpoints[n];
+			Endpoint& passed = endpoints[n - 1];
+			//a minimum moving below a maximum starts an overlap on this axis
+			if (!moving.IsMax() && passed.IsMax()) {
+				uint32_t box1 = moving.GetBox();
+				uint32_t box2 = passed.GetBox();
+				if (box1 != box2 && IsWanted(box1, box2) && OverlapsSorted(box1, box2))
+					m_startedPairs.push_back(GetPairKey(box1, box2));
+			}
+			swap(moving, passed);
+			Box& movedDown = m_boxes[passed.GetBox()];
+			Box& movedUp = m_boxes[moving.GetBox()];
+			(passed.IsMax() ? movedDown.m_maxEndpoint : movedDown.m_minEndpoint)[sorted] = static_cast<uint32_t>(n - 1);
+			(moving.IsMax() ? movedUp.m_maxEndpoint : movedUp.m_minEndpoint)[sorted] = static_cast<uint32_t>(n);
+		}
+	}
+}
+
+void SweepAndPrune::RemoveEndpoints(unsigned int sorted) {
+	vector<Endpoint>& endpoints = m_endpoints[sorted];
+	endpoints.erase(remove_if(endpoints.begin(), endpoints.end(), [this](const Endpoint& e) {
+		return !m_boxes[e.GetBox()].m_alive;
+	}), endpoints.end());
+	for (size_t e = 0; e < endpoints.size(); e++) {
+		Box& box = m_boxes[endpoints[e].GetBox()];
+		(endpoints[e].IsMax() ? box.m_maxEndpoint : box.m_minEndpoint)[sorted] = static_cast<uint32_t>(e);
+	}
+}
+
+void SweepAndPrune::AddEndpoints(unsigned int sorted) {
+	vector<Endpoint>& endpoints = m_endpoints[sorted];
+	unsigned int axis = m_axes[sorted];
+	size_t oldCount = endpoints.size();
+	for (uint32_t slot : m_added) {
+		endpoints.push_back({ m_boxes[slot].m_min[axis], slot << 1 });
+		endpoints.push_back({ m_boxes[slot].m_max[axis], (slot << 1) | 1 });
+	}
+	sort(endpoints.begin() + oldCount, endpoints.end());
+	m_merged.resize(endpoints.size());
+	merge(endpoints.begin(), endpoints.begin() + oldCount, endpoints.begin() + oldCount, endpoints.end(), m_merged.begin());
+	endpoints.swap(m_merged);
+	for (size_t e = 0; e < endpoints.size(); e++) {
+		Box& box = m_boxes[endpoints[e].GetBox()];
+		(endpoints[e].IsMax() ? box.m_maxEndpoint : box.m_minEndpoint)[sorted] = static_cast<uint32_t>(e);
+	}
+}
+
+void SweepAndPrune::FindAddedPairs() {
+	//every box open at a minimum overlaps it on this axis, so only the other sorted axes need checking
+	//old boxes only need checking against new ones, since their pairs with each other are already known
+	m_active.clear();
+	m_activeAdded.clear();
+	const vector<Endpoint>& endpoints = m_endpoints[0];
+	for (uint32_t e = 0; e < endpoints.size(); e++) {
+		uint32_t slot = endpoints[e].GetBox();
+		Box& box = m_boxes[slot];
+		//a box with no width on this axis has its maximum first, and is never open
+		if (endpoints[e].IsMax()) {
+			if (box.m_minEndpoint[0] > e)
+				continue;
+			//swap the closed box out with the last open one
+			uint32_t last = m_active.back();
+			m_active[box.m_activeIndex] = last;
+			m_boxes[last].m_activeIndex = box.m_activeIndex;
+			m_active.pop_back();
+			if (box.m_added)
+				m_activeAdded.erase(find(m_activeAdded.begin(), m_activeAdded.end(), slot));
+			continue;
+		}
+		for (uint32_t open : (box.m_added ? m_active : m_activeAdded)) {
+			if (IsWanted(slot, open) && OverlapsSorted(slot, open))
+				m_startedPairs.push_back(GetPairKey(slot, open));
+		}
+		if (box.m_maxEndpoint[0] < e)
+			continue;
+		box.m_activeIndex = static_cast<uint32_t>(m_active.size());
+		m_active.push_back(slot);
+		if (box.m_added)
+			m_activeAdded.push_back(slot);
+	}
+}
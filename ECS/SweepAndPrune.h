@@ -0,0 +1,128 @@
+#pragma once
+#include "CollapsedComponent.h"
+#include "CollisionComponent.h"
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+//How many times more crowded than the others an axis has to be to go unsorted
+#define SAP_CROWDED_AXIS_RATIO 4
+
+//A broadphase that keeps every collider's AABB endpoints sorted along each axis between ticks
+//Colliders barely move from one tick to the next, so an insertion sort puts the endpoints back in order in close to one pass,
+//and each swap of a minimum past a maximum is a pair that may have started overlapping. The pairs overlapping on every sorted axis are
+//carried over from tick to tick, so only the swaps add to them
+//In a scene spread over a floor nearly every collider overlaps every other along the up axis, and colliders moving along it would swap
+//with most of the scene, so an axis far more crowded than the others is left unsorted and only checked on the pairs found on the other two
+//Finds the same pairs as the grid: AABBs that overlap, with the same strict comparisons
+class SweepAndPrune {
+public:
+	//Sets whether pairs of two collision types are wanted
+	void SetPairFilter(CollisionType type1, CollisionType type2, bool wanted);
+
+	//Moves, adds and removes boxes to match this tick's AABBs, then updates the overlapping pairs
+	//Colliders are identified by their entity's slot, so the AABBs can be in any order
+	void Update(const vector<CollapsedComponent<TypedMaxMin>>& aabbs);
+
+	//Calls f(entity1, type1, entity2, type2) for every overlapping pair, in the order of the entity slots
+	template <typename F>
+	void ForEachPair(const F& f) const {
+		for (uint64_t key : m_overlaps) {
+			const Box& box1 = m_boxes[static_cast<uint32_t>(key >> 32)];
+			const Box& box2 = m_boxes[static_cast<uint32_t>(key)];
+			f(box1.m_entityId, box1.m_collisionType, box2.m_entityId, box2.m_collisionType);
+		}
+	}
+
+	size_t GetPairCount() const {
+		return m_overlaps.size();
+	}
+
+	//Forgets every box and pair, so the next update starts over and picks its axes again
+	void Clear();
+
+	//Frees memory the last update didn't use
+	void ShrinkToFit();
+private:
+	//An AABB's minimum or maximum along one axis
+	struct Endpoint {
+		float m_value;
+		uint32_t m_data;								//Box slot shifted left once, with the low bit set for maximums
+
+		uint32_t GetBox() const {
+			return m_data >> 1;
+		}
+		bool IsMax() const {
+			return (m_data & 1) != 0;
+		}
+		//Maximums sort before minimums of the same value, so touching boxes don't overlap, like the strict comparisons
+		bool operator<(const Endpoint& other) const {
+			return m_value < other.m_value || (m_value == other.m_value && IsMax() && !other.IsMax());
+		}
+	};
+
+	//A collider, in the slot of its entity
+	struct Box {
+		float m_min[3];
+		float m_max[3];
+		uint32_t m_minEndpoint[3];						//Positions of its endpoints in each sorted axis' array
+		uint32_t m_maxEndpoint[3];
+		EntityId m_entityId;
+		CollisionType m_collisionType;
+		uint32_t m_seenTick;							//Last tick its AABB was passed in
+		uint32_t m_activeIndex;							//Position in m_active while FindAddedPairs has it open
+		bool m_alive;
+		bool m_added;									//Added this tick, so FindAddedPairs checks it against every box
+	};
+
+	static uint64_t GetPairKey(uint32_t box1, uint32_t box2) {
+		return (box1 < box2) ? (static_cast<uint64_t>(box1) << 32) | box2 : (static_cast<uint64_t>(box2) << 32) | box1;
+	}
+
+	bool IsWanted(uint32_t box1, uint32_t box2) const {
+		return m_pairFilter[m_boxes[box1].m_collisionType][m_boxes[box2].m_collisionType];
+	}
+
+	bool Overlaps(uint32_t box1, uint32_t box2, unsigned int axis) const {
+		return m_boxes[box1].m_max[axis] > m_boxes[box2].m_min[axis] && m_boxes[box1].m_min[axis] < m_boxes[box2].m_max[axis];
+	}
+
+	bool OverlapsSorted(uint32_t box1, uint32_t box2) const {
+		for (unsigned int sorted = 0; sorted < m_sortedCount; sorted++)
+			if (!Overlaps(box1, box2, m_axes[sorted]))
+				return false;
+		return true;
+	}
+
+	//Picks the axes to sort, leaving the one the AABBs crowd together on most unsorted if it's far more crowded than the others
+	void ChooseAxes(const vector<CollapsedComponent<TypedMaxMin>>& aabbs);
+
+	//Sorts a sorted axis' endpoints, recording the pairs that may have started overlapping
+	void SortAxis(unsigned int sorted);
+
+	//Drops the endpoints of removed boxes from a sorted axis
+	void RemoveEndpoints(unsigned int sorted);
+
+	//Merges the endpoints of added boxes into a sorted axis
+	void AddEndpoints(unsigned int sorted);
+
+	//Sweeps the first sorted axis to find the pairs with an added box
+	void FindAddedPairs();
+
+	vector<Box> m_boxes;
+	vector<uint32_t> m_live;							//Slots of the boxes in the arrays
+	vector<uint32_t> m_added;							//Slots of the boxes added this tick
+	unsigned int m_axes[3] = { 0, 1, 2 };				//The sorted axes, then the one that's only checked if there is one
+	unsigned int m_sortedCount = 3;
+	vector<Endpoint> m_endpoints[3];
+	vector<Endpoint> m_merged;							//Scratch space for AddEndpoints
+	vector<uint32_t> m_active;							//Scratch space for FindAddedPairs
+	vector<uint32_t> m_activeAdded;
+	vector<uint64_t> m_pairs;							//Pairs overlapping on every sorted axis, sorted
+	vector<uint64_t> m_overlaps;						//The ones also overlapping on the checked axis
+	vector<uint64_t> m_startedPairs;					//This tick's additions to m_pairs
+	vector<uint64_t> m_scratchPairs;
+	bool m_pairFilter[CollisionType::NUMTYPES][CollisionType::NUMTYPES] = {};
+	uint32_t m_tick = 0;
+};
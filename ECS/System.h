@@ -1,12 +1,10 @@
 #pragma once
 #include "SystemBase.h"
-#include "ComponentData.h"
-#include "CollapsedComponent.h"
-#include "FreeVector.h"
+#include "SparseSet.h"
+#include "EntityTable.h"
+#include "Snapshot.h"
 #include "EntityIdTypeDef.h"
 #include <vector>
-#include <map>
-#include <unordered_map>
 
 using namespace std;
 
@@ -14,75 +12,72 @@ using namespace std;
 template <typename T>
 class System : public SystemBase {
 public:
-	void virtual Update(Game * game, float dT) = 0;
+	void virtual Update(Simulation * sim, float dT) = 0;
 
-	//Creates a component of type T and adds it to m_components and m_handles
+	//Creates a component of type T for the entity and returns its dense index
 	unsigned int virtual Create(EntityId entityId, T tc) {
-		ComponentData comp = { true, entityId };
-		//FreeVector::add returns the index of the added element
-		unsigned int index = m_components.add(tc);
-		m_handles[entityId] = index;
-		if (index == m_componentData.size())
-			m_componentData.push_back(comp);
-		else
-			m_componentData[index] = comp;
-		return index;
+		return m_components.Insert(entityId, tc);
 	}
 
-	//Deactivates the component with the given ID, frees the space in m_components, and erases the handle
+	//Removes the entity's component, keeping m_components dense
 	void virtual Remove(EntityId entityId) {
-		unsigned int index = m_handles[entityId];
-		m_componentData[index].m_active = false;
-		m_components.free(index);
-		m_handles.erase(entityId);
+		m_components.Erase(entityId);
 	}
 
-	void Collapse() {
-		m_collapsedCount = 0;
-		m_collapsedComponents.resize(GetCount());
-		//m_collapsedEntityIds.resize(GetCount());
-		//m_collapsedHandles.resize(GetCount());
-		for (unsigned int c = 0; c < m_componentData.size(); c++)
-			if (m_componentData[c].m_active) {
-				m_collapsedComponents[m_collapsedCount] = { m_components[c], m_componentData[c].m_entityId, c };
-				//m_collapsedEntityIds[m_collapsedCount] = m_componentData[c].GetEntityId();
-				//m_collapsedHandles[m_collapsedCount] = c;
-				m_collapsedCount++;
-			}
+	void virtual ReserveAdditional(size_t count) {
+		m_components.ReserveAdditional(count);
+	}
+
+	bool virtual Compact(CompactionBudget& budget) {
+		return m_components.Compact(budget);
+	}
+
+	//Adds the dense entities and components to a snapshot as two sections
+	void SaveSnapshot(SnapshotWriter& writer, uint32_t entitySection, uint32_t componentSection) {
+		writer.Add(entitySection, m_components.GetEntities().data(), m_components.size());
+		writer.Add(componentSection, m_components.GetDense().data(), m_components.size());
+	}
+
+	//Returns whether a snapshot holds matching entity and component sections whose entities are alive in its slots
+	bool CanLoadSnapshot(const SnapshotReader& reader, uint32_t entitySection, uint32_t componentSection, const SnapshotEntitySlot* slots, size_t slotCount) {
+		size_t entityCount, componentCount;
+		const EntityId* entities = reader.Get<EntityId>(entitySection, entityCount);
+		const T* components = reader.Get<T>(componentSection, componentCount);
+		return entities != nullptr && components != nullptr && entityCount == componentCount
+			&& SnapshotEntitiesAlive(entities, entityCount, slots, slotCount);
+	}
+
+	//Replaces every component with a snapshot's and registers this system with their entities
+	//The entity table must already be restored from the same snapshot
+	void virtual LoadSnapshot(const SnapshotReader& reader, uint32_t entitySection, uint32_t componentSection, EntityTable& entityTable) {
+		size_t count;
+		const EntityId* entities = reader.Get<EntityId>(entitySection, count);
+		const T* components = reader.Get<T>(componentSection, count);
+		m_components.Assign(entities, components, count);
+		for (size_t c = 0; c < count; c++)
+			entityTable.AddSystem(entities[c], this);
 	}
 
 	//Returns a reference to the component with the given ID
 	T& GetComponent(EntityId entityId) {
-		return m_components[m_handles[entityId]];
+		return m_components.Get(entityId);
 	}
 
-	//Returns a pointer to the component list
-	FreeVector<T> * GetComponentList() {
-		return &m_components;
-	}	
+	//Returns a reference to the dense component list
+	vector<T> & GetComponentList() {
+		return m_components.GetDense();
+	}
 
 	//Gets the number of components
 	size_t GetCount() {
-		return m_components.count();
+		return m_components.size();
 	}
 
-	//Initializes m_components and m_handles
 	System() : SystemBase() {
-		//m_components = FreeVector<T>();
-		//m_collapsedComponents = vector<CollapsedComponent<T>>();
-		//m_collapsedEntityIds = vector<unsigned int>();
-		//m_collapsedHandles = vector<unsigned int>();
-		//m_handles = unordered_map<unsigned int, unsigned int>();
 	}
 	~System(){}
 protected:
-	//Holds components
-	FreeVector<T>  m_components;
-	vector<CollapsedComponent<T>> m_collapsedComponents;
-	//vector<unsigned int> m_collapsedEntityIds;
-	//vector<unsigned int> m_collapsedHandles;
-	unsigned int m_collapsedCount = 0;
-private:
-	//Holds entityId - index pairs
-	unordered_map<EntityId, unsigned int> m_handles;
-};
\ No newline at end of file
+	//Holds components in dense order, keyed by entity
+	//Always packed, so systems iterate it in place
+	SparseSet<T> m_components;
+};
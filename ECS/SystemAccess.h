@@ -0,0 +1,27 @@
+#pragma once
+#include "ComponentTypes.h"
+
+//Shared state that isn't a component, registered like one so jobs can declare access to it
+struct EntityTableResource {};
+
+//The simulation's random generator. Jobs that draw from it write this, which keeps them in order
+struct RandomResource {};
+
+//Jobs that record entity commands read this, since each thread records into its own buffer
+//Playback writes it, along with everything the commands can touch
+struct CommandBufferResource {};
+
+//The component types a job reads and writes
+struct SystemAccess {
+	ComponentMask m_reads;
+	ComponentMask m_writes;
+
+	//Two jobs conflict when either writes something the other touches
+	bool ConflictsWith(const SystemAccess& other) const {
+		return (m_writes & (other.m_reads | other.m_writes)) != 0 || (other.m_writes & m_reads) != 0;
+	}
+
+	SystemAccess operator|(const SystemAccess& other) const {
+		return { m_reads | other.m_reads, m_writes | other.m_writes };
+	}
+};
@@ -0,0 +1,89 @@
+#include "SystemScheduler.h"
+#include <algorithm>
+
+SystemScheduler::SystemScheduler() : m_remainingCapacity(0), m_mode(ScheduleMode::Parallel), m_criticalPathTime(0), m_wallTime(0), m_workTime(0)
+{
+}
+
+unsigned int SystemScheduler::AddJob(const char * name, SystemAccess access, function<void()> work)
+{
+	unsigned int index = static_cast<unsigned int>(m_jobs.size());
+	ArenaAllocator<unsigned int> arena;
+	m_jobs.push_back({ name, access, move(work), ArenaVector<unsigned int>(arena), ArenaVector<unsigned int>(arena), 0 });
+	for (unsigned int j = 0; j < index; j++) {
+		if (m_jobs[j].m_access.ConflictsWith(access))
+			AddDependency(index, j);
+	}
+	return index;
+}
+
+void SystemScheduler::AddDependency(unsigned int job, unsigned int dependsOn)
+{
+	ArenaVector<unsigned int>& dependencies = m_jobs[job].m_dependencies;
+	if (find(dependencies.begin(), dependencies.end(), dependsOn) != dependencies.end())
+		return;
+	dependencies.push_back(dependsOn);
+	m_jobs[dependsOn].m_dependents.push_back(job);
+}
+
+void SystemScheduler::Run()
+{
+	size_t count = m_jobs.size();
+	auto start = chrono::steady_clock::now();
+
+	if (m_mode == ScheduleMode::Serial) {
+		for (unsigned int j = 0; j < count; j++)
+			Execute(j);
+	}
+	else {
+		if (m_remainingCapacity < count) {
+			m_remaining.reset(new atomic<unsigned int>[count]);
+			m_remainingCapacity = count;
+		}
+		for (unsigned int j = 0; j < count; j++)
+			m_remaining[j] = static_cast<unsigned int>(m_jobs[j].m_dependencies.size());
+
+		JobGroup group;
+		for (unsigned int j = 0; j < count; j++) {
+			if (m_jobs[j].m_dependencies.empty())
+				Launch(j, &group);
+		}
+		JobSystem::GetDefault().Wait(group);
+	}
+
+	m_wallTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+	//dependencies always point at earlier jobs, so one pass in order finds the longest chain
+	Span<double> pathTimes = FrameArena::GetThreadArena().Allocate<double>(count);
+	m_criticalPathTime = 0;
+	m_workTime = 0;
+	for (unsigned int j = 0; j < count; j++) {
+		double longest = 0;
+		for (unsigned int d : m_jobs[j].m_dependencies)
+			longest = max(longest, pathTimes[d]);
+		pathTimes[j] = longest + m_jobs[j].m_duration;
+		m_criticalPathTime = max(m_criticalPathTime, pathTimes[j]);
+		m_workTime += m_jobs[j].m_duration;
+	}
+
+	m_jobs.clear();
+}
+
+void SystemScheduler::Execute(unsigned int job)
+{
+	auto start = chrono::steady_clock::now();
+	PROFILE_ZONE(m_jobs[job].m_name);
+	m_jobs[job].m_work();
+	m_jobs[job].m_duration = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+void SystemScheduler::Launch(unsigned int job, JobGroup * group)
+{
+	JobSystem::GetDefault().Run([this, job, group]() {
+		Execute(job);
+		for (unsigned int d : m_jobs[job].m_dependents) {
+			if (--m_remaining[d] == 0)
+				Launch(d, group);
+		}
+	}, group);
+}
\ No newline at end of file
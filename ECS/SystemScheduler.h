@@ -0,0 +1,74 @@
+#pragma once
+#include "SystemAccess.h"
+#include "JobSystem.h"
+#include "FrameArena.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+enum class ScheduleMode {
+	Parallel,			//Runs jobs as soon as the jobs they conflict with have finished
+	Serial				//Runs jobs one at a time in the order they were added, for debugging
+};
+
+//Runs a frame's systems as a job graph on the default JobSystem
+//A job depends on every earlier job it conflicts with, so the result matches running them in order
+//The graph lives in the frame arena, so jobs must be added and run between two FrameArena::ResetAll calls
+class SystemScheduler {
+public:
+	SystemScheduler();
+
+	//Adds a job and returns its index
+	unsigned int AddJob(const char* name, SystemAccess access, function<void()> work);
+
+	//Makes a job wait for another regardless of what they access
+	void AddDependency(unsigned int job, unsigned int dependsOn);
+
+	//Runs every job added since the last call, then clears the graph
+	void Run();
+
+	//Longest chain of dependent jobs in the last run, in milliseconds
+	double GetCriticalPathTime() const {
+		return m_criticalPathTime;
+	}
+	//Time from the start to the end of the last run, in milliseconds
+	double GetWallTime() const {
+		return m_wallTime;
+	}
+	//Sum of every job's time in the last run, in milliseconds
+	double GetWorkTime() const {
+		return m_workTime;
+	}
+
+	ScheduleMode GetMode() const {
+		return m_mode;
+	}
+	void SetMode(ScheduleMode mode) {
+		m_mode = mode;
+	}
+private:
+	struct Job {
+		const char* m_name;
+		SystemAccess m_access;
+		function<void()> m_work;
+		//In the frame arena of the thread that added the job, since the graph is thrown away when the run ends
+		ArenaVector<unsigned int> m_dependencies;
+		ArenaVector<unsigned int> m_dependents;
+		double m_duration;
+	};
+
+	void Execute(unsigned int job);
+	void Launch(unsigned int job, JobGroup* group);
+
+	vector<Job> m_jobs;
+	unique_ptr<atomic<unsigned int>[]> m_remaining;		//Unfinished dependencies per job during a run
+	size_t m_remainingCapacity;
+	ScheduleMode m_mode;
+	double m_criticalPathTime;
+	double m_wallTime;
+	double m_workTime;
+};
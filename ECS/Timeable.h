@@ -1,22 +1,27 @@
 #pragma once
 
-#include <chrono>
-
-using namespace std::chrono;
+#include "Profiler.h"
 
+//Accumulates a system's update time and records each update as a profiler zone
 class Timeable {
 public:
+	Timeable(const char* name = "Update") : m_name(name) {
+	}
+
+	//Gets the accumulated time in milliseconds
 	double GetTotalTime() {
 		return m_totalTime;
 	}
 protected:
 	void StartTimer() {
-		m_start = high_resolution_clock::now();
+		m_start = Profiler::BeginZone();
 	}
 	void StopTimer() {
-		m_totalTime += duration_cast<milliseconds>(high_resolution_clock::now() - m_start).count();
+		uint64_t end = Profiler::EndZone(m_name, m_start);
+		m_totalTime += (end - m_start) / 1e6;
 	}
 private:
+	const char* m_name;
 	double m_totalTime = 0;
-	time_point<steady_clock> m_start;
+	uint64_t m_start;
 };
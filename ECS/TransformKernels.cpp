@@ -0,0 +1,316 @@
+#include "TransformKernels.h"
+#include <cmath>
+
+#if SIMD_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+//GCC and Clang only emit AVX2 instructions inside functions compiled for it, MSVC accepts the intrinsics anywhere
+#if defined(__GNUC__)
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SIMD_TARGET_AVX2
+#endif
+
+#define TWO_PI 6.283185307f
+#define INV_TWO_PI 0.159154943f
+
+//Taylor coefficients for sine and cosine, accurate to ~1e-7 on [-pi/2, pi/2]
+#define SIN_C1 -1.66666667e-1f
+#define SIN_C2 8.33333333e-3f
+#define SIN_C3 -1.98412698e-4f
+#define SIN_C4 2.75573192e-6f
+#define SIN_C5 -2.50521084e-8f
+#define COS_C1 -5.0e-1f
+#define COS_C2 4.16666667e-2f
+#define COS_C3 -1.38888889e-3f
+#define COS_C4 2.48015873e-5f
+#define COS_C5 -2.75573192e-7f
+#define COS_C6 2.08767570e-9f
+
+//Pointers to every stream the kernels touch
+struct KernelStreams {
+	float * px, * py, * pz;
+	float * qx, * qy, * qz, * qw;
+	float * vx, * vy, * vz;
+	const float * ax, * ay, * az;
+	const float * wx, * wy, * wz;
+	const float * gravity;
+	uint32_t * version;
+
+	KernelStreams(TransformStreams& s) {
+		px = s.Get(POSITION_X); py = s.Get(POSITION_Y); pz = s.Get(POSITION_Z);
+		qx = s.Get(ROTATION_X); qy = s.Get(ROTATION_Y); qz = s.Get(ROTATION_Z); qw = s.Get(ROTATION_W);
+		vx = s.Get(VELOCITY_X); vy = s.Get(VELOCITY_Y); vz = s.Get(VELOCITY_Z);
+		ax = s.Get(ACCELERATION_X); ay = s.Get(ACCELERATION_Y); az = s.Get(ACCELERATION_Z);
+		wx = s.Get(ROTATIONAL_VELOCITY_X); wy = s.Get(ROTATIONAL_VELOCITY_Y); wz = s.Get(ROTATIONAL_VELOCITY_Z);
+		gravity = s.Get(GRAVITY);
+		version = s.GetVersions();
+	}
+};
+
+void TransformKernels::Integrate(SimdLevel level, TransformStreams& streams, size_t begin, size_t end, const IntegrationParams& params) {
+	switch (level) {
+	case SimdLevel::AVX2:
+		IntegrateAVX2(streams, begin, end, params);
+		break;
+	case SimdLevel::SSE:
+		IntegrateSSE(streams, begin, end, params);
+		break;
+	default:
+		IntegrateScalar(streams, begin, end, params);
+		break;
+	}
+}
+
+void TransformKernels::IntegrateScalar(TransformStreams& streams, size_t begin, size_t end, const IntegrationParams& params) {
+	KernelStreams s(streams);
+	float dt = params.m_dt;
+	for (size_t c = begin; c < end; c++) {
+		//gravity, velocity and position
+		s.vx[c] += dt * s.ax[c];
+		s.vy[c] += dt * (s.ay[c] + params.m_gravity * s.gravity[c]);
+		s.vz[c] += dt * s.az[c];
+		float px = s.px[c] + dt * s.vx[c], py = s.py[c] + dt * s.vy[c], pz = s.pz[c] + dt * s.vz[c];
+		bool changed = px != s.px[c] || py != s.py[c] || pz != s.pz[c];
+		s.px[c] = px;
+		s.py[c] = py;
+		s.pz[c] = pz;
+
+		//rotation about w by |w| wrapped to [-pi, pi], scaled by dt
+		float wx = s.wx[c], wy = s.wy[c], wz = s.wz[c];
+		float theta = sqrtf(wx * wx + wy * wy + wz * wz);
+		float wrapped = theta - TWO_PI * static_cast<float>(static_cast<int>(theta * INV_TWO_PI + 0.5f));
+		float half = 0.5f * dt * wrapped;
+		float invTheta = (theta > 0.0f) ? 1.0f / theta : 0.0f;
+		float h2 = half * half;
+		float sine = half * (1.0f + h2 * (SIN_C1 + h2 * (SIN_C2 + h2 * (SIN_C3 + h2 * (SIN_C4 + h2 * SIN_C5)))));
+		float cosine = 1.0f + h2 * (COS_C1 + h2 * (COS_C2 + h2 * (COS_C3 + h2 * (COS_C4 + h2 * (COS_C5 + h2 * COS_C6)))));
+		float scale = sine * invTheta;
+		float dx = scale * wx, dy = scale * wy, dz = scale * wz, dw = cosine;
+
+		//q = d * q, the same order as XMQuaternionMultiply(q, d)
+		float qx = s.qx[c], qy = s.qy[c], qz = s.qz[c], qw = s.qw[c];
+		s.qx[c] = dw * qx + dx * qw + dy * qz - dz * qy;
+		s.qy[c] = dw * qy - dx * qz + dy * qw + dz * qx;
+		s.qz[c] = dw * qz + dx * qy - dy * qx + dz * qw;
+		s.qw[c] = dw * qw - dx * qx - dy * qy - dz * qz;
+		changed = changed || s.qx[c] != qx || s.qy[c] != qy || s.qz[c] != qz || s.qw[c] != qw;
+
+		if (changed)
+			s.version[c] = params.m_tick;
+	}
+}
+
+#if SIMD_X86
+void TransformKernels::IntegrateSSE(TransformStreams& streams, size_t begin, size_t end, const IntegrationParams& params) {
+	KernelStreams s(streams);
+	const __m128 dt = _mm_set1_ps(params.m_dt);
+	const __m128 gravity = _mm_set1_ps(params.m_gravity);
+	const __m128 halfDt = _mm_set1_ps(0.5f * params.m_dt);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 pointFive = _mm_set1_ps(0.5f);
+	const __m128i tick = _mm_set1_epi32(static_cast<int>(params.m_tick));
+	size_t c = begin;
+	for (; c + 4 <= end; c += 4) {
+		//gravity, velocity and position
+		__m128 vx = _mm_add_ps(_mm_loadu_ps(s.vx + c), _mm_mul_ps(dt, _mm_loadu_ps(s.ax + c)));
+		__m128 vy = _mm_add_ps(_mm_loadu_ps(s.vy + c), _mm_mul_ps(dt, _mm_add_ps(_mm_loadu_ps(s.ay + c), _mm_mul_ps(gravity, _mm_loadu_ps(s.gravity + c)))));
+		__m128 vz = _mm_add_ps(_mm_loadu_ps(s.vz + c), _mm_mul_ps(dt, _mm_loadu_ps(s.az + c)));
+		_mm_storeu_ps(s.vx + c, vx);
+		_mm_storeu_ps(s.vy + c, vy);
+		_mm_storeu_ps(s.vz + c, vz);
+		__m128 px = _mm_loadu_ps(s.px + c), py = _mm_loadu_ps(s.py + c), pz = _mm_loadu_ps(s.pz + c);
+		__m128 npx = _mm_add_ps(px, _mm_mul_ps(dt, vx)), npy = _mm_add_ps(py, _mm_mul_ps(dt, vy)), npz = _mm_add_ps(pz, _mm_mul_ps(dt, vz));
+		_mm_storeu_ps(s.px + c, npx);
+		_mm_storeu_ps(s.py + c, npy);
+		_mm_storeu_ps(s.pz + c, npz);
+		__m128 changed = _mm_or_ps(_mm_or_ps(_mm_cmpneq_ps(npx, px), _mm_cmpneq_ps(npy, py)), _mm_cmpneq_ps(npz, pz));
+
+		//rotation about w by |w| wrapped to [-pi, pi], scaled by dt
+		__m128 wx = _mm_loadu_ps(s.wx + c), wy = _mm_loadu_ps(s.wy + c), wz = _mm_loadu_ps(s.wz + c);
+		__m128 theta = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(wx, wx), _mm_mul_ps(wy, wy)), _mm_mul_ps(wz, wz)));
+		__m128 turns = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(theta, _mm_set1_ps(INV_TWO_PI)), pointFive)));
+		__m128 wrapped = _mm_sub_ps(theta, _mm_mul_ps(_mm_set1_ps(TWO_PI), turns));
+		__m128 half = _mm_mul_ps(halfDt, wrapped);
+		__m128 invTheta = _mm_and_ps(_mm_cmpgt_ps(theta, zero), _mm_div_ps(one, theta));
+		__m128 h2 = _mm_mul_ps(half, half);
+		__m128 sine = _mm_add_ps(_mm_set1_ps(SIN_C4), _mm_mul_ps(h2, _mm_set1_ps(SIN_C5)));
+		sine = _mm_add_ps(_mm_set1_ps(SIN_C3), _mm_mul_ps(h2, sine));
+		sine = _mm_add_ps(_mm_set1_ps(SIN_C2), _mm_mul_ps(h2, sine));
+		sine = _mm_add_ps(_mm_set1_ps(SIN_C1), _mm_mul_ps(h2, sine));
+		sine = _mm_mul_ps(half, _mm_add_ps(one, _mm_mul_ps(h2, sine)));
+		__m128 cosine = _mm_add_ps(_mm_set1_ps(COS_C5), _mm_mul_ps(h2, _mm_set1_ps(COS_C6)));
+		cosine = _mm_add_ps(_mm_set1_ps(COS_C4), _mm_mul_ps(h2, cosine));
+		cosine = _mm_add_ps(_mm_set1_ps(COS_C3), _mm_mul_ps(h2, cosine));
+		cosine = _mm_add_ps(_mm_set1_ps(COS_C2), _mm_mul_ps(h2, cosine));
+		cosine = _mm_add_ps(_mm_set1_ps(COS_C1), _mm_mul_ps(h2, cosine));
+		cosine = _mm_add_ps(one, _mm_mul_ps(h2, cosine));
+		__m128 scale = _mm_mul_ps(sine, invTheta);
+		__m128 dx = _mm_mul_ps(scale, wx), dy = _mm_mul_ps(scale, wy), dz = _mm_mul_ps(scale, wz), dw = cosine;
+
+		//q = d * q
+		__m128 qx = _mm_loadu_ps(s.qx + c), qy = _mm_loadu_ps(s.qy + c), qz = _mm_loadu_ps(s.qz + c), qw = _mm_loadu_ps(s.qw + c);
+		__m128 nqx = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dw, qx), _mm_mul_ps(dx, qw)), _mm_mul_ps(dy, qz)), _mm_mul_ps(dz, qy));
+		__m128 nqy = _mm_add_ps(_mm_add_ps(_mm_sub_ps(_mm_mul_ps(dw, qy), _mm_mul_ps(dx, qz)), _mm_mul_ps(dy, qw)), _mm_mul_ps(dz, qx));
+		__m128 nqz = _mm_add_ps(_mm_sub_ps(_mm_add_ps(_mm_mul_ps(dw, qz), _mm_mul_ps(dx, qy)), _mm_mul_ps(dy, qx)), _mm_mul_ps(dz, qw));
+		__m128 nqw = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_mul_ps(dw, qw), _mm_mul_ps(dx, qx)), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz));
+		_mm_storeu_ps(s.qx + c, nqx);
+		_mm_storeu_ps(s.qy + c, nqy);
+		_mm_storeu_ps(s.qz + c, nqz);
+		_mm_storeu_ps(s.qw + c, nqw);
+		changed = _mm_or_ps(changed, _mm_or_ps(_mm_or_ps(_mm_cmpneq_ps(nqx, qx), _mm_cmpneq_ps(nqy, qy)), _mm_or_ps(_mm_cmpneq_ps(nqz, qz), _mm_cmpneq_ps(nqw, qw))));
+
+		//stamp the tick into the lanes that moved
+		__m128i mask = _mm_castps_si128(changed);
+		__m128i version = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s.version + c));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(s.version + c), _mm_or_si128(_mm_and_si128(mask, tick), _mm_andnot_si128(mask, version)));
+	}
+	IntegrateScalar(streams, c, end, params);
+}
+
+SIMD_TARGET_AVX2
+void TransformKernels::IntegrateAVX2(TransformStreams& streams, size_t begin, size_t end, const IntegrationParams& params) {
+	KernelStreams s(streams);
+	const __m256 dt = _mm256_set1_ps(params.m_dt);
+	const __m256 gravity = _mm256_set1_ps(params.m_gravity);
+	const __m256 halfDt = _mm256_set1_ps(0.5f * params.m_dt);
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 pointFive = _mm256_set1_ps(0.5f);
+	const __m256i tick = _mm256_set1_epi32(static_cast<int>(params.m_tick));
+	size_t c = begin;
+	for (; c + 8 <= end; c += 8) {
+		//gravity, velocity and position
+		__m256 vx = _mm256_add_ps(_mm256_loadu_ps(s.vx + c), _mm256_mul_ps(dt, _mm256_loadu_ps(s.ax + c)));
+		__m256 vy = _mm256_add_ps(_mm256_loadu_ps(s.vy + c), _mm256_mul_ps(dt, _mm256_add_ps(_mm256_loadu_ps(s.ay + c), _mm256_mul_ps(gravity, _mm256_loadu_ps(s.gravity + c)))));
+		__m256 vz = _mm256_add_ps(_mm256_loadu_ps(s.vz + c), _mm256_mul_ps(dt, _mm256_loadu_ps(s.az + c)));
+		_mm256_storeu_ps(s.vx + c, vx);
+		_mm256_storeu_ps(s.vy + c, vy);
+		_mm256_storeu_ps(s.vz + c, vz);
+		__m256 px = _mm256_loadu_ps(s.px + c), py = _mm256_loadu_ps(s.py + c), pz = _mm256_loadu_ps(s.pz + c);
+		__m256 npx = _mm256_add_ps(px, _mm256_mul_ps(dt, vx)), npy = _mm256_add_ps(py, _mm256_mul_ps(dt, vy)), npz = _mm256_add_ps(pz, _mm256_mul_ps(dt, vz));
+		_mm256_storeu_ps(s.px + c, npx);
+		_mm256_storeu_ps(s.py + c, npy);
+		_mm256_storeu_ps(s.pz + c, npz);
+		__m256 changed = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(npx, px, _CMP_NEQ_UQ), _mm256_cmp_ps(npy, py, _CMP_NEQ_UQ)), _mm256_cmp_ps(npz, pz, _CMP_NEQ_UQ));
+
+		//rotation about w by |w| wrapped to [-pi, pi], scaled by dt
+		__m256 wx = _mm256_loadu_ps(s.wx + c), wy = _mm256_loadu_ps(s.wy + c), wz = _mm256_loadu_ps(s.wz + c);
+		__m256 theta = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(wx, wx), _mm256_mul_ps(wy, wy)), _mm256_mul_ps(wz, wz)));
+		__m256 turns = _mm256_cvtepi32_ps(_mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(theta, _mm256_set1_ps(INV_TWO_PI)), pointFive)));
+		__m256 wrapped = _mm256_sub_ps(theta, _mm256_mul_ps(_mm256_set1_ps(TWO_PI), turns));
+		__m256 half = _mm256_mul_ps(halfDt, wrapped);
+		__m256 invTheta = _mm256_and_ps(_mm256_cmp_ps(theta, zero, _CMP_GT_OQ), _mm256_div_ps(one, theta));
+		__m256 h2 = _mm256_mul_ps(half, half);
+		__m256 sine = _mm256_add_ps(_mm256_set1_ps(SIN_C4), _mm256_mul_ps(h2, _mm256_set1_ps(SIN_C5)));
+		sine = _mm256_add_ps(_mm256_set1_ps(SIN_C3), _mm256_mul_ps(h2, sine));
+		sine = _mm256_add_ps(_mm256_set1_ps(SIN_C2), _mm256_mul_ps(h2, sine));
+		sine = _mm256_add_ps(_mm256_set1_ps(SIN_C1), _mm256_mul_ps(h2, sine));
+		sine = _mm256_mul_ps(half, _mm256_add_ps(one, _mm256_mul_ps(h2, sine)));
+		__m256 cosine = _mm256_add_ps(_mm256_set1_ps(COS_C5), _mm256_mul_ps(h2, _mm256_set1_ps(COS_C6)));
+		cosine = _mm256_add_ps(_mm256_set1_ps(COS_C4), _mm256_mul_ps(h2, cosine));
+		cosine = _mm256_add_ps(_mm256_set1_ps(COS_C3), _mm256_mul_ps(h2, cosine));
+		cosine = _mm256_add_ps(_mm256_set1_ps(COS_C2), _mm256_mul_ps(h2, cosine));
+		cosine = _mm256_add_ps(_mm256_set1_ps(COS_C1), _mm256_mul_ps(h2, cosine));
+		cosine = _mm256_add_ps(one, _mm256_mul_ps(h2, cosine));
+		__m256 scale = _mm256_mul_ps(sine, invTheta);
+		__m256 dx = _mm256_mul_ps(scale, wx), dy = _mm256_mul_ps(scale, wy), dz = _mm256_mul_ps(scale, wz), dw = cosine;
+
+		//q = d * q
+		__m256 qx = _mm256_loadu_ps(s.qx + c), qy = _mm256_loadu_ps(s.qy + c), qz = _mm256_loadu_ps(s.qz + c), qw = _mm256_loadu_ps(s.qw + c);
+		__m256 nqx = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dw, qx), _mm256_mul_ps(dx, qw)), _mm256_mul_ps(dy, qz)), _mm256_mul_ps(dz, qy));
+		__m256 nqy = _mm256_add_ps(_mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(dw, qy), _mm256_mul_ps(dx, qz)), _mm256_mul_ps(dy, qw)), _mm256_mul_ps(dz, qx));
+		__m256 nqz = _mm256_add_ps(_mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(dw, qz), _mm256_mul_ps(dx, qy)), _mm256_mul_ps(dy, qx)), _mm256_mul_ps(dz, qw));
+		__m256 nqw = _mm256_sub_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_mul_ps(dw, qw), _mm256_mul_ps(dx, qx)), _mm256_mul_ps(dy, qy)), _mm256_mul_ps(dz, qz));
+		_mm256_storeu_ps(s.qx + c, nqx);
+		_mm256_storeu_ps(s.qy + c, nqy);
+		_mm256_storeu_ps(s.qz + c, nqz);
+		_mm256_storeu_ps(s.qw + c, nqw);
+		changed = _mm256_or_ps(changed, _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(nqx, qx, _CMP_NEQ_UQ), _mm256_cmp_ps(nqy, qy, _CMP_NEQ_UQ)), _mm256_or_ps(_mm256_cmp_ps(nqz, qz, _CMP_NEQ_UQ), _mm256_cmp_ps(nqw, qw, _CMP_NEQ_UQ))));
+
+		//stamp the tick into the lanes that moved
+		__m256i version = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s.version + c));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(s.version + c), _mm256_blendv_epi8(version, tick, _mm256_castps_si256(changed)));
+	}
+	IntegrateScalar(streams, c, end, params);
+}
+#else
+void TransformKernels::IntegrateSSE(TransformStreams& streams, size_t begin, size_t end, const IntegrationParams& params) {
+	IntegrateScalar(streams, begin, end, params);
+}
+
+void TransformKernels::IntegrateAVX2(TransformStreams& streams, size_t begin, size_t end, const IntegrationParams& params) {
+	IntegrateScalar(streams, begin, end, params);
+}
+#endif
+
+void TransformKernels::BuildWorldMatrices(TransformStreams& streams, size_t begin, size_t end, uint32_t tick) {
+	const uint32_t* version = streams.GetVersions();
+	for (size_t c = begin; c < end; c++) {
+		if (version[c] == tick)
+			BuildWorldMatrix(streams, c);
+	}
+}
+
+//Scale, then rotation, then translation, matching XMMatrixScaling * XMMatrixRotationQuaternion * XMMatrixTranslation
+void TransformKernels::BuildWorldMatrix(TransformStreams& streams, size_t index) {
+	float x = streams.Get(ROTATION_X)[index], y = streams.Get(ROTATION_Y)[index], z = streams.Get(ROTATION_Z)[index], w = streams.Get(ROTATION_W)[index];
+	float s = streams.Get(SCALE)[index];
+	float xx = x * x, yy = y * y, zz = z * z;
+	float xy = x * y, xz = x * z, yz = y * z;
+	float xw = x * w, yw = y * w, zw = z * w;
+	WorldMatrix& m = streams.GetWorldMatrices()[index];
+	m.m_rows[0][0] = s * (1.0f - 2.0f * (yy + zz));
+	m.m_rows[0][1] = s * 2.0f * (xy - zw);
+	m.m_rows[0][2] = s * 2.0f * (xz + yw);
+	m.m_rows[0][3] = streams.Get(POSITION_X)[index];
+	m.m_rows[1][0] = s * 2.0f * (xy + zw);
+	m.m_rows[1][1] = s * (1.0f - 2.0f * (xx + zz));
+	m.m_rows[1][2] = s * 2.0f * (yz - xw);
+	m.m_rows[1][3] = streams.Get(POSITION_Y)[index];
+	m.m_rows[2][0] = s * 2.0f * (xz - yw);
+	m.m_rows[2][1] = s * 2.0f * (yz + xw);
+	m.m_rows[2][2] = s * (1.0f - 2.0f * (xx + yy));
+	m.m_rows[2][3] = streams.Get(POSITION_Z)[index];
+}
+
+SimdLevel TransformKernels::GetSupportedSimdLevel() {
+#if SIMD_X86
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	//the OS has to save the upper halves of the ymm registers too
+	if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6) {
+		__cpuidex(info, 7, 0);
+		if (info[1] & (1 << 5))
+			return SimdLevel::AVX2;
+	}
+	return SimdLevel::SSE;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") ? SimdLevel::AVX2 : SimdLevel::SSE;
+#endif
+#else
+	return SimdLevel::Scalar;
+#endif
+}
+
+const char* TransformKernels::GetSimdLevelName(SimdLevel level) {
+	switch (level) {
+	case SimdLevel::AVX2:
+		return "AVX2";
+	case SimdLevel::SSE:
+		return "SSE";
+	default:
+		return "Scalar";
+	}
+}
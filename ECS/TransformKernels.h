@@ -0,0 +1,52 @@
+#pragma once
+#include "TransformStreams.h"
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#else
+#define SIMD_X86 0
+#endif
+
+//Instruction sets the integration kernel is built for
+enum class SimdLevel { Scalar, SSE, AVX2 };
+
+//Per-tick values shared by every entity
+struct IntegrationParams {
+	float m_dt;			//Must not exceed one second, the sine/cosine polynomials are only accurate to a quarter turn
+	float m_gravity;	//Added to the y acceleration of entities with gravity enabled
+	uint32_t m_tick;	//Written to the version stream of every entity whose position or rotation changes
+};
+
+//Integration kernels over TransformStreams
+//Every variant applies gravity, integrates velocity then position, and advances rotation by the rotational velocity
+//The rotation step matches XMQuaternionSlerp(q, XMQuaternionMultiply(q, XMQuaternionRotationAxis(w, |w|)), dt),
+//which is a rotation about w by |w| wrapped to [-pi, pi] and scaled by dt
+//Entities at rest keep their version, so systems downstream can skip them
+class TransformKernels {
+public:
+	//Integrates entities [begin, end) with the requested instruction set
+	static void Integrate(SimdLevel level, TransformStreams& streams, size_t begin, size_t end, const IntegrationParams& params);
+
+	//One entity at a time, runs everywhere
+	static void IntegrateScalar(TransformStreams& streams, size_t begin, size_t end, const IntegrationParams& params);
+
+	//Four entities at a time, the remainder goes through the scalar kernel
+	static void IntegrateSSE(TransformStreams& streams, size_t begin, size_t end, const IntegrationParams& params);
+
+	//Eight entities at a time, the remainder goes through the scalar kernel
+	static void IntegrateAVX2(TransformStreams& streams, size_t begin, size_t end, const IntegrationParams& params);
+
+	//Rebuilds the world matrices of entities in [begin, end) stamped with the given tick
+	static void BuildWorldMatrices(TransformStreams& streams, size_t begin, size_t end, uint32_t tick);
+
+	//Rebuilds the world matrix at the given index from its position, rotation and scale
+	static void BuildWorldMatrix(TransformStreams& streams, size_t index);
+
+	//Returns the widest instruction set this CPU and build support
+	static SimdLevel GetSupportedSimdLevel();
+
+	//Returns a printable name for the instruction set
+	static const char* GetSimdLevelName(SimdLevel level);
+};
@@ -0,0 +1,196 @@
+#pragma once
+#include "AlignedAllocator.h"
+#include "Compaction.h"
+#include "TransformComponent.h"
+#include "PhysicsComponent.h"
+#include <algorithm>
+#include <cstdint>
+
+//Indices of the float streams making up TransformStreams
+enum TransformStream {
+	POSITION_X, POSITION_Y, POSITION_Z,
+	ROTATION_X, ROTATION_Y, ROTATION_Z, ROTATION_W,
+	SCALE,
+	VELOCITY_X, VELOCITY_Y, VELOCITY_Z,
+	ACCELERATION_X, ACCELERATION_Y, ACCELERATION_Z,
+	ROTATIONAL_VELOCITY_X, ROTATIONAL_VELOCITY_Y, ROTATIONAL_VELOCITY_Z,
+	ROTATIONAL_ACCELERATION_X, ROTATIONAL_ACCELERATION_Y, ROTATIONAL_ACCELERATION_Z,
+	GRAVITY,	//1 if the entity is affected by gravity, 0 otherwise
+	TRANSFORM_STREAM_COUNT
+};
+
+//An affine world matrix, stored as the top three rows of its transpose
+//Each row dotted with (x, y, z, 1) gives one world coordinate, and the rows upload to an instance buffer as they are
+struct WorldMatrix {
+	float m_rows[3][4];
+
+	//Writes the full transposed matrix, the layout instance buffers take
+	void StoreTransposed(DirectX::XMFLOAT4X4* out) const {
+		for (unsigned int r = 0; r < 3; r++)
+			for (unsigned int c = 0; c < 4; c++)
+				out->m[r][c] = m_rows[r][c];
+		out->m[3][0] = 0.0f;
+		out->m[3][1] = 0.0f;
+		out->m[3][2] = 0.0f;
+		out->m[3][3] = 1.0f;
+	}
+};
+
+//Structure-of-arrays storage for TransformComponent/PhysicsComponent pairs
+//Every stream holds one float per entity in the same dense order, so kernels can integrate several entities per instruction
+//Alongside them, a version stream records the tick each entity's position, rotation or scale last changed,
+//and a matrix stream holds the world matrix built from them
+class TransformStreams {
+public:
+	//Appends an entity's components to the end of every stream
+	void PushBack(const TransformComponent& tc, const PhysicsComponent& pc) {
+		for (unsigned int s = 0; s < TRANSFORM_STREAM_COUNT; s++)
+			m_streams[s].push_back(0.0f);
+		m_versions.push_back(0);
+		m_worldMatrices.emplace_back();
+		Set(m_streams[0].size() - 1, tc, pc);
+	}
+
+	//Overwrites the components stored at the given index
+	void Set(size_t index, const TransformComponent& tc, const PhysicsComponent& pc) {
+		SetTransform(index, tc);
+		SetPhysics(index, pc);
+	}
+
+	void SetTransform(size_t index, const TransformComponent& tc) {
+		m_streams[POSITION_X][index] = tc.m_position.x;
+		m_streams[POSITION_Y][index] = tc.m_position.y;
+		m_streams[POSITION_Z][index] = tc.m_position.z;
+		m_streams[ROTATION_X][index] = tc.m_rotation.x;
+		m_streams[ROTATION_Y][index] = tc.m_rotation.y;
+		m_streams[ROTATION_Z][index] = tc.m_rotation.z;
+		m_streams[ROTATION_W][index] = tc.m_rotation.w;
+		m_streams[SCALE][index] = (tc.m_scale == 0.0f) ? 1.0f : tc.m_scale;
+	}
+
+	void SetPhysics(size_t index, const PhysicsComponent& pc) {
+		m_streams[VELOCITY_X][index] = pc.m_velocity.x;
+		m_streams[VELOCITY_Y][index] = pc.m_velocity.y;
+		m_streams[VELOCITY_Z][index] = pc.m_velocity.z;
+		m_streams[ACCELERATION_X][index] = pc.m_acceleration.x;
+		m_streams[ACCELERATION_Y][index] = pc.m_acceleration.y;
+		m_streams[ACCELERATION_Z][index] = pc.m_acceleration.z;
+		m_streams[ROTATIONAL_VELOCITY_X][index] = pc.m_rotationalVelocity.x;
+		m_streams[ROTATIONAL_VELOCITY_Y][index] = pc.m_rotationalVelocity.y;
+		m_streams[ROTATIONAL_VELOCITY_Z][index] = pc.m_rotationalVelocity.z;
+		m_streams[ROTATIONAL_ACCELERATION_X][index] = pc.m_rotationalAcceleration.x;
+		m_streams[ROTATIONAL_ACCELERATION_Y][index] = pc.m_rotationalAcceleration.y;
+		m_streams[ROTATIONAL_ACCELERATION_Z][index] = pc.m_rotationalAcceleration.z;
+		m_streams[GRAVITY][index] = pc.m_gravity ? 1.0f : 0.0f;
+	}
+
+	//Gathers the transform stored at the given index
+	TransformComponent GetTransform(size_t index) const {
+		TransformComponent tc;
+		tc.m_position = DirectX::XMFLOAT3(m_streams[POSITION_X][index], m_streams[POSITION_Y][index], m_streams[POSITION_Z][index]);
+		tc.m_rotation = DirectX::XMFLOAT4(m_streams[ROTATION_X][index], m_streams[ROTATION_Y][index], m_streams[ROTATION_Z][index], m_streams[ROTATION_W][index]);
+		tc.m_scale = m_streams[SCALE][index];
+		return tc;
+	}
+
+	//Gathers the physics quantities stored at the given index
+	PhysicsComponent GetPhysics(size_t index) const {
+		PhysicsComponent pc;
+		pc.m_velocity = DirectX::XMFLOAT3(m_streams[VELOCITY_X][index], m_streams[VELOCITY_Y][index], m_streams[VELOCITY_Z][index]);
+		pc.m_acceleration = DirectX::XMFLOAT3(m_streams[ACCELERATION_X][index], m_streams[ACCELERATION_Y][index], m_streams[ACCELERATION_Z][index]);
+		pc.m_rotationalVelocity = DirectX::XMFLOAT3(m_streams[ROTATIONAL_VELOCITY_X][index], m_streams[ROTATIONAL_VELOCITY_Y][index], m_streams[ROTATIONAL_VELOCITY_Z][index]);
+		pc.m_rotationalAcceleration = DirectX::XMFLOAT3(m_streams[ROTATIONAL_ACCELERATION_X][index], m_streams[ROTATIONAL_ACCELERATION_Y][index], m_streams[ROTATIONAL_ACCELERATION_Z][index]);
+		pc.m_gravity = m_streams[GRAVITY][index] != 0.0f;
+		return pc;
+	}
+
+	//Moves the last entity into the given index and shrinks every stream by one
+	void SwapAndPop(size_t index) {
+		for (unsigned int s = 0; s < TRANSFORM_STREAM_COUNT; s++) {
+			m_streams[s][index] = m_streams[s].back();
+			m_streams[s].pop_back();
+		}
+		m_versions[index] = m_versions.back();
+		m_versions.pop_back();
+		m_worldMatrices[index] = m_worldMatrices.back();
+		m_worldMatrices.pop_back();
+	}
+
+	//Returns the start of a stream
+	float* Get(TransformStream stream) {
+		return m_streams[stream].data();
+	}
+	const float* Get(TransformStream stream) const {
+		return m_streams[stream].data();
+	}
+
+	//Returns the start of the version stream
+	uint32_t* GetVersions() {
+		return m_versions.data();
+	}
+	const uint32_t* GetVersions() const {
+		return m_versions.data();
+	}
+
+	//Returns the start of the world matrix stream
+	WorldMatrix* GetWorldMatrices() {
+		return m_worldMatrices.data();
+	}
+	const WorldMatrix* GetWorldMatrices() const {
+		return m_worldMatrices.data();
+	}
+
+	void Reserve(size_t capacity) {
+		for (unsigned int s = 0; s < TRANSFORM_STREAM_COUNT; s++)
+			m_streams[s].reserve(capacity);
+		m_versions.reserve(capacity);
+		m_worldMatrices.reserve(capacity);
+	}
+
+	//Sets the number of entities, leaving the contents of new slots unset
+	void Resize(size_t count) {
+		for (unsigned int s = 0; s < TRANSFORM_STREAM_COUNT; s++)
+			m_streams[s].resize(count);
+		m_versions.resize(count);
+		m_worldMatrices.resize(count);
+	}
+
+	//Makes room for count more entities, at least doubling the capacity when it grows
+	void ReserveAdditional(size_t count) {
+		size_t needed = size() + count;
+		if (needed > m_streams[0].capacity())
+			Reserve(std::max<size_t>(needed, m_streams[0].capacity() * 2));
+	}
+
+	size_t size() const {
+		return m_streams[0].size();
+	}
+	size_t capacity() const {
+		return m_streams[0].capacity();
+	}
+
+	//Reallocates streams to hold exactly their entities, one at a time until the budget runs out
+	//Returns true once every stream has been shrunk
+	bool ShrinkToFit(CompactionBudget& budget) {
+		//the version and matrix streams go last, after the float streams
+		for (; m_shrinkStream <= TRANSFORM_STREAM_COUNT + 1; m_shrinkStream++) {
+			if (budget.Expired())
+				return false;
+			if (m_shrinkStream == TRANSFORM_STREAM_COUNT)
+				::ShrinkToFit(m_versions);
+			else if (m_shrinkStream == TRANSFORM_STREAM_COUNT + 1)
+				::ShrinkToFit(m_worldMatrices);
+			else
+				::ShrinkToFit(m_streams[m_shrinkStream]);
+		}
+		m_shrinkStream = 0;
+		return true;
+	}
+private:
+	AlignedVector<float> m_streams[TRANSFORM_STREAM_COUNT];
+	AlignedVector<uint32_t> m_versions;
+	AlignedVector<WorldMatrix> m_worldMatrices;
+
+	//Next stream ShrinkToFit reallocates
+	unsigned int m_shrinkStream = 0;
+};
@@ -1,47 +1,207 @@
 #include "TransformSystem.h"
-#include "Constructors.h"
-void TransformSystem::Update(Game * game, float dt) {
+#include "Simulation.h"
+#include <algorithm>
+#include <cstring>
+
+TransformSystem::TransformSystem() : Timeable("TransformSystem") {
+	m_simdLevel = TransformKernels::GetSupportedSimdLevel();
+}
+
+void TransformSystem::Update(Simulation * sim, float dt) {
 	StartTimer();
-	Collapse();
-	
-	//loop through all components
-	parallel_for(size_t(0), m_collapsedCount, [&](unsigned int c) {
-		XMVECTOR position;
-		XMVECTOR rotation;
-		XMVECTOR velocity;
-		XMVECTOR acceleration;
-		XMVECTOR rotationalVelocity;
-
-		//load stuff
-		position = XMLoadFloat3(&m_collapsedComponents1[c].m_component.m_position);
-		rotation = XMLoadFloat4(&m_collapsedComponents1[c].m_component.m_rotation);
-		velocity = XMLoadFloat3(&m_collapsedComponents2[c].m_component.m_velocity);
-		acceleration = XMLoadFloat3(&m_collapsedComponents2[c].m_component.m_acceleration);
-		if(m_collapsedComponents2[c].m_component.m_gravity)
-			acceleration = XMVectorAdd(acceleration, XMLoadFloat3(&XMFLOAT3(0, m_gravity, 0)));
-		rotationalVelocity = XMLoadFloat3(&m_collapsedComponents2[c].m_component.m_rotationalVelocity);
-		if (XMVectorGetX(XMVector3Length(rotationalVelocity)) != 0)
-		{
-			rotation = XMQuaternionSlerp(rotation, XMQuaternionMultiply(rotation, XMQuaternionRotationAxis(rotationalVelocity, XMVectorGetX(XMVector3Length(rotationalVelocity)))), dt);
-		}
-
-		//do maths
-		velocity += dt*acceleration;
-		position += dt*velocity;
-
-		//store stuff
-		XMStoreFloat3(&m_components2[m_collapsedComponents2[c].m_handle].m_velocity, velocity);
-		XMStoreFloat3(&m_components1[m_collapsedComponents1[c].m_handle].m_position, position);
-		XMStoreFloat3(&m_components2[m_collapsedComponents2[c].m_handle].m_rotationalVelocity, rotationalVelocity);
-		XMStoreFloat4(&m_components1[m_collapsedComponents1[c].m_handle].m_rotation, rotation);
-	});
+	IntegrationParams params = { dt, m_gravity, m_changeTick };
+
+	//integrate blocks of entities in parallel, each block with the widest kernel available,
+	//then rebuild the world matrices of the entities that moved while the block is still in cache
+	JobSystem::GetDefault().ParallelForRange(0, m_streams.size(), TRANSFORM_BLOCK_SIZE, [&](size_t begin, size_t end) {
+		TransformKernels::Integrate(m_simdLevel, m_streams, begin, end, params);
+		TransformKernels::BuildWorldMatrices(m_streams, begin, end, params.m_tick);
+	}, "Integrate");
+	m_changeTick++;
 	StopTimer();
 }
 
-//Returns a matrix generated from the given component's properties
-XMMATRIX TransformSystem::GetMatrix(TransformComponent& tc) {
-	if (tc.m_scale == 0.0f)
-		tc.m_scale = 1.0f;
-	XMMATRIX scale = XMMatrixScaling(tc.m_scale, tc.m_scale, tc.m_scale);
-	return XMMatrixMultiply(XMMatrixMultiply(scale,XMMatrixRotationQuaternion(XMLoadFloat4(&tc.m_rotation))), XMMatrixTranslationFromVector(XMLoadFloat3(&tc.m_position)));
+void TransformSystem::Create(EntityId entityId, TransformComponent tc, PhysicsComponent pc) {
+	unsigned int index = m_index.Insert(entityId);
+	if (index == m_streams.size())
+		m_streams.PushBack(tc, pc);
+	else
+		m_streams.Set(index, tc, pc);
+	MarkChanged(index);
+}
+
+void TransformSystem::Remove(EntityId entityId) {
+	unsigned int index = m_index.Erase(entityId);
+	if (index != INVALID_DENSE_INDEX)
+		m_streams.SwapAndPop(index);
+}
+
+void TransformSystem::ReserveAdditional(size_t count) {
+	m_index.ReserveAdditional(count);
+	m_streams.ReserveAdditional(count);
+}
+
+bool TransformSystem::Compact(CompactionBudget& budget) {
+	if (m_shrinking)
+	{
+		//finish the streams the last pass ran out of time on
+		m_shrinking = !m_streams.ShrinkToFit(budget);
+		return !m_shrinking;
+	}
+	if (!m_index.Compact(budget))
+		return false;
+	if (m_occupancyTracker.ShouldShrink(m_streams.size(), m_streams.capacity()))
+	{
+		m_shrinking = !m_streams.ShrinkToFit(budget);
+		return !m_shrinking;
+	}
+	return true;
+}
+
+void TransformSystem::SaveSnapshot(SnapshotWriter& writer) {
+	writer.Add(SNAPSHOT_TRANSFORM_ENTITIES, m_index.GetEntities().data(), m_index.size());
+	for (unsigned int s = 0; s < TRANSFORM_STREAM_COUNT; s++)
+		writer.Add(SNAPSHOT_TRANSFORM_STREAMS + s, m_streams.Get(static_cast<TransformStream>(s)), m_streams.size());
+}
+
+bool TransformSystem::CanLoadSnapshot(const SnapshotReader& reader, const SnapshotEntitySlot* slots, size_t slotCount) {
+	size_t count;
+	const EntityId* entities = reader.Get<EntityId>(SNAPSHOT_TRANSFORM_ENTITIES, count);
+	if (entities == nullptr || !SnapshotEntitiesAlive(entities, count, slots, slotCount))
+		return false;
+	for (unsigned int s = 0; s < TRANSFORM_STREAM_COUNT; s++) {
+		size_t streamCount;
+		if (reader.Get<float>(SNAPSHOT_TRANSFORM_STREAMS + s, streamCount) == nullptr || streamCount != count)
+			return false;
+	}
+	return true;
+}
+
+void TransformSystem::LoadSnapshot(const SnapshotReader& reader, EntityTable& entityTable) {
+	size_t count;
+	const EntityId* entities = reader.Get<EntityId>(SNAPSHOT_TRANSFORM_ENTITIES, count);
+	m_index.Assign(entities, count);
+	m_streams.Resize(count);
+	for (unsigned int s = 0; s < TRANSFORM_STREAM_COUNT; s++) {
+		size_t streamCount;
+		const float* stream = reader.Get<float>(SNAPSHOT_TRANSFORM_STREAMS + s, streamCount);
+		memcpy(m_streams.Get(static_cast<TransformStream>(s)), stream, sizeof(float) * count);
+	}
+	for (size_t c = 0; c < count; c++)
+		entityTable.AddSystem(entities[c], this);
+
+	//everything counts as changed, so caches downstream are rebuilt
+	uint32_t* versions = m_streams.GetVersions();
+	std::fill(versions, versions + count, m_changeTick);
+	JobSystem::GetDefault().ParallelForRange(0, count, TRANSFORM_BLOCK_SIZE, [&](size_t begin, size_t end) {
+		TransformKernels::BuildWorldMatrices(m_streams, begin, end, m_changeTick);
+	}, "Build world matrices");
+}
+
+TransformComponent TransformSystem::GetTransform(EntityId entityId) {
+	return m_streams.GetTransform(m_index.Get(entityId));
+}
+
+PhysicsComponent TransformSystem::GetPhysics(EntityId entityId) {
+	return m_streams.GetPhysics(m_index.Get(entityId));
+}
+
+void TransformSystem::SetTransform(EntityId entityId, const TransformComponent& tc) {
+	unsigned int index = m_index.Get(entityId);
+	m_streams.SetTransform(index, tc);
+	MarkChanged(index);
+}
+
+void TransformSystem::SetPhysics(EntityId entityId, const PhysicsComponent& pc) {
+	m_streams.SetPhysics(m_index.Get(entityId), pc);
+}
+
+XMFLOAT3 TransformSystem::GetPosition(EntityId entityId) {
+	unsigned int index = m_index.Get(entityId);
+	return XMFLOAT3(m_streams.Get(POSITION_X)[index], m_streams.Get(POSITION_Y)[index], m_streams.Get(POSITION_Z)[index]);
+}
+
+void TransformSystem::SetPosition(EntityId entityId, XMFLOAT3 position) {
+	unsigned int index = m_index.Get(entityId);
+	m_streams.Get(POSITION_X)[index] = position.x;
+	m_streams.Get(POSITION_Y)[index] = position.y;
+	m_streams.Get(POSITION_Z)[index] = position.z;
+	MarkChanged(index);
+}
+
+XMFLOAT4 TransformSystem::GetRotation(EntityId entityId) {
+	unsigned int index = m_index.Get(entityId);
+	return XMFLOAT4(m_streams.Get(ROTATION_X)[index], m_streams.Get(ROTATION_Y)[index], m_streams.Get(ROTATION_Z)[index], m_streams.Get(ROTATION_W)[index]);
+}
+
+void TransformSystem::SetRotation(EntityId entityId, XMFLOAT4 rotation) {
+	unsigned int index = m_index.Get(entityId);
+	m_streams.Get(ROTATION_X)[index] = rotation.x;
+	m_streams.Get(ROTATION_Y)[index] = rotation.y;
+	m_streams.Get(ROTATION_Z)[index] = rotation.z;
+	m_streams.Get(ROTATION_W)[index] = rotation.w;
+	MarkChanged(index);
+}
+
+void TransformSystem::SetVelocity(EntityId entityId, XMFLOAT3 velocity) {
+	unsigned int index = m_index.Get(entityId);
+	m_streams.Get(VELOCITY_X)[index] = velocity.x;
+	m_streams.Get(VELOCITY_Y)[index] = velocity.y;
+	m_streams.Get(VELOCITY_Z)[index] = velocity.z;
+}
+
+unsigned int TransformSystem::GetIndex(EntityId entityId) {
+	return m_index.Get(entityId);
+}
+
+EntityId TransformSystem::GetEntity(unsigned int index) {
+	return m_index.GetEntity(index);
+}
+
+TransformStreams& TransformSystem::GetStreams() {
+	return m_streams;
+}
+
+const WorldMatrix& TransformSystem::GetWorldMatrix(unsigned int index) {
+	return m_streams.GetWorldMatrices()[index];
+}
+
+XMMATRIX TransformSystem::GetMatrix(unsigned int index) {
+	XMFLOAT4X4 transposed;
+	m_streams.GetWorldMatrices()[index].StoreTransposed(&transposed);
+	return XMMatrixTranspose(XMLoadFloat4x4(&transposed));
+}
+
+uint32_t TransformSystem::GetChangeTick() {
+	return m_changeTick;
+}
+
+uint32_t TransformSystem::GetVersion(unsigned int index) {
+	return m_streams.GetVersions()[index];
+}
+
+bool TransformSystem::HasChangedSince(unsigned int index, uint32_t tick) {
+	return m_streams.GetVersions()[index] >= tick;
+}
+
+void TransformSystem::MarkChanged(unsigned int index) {
+	m_streams.GetVersions()[index] = m_changeTick;
+	TransformKernels::BuildWorldMatrix(m_streams, index);
+}
+
+size_t TransformSystem::GetCount() {
+	return m_streams.size();
+}
+
+SystemAccess TransformSystem::GetAccess() const {
+	ComponentMask mask = MakeComponentMask<TransformComponent, PhysicsComponent>();
+	return { mask, mask };
+}
+
+SimdLevel TransformSystem::GetSimdLevel() {
+	return m_simdLevel;
+}
+
+void TransformSystem::SetSimdLevel(SimdLevel level) {
+	m_simdLevel = level;
 }
\ No newline at end of file
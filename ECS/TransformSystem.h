@@ -1,18 +1,117 @@
 #pragma once
 
-#include "PairedSystem.h"
+#include "SystemBase.h"
+#include "SparseSet.h"
+#include "TransformStreams.h"
+#include "TransformKernels.h"
 #include "TransformComponent.h"
 #include "PhysicsComponent.h"
 #include "EntityIdTypeDef.h"
 #include "Timeable.h"
+#include "SystemAccess.h"
+#include "EntityTable.h"
+#include "Snapshot.h"
 #include <DirectXMath.h>
-#include <ppl.h>
-using namespace Concurrency;
+#include "JobSystem.h"
 using namespace DirectX;
-class TransformSystem : public PairedSystem<TransformComponent, PhysicsComponent> , public Timeable{
+
+//Largest number of entities integrated per job
+#define TRANSFORM_BLOCK_SIZE 1024
+
+//Owns the transform and physics components of every entity, stored as structure-of-arrays streams
+class TransformSystem : public SystemBase, public Timeable {
 public:
-	void Update(Game * game, float dT);
-	static DirectX::XMMATRIX GetMatrix(TransformComponent& tc);
+	void Update(Simulation * sim, float dT);
+
+	//Creates the transform and physics components for an entity
+	void Create(EntityId entityId, TransformComponent tc, PhysicsComponent pc);
+
+	//Removes the entity's components, moving the last entity into its slot
+	void Remove(EntityId entityId);
+
+	//Makes room in the index and every stream for count more entities
+	void ReserveAdditional(size_t count);
+
+	//Frees empty index pages and shrinks the streams once they have stayed mostly empty
+	bool Compact(CompactionBudget& budget);
+
+	//Adds the dense entities and every stream to a snapshot
+	void SaveSnapshot(SnapshotWriter& writer);
+
+	//Returns whether a snapshot holds the entity section and a stream section of the same length for every stream
+	bool CanLoadSnapshot(const SnapshotReader& reader, const SnapshotEntitySlot* slots, size_t slotCount);
+
+	//Replaces every transform with a snapshot's, registers this system with their entities and rebuilds their world matrices
+	//The entity table must already be restored from the same snapshot
+	void LoadSnapshot(const SnapshotReader& reader, EntityTable& entityTable);
+
+	//Gathers the entity's components from the streams
+	TransformComponent GetTransform(EntityId entityId);
+	PhysicsComponent GetPhysics(EntityId entityId);
+
+	//Scatters components into the entity's slot in the streams
+	void SetTransform(EntityId entityId, const TransformComponent& tc);
+	void SetPhysics(EntityId entityId, const PhysicsComponent& pc);
+
+	XMFLOAT3 GetPosition(EntityId entityId);
+	void SetPosition(EntityId entityId, XMFLOAT3 position);
+	XMFLOAT4 GetRotation(EntityId entityId);
+	void SetRotation(EntityId entityId, XMFLOAT4 rotation);
+	void SetVelocity(EntityId entityId, XMFLOAT3 velocity);
+
+	//Returns the dense index of an entity known to be present
+	unsigned int GetIndex(EntityId entityId);
+
+	//Returns the entity stored at the given dense index
+	EntityId GetEntity(unsigned int index);
+
+	//Returns the streams for systems that work on dense indices
+	TransformStreams& GetStreams();
+
+	//Returns the world matrix at the given dense index, built when its transform last changed
+	const WorldMatrix& GetWorldMatrix(unsigned int index);
+
+	//Loads the world matrix at the given dense index for DirectXMath
+	XMMATRIX GetMatrix(unsigned int index);
+
+	//Returns the tick stamped on transforms changed now
+	//A system that records it before looking at transforms can later ask which of them changed since
+	uint32_t GetChangeTick();
+
+	//Returns the tick the position, rotation or scale at the given dense index last changed
+	uint32_t GetVersion(unsigned int index);
+
+	//Returns true if the transform at the given dense index changed at or after the given tick
+	bool HasChangedSince(unsigned int index, uint32_t tick);
+
+	//Stamps the transform at the given dense index as changed and rebuilds its world matrix
+	//Callers that write the position, rotation or scale streams directly must call it afterwards
+	void MarkChanged(unsigned int index);
+
+	//Gets the number of entities
+	size_t GetCount();
+
+	//Integration reads and writes every transform and physics component
+	SystemAccess GetAccess() const;
+
+	//Gets and sets the instruction set used by the integration kernel
+	SimdLevel GetSimdLevel();
+	void SetSimdLevel(SimdLevel level);
+
+	TransformSystem();
 private:
 	float m_gravity = -15;
+
+	//Maps entities to their index in every stream
+	SparseIndex m_index;
+
+	TransformStreams m_streams;
+	OccupancyTracker m_occupancyTracker;
+	bool m_shrinking = false;			//Set while some streams are still waiting to be shrunk
+
+	SimdLevel m_simdLevel;
+
+	//Stamped on every transform change, advanced after each integration so later changes count towards the next tick
+	//Starts at 1 so a cached version of 0 never matches
+	uint32_t m_changeTick = 1;
 };